@@ -42,6 +42,8 @@
 
 #include "AbstractWaterfall.h"
 #include "SuWidgetsHelpers.h"
+#include "SuWidgetsKernels.h"
+#include "SuWidgetsRecorder.h"
 
 // Comment out to enable plotter debug messages
 //#define PLOTTER_DEBUG
@@ -139,10 +141,19 @@ AbstractWaterfall::AbstractWaterfall(QWidget *parent) : QOpenGLWidget(parent)
   m_fftDataSize = 0;
 
   m_infoTextColor = m_FftTextColor;
+
+  m_interactionTimer.setSingleShot(true);
+  m_interactionTimer.setInterval(SUWIDGETS_DEFAULT_INTERACTION_IDLE_MS);
+  connect(
+        &m_interactionTimer,
+        SIGNAL(timeout()),
+        this,
+        SLOT(onInteractionTimeout()));
 }
 
 AbstractWaterfall::~AbstractWaterfall()
 {
+  releaseTextureLayers();
 }
 
 QSize AbstractWaterfall::minimumSizeHint() const
@@ -317,7 +328,7 @@ void AbstractWaterfall::mouseMoveEvent(QMouseEvent* event)
       {
         emit pandapterRangeChanged(m_PandMindB, m_PandMaxdB);
 
-        updateOverlay();
+        refreshOverlay();
 
         m_PeakHoldValid = false;
 
@@ -364,7 +375,7 @@ void AbstractWaterfall::mouseMoveEvent(QMouseEvent* event)
         }
 
         if (delta_hz != 0) {
-          updateOverlay();
+          refreshOverlay();
           m_PeakHoldValid = false;
           m_Xzero = pt.x();
         }
@@ -388,7 +399,7 @@ void AbstractWaterfall::mouseMoveEvent(QMouseEvent* event)
         clampDemodParameters();
 
         emit newFilterFreq(m_DemodLowCutFreq, m_DemodHiCutFreq);
-        updateOverlay();
+        refreshOverlay();
       }
       else
       {
@@ -420,7 +431,7 @@ void AbstractWaterfall::mouseMoveEvent(QMouseEvent* event)
         clampDemodParameters();
 
         emit newFilterFreq(m_DemodLowCutFreq, m_DemodHiCutFreq);
-        updateOverlay();
+        refreshOverlay();
       }
       else
       {
@@ -446,7 +457,7 @@ void AbstractWaterfall::mouseMoveEvent(QMouseEvent* event)
               m_ClickResolution );
           emit newDemodFreq(m_DemodCenterFreq,
               m_DemodCenterFreq - m_CenterFreq);
-          updateOverlay();
+          refreshOverlay();
           m_PeakHoldValid = false;
         }
       }
@@ -483,8 +494,27 @@ void AbstractWaterfall::paintEvent(QPaintEvent *ev)
   qint64  StartFreq = m_CenterFreq + m_FftCenter - m_Span / 2;
   qint64  EndFreq = StartFreq + m_Span;
 
-  painter.setRenderHint(QPainter::Antialiasing);
-  painter.drawPixmap(0, 0, m_2DPixmap);
+  painter.setRenderHint(QPainter::Antialiasing, !m_interacting);
+
+  if (!m_2DPixmap.isNull()) {
+    QImage image;
+    qreal  dpr = m_2DPixmap.devicePixelRatio();
+
+    // Only converted when the pixmap changed since the last upload
+    if (m_spectrumLayer.needsUpload()) {
+      image = m_2DPixmap.toImage();
+      if (!WFTextureLayer::canUpload(image))
+        image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+
+    if (!paintTextureLayer(
+          painter,
+          m_spectrumLayer,
+          image,
+          QRectF(0, 0, m_2DPixmap.width() / dpr, m_2DPixmap.height() / dpr)))
+      painter.drawPixmap(0, 0, m_2DPixmap);
+  }
+
   this->drawWaterfall(painter);
 
   // Draw named channel cutoffs
@@ -555,6 +585,7 @@ void AbstractWaterfall::setWaterfallSpan(quint64 span_ms)
   wf_span = span_ms;
   if (m_WaterfallHeight > 0)
     msec_per_wfline = wf_span / (m_WaterfallHeight * dpi_factor);
+  m_timeHistory.clear();
   clearWaterfall();
 }
 
@@ -570,6 +601,7 @@ double AbstractWaterfall::getWfTimeRes()
 void AbstractWaterfall::setFftRate(int rate_hz)
 {
   fft_rate = rate_hz;
+  m_timeHistory.clear();
   clearWaterfall();
 }
 
@@ -619,7 +651,7 @@ void AbstractWaterfall::mousePressEvent(QMouseEvent * event)
           // setCursor(QCursor(Qt::CrossCursor));
           m_CursorCaptured = CENTER;
           m_GrabPosition = 1;
-          updateOverlay();
+          refreshOverlay();
         }
       }
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
@@ -636,14 +668,14 @@ void AbstractWaterfall::mousePressEvent(QMouseEvent * event)
           m_DemodCenterFreq = m_CenterFreq;
           emit newCenterFreq(m_CenterFreq);
           emit newDemodFreq(m_DemodCenterFreq, m_DemodCenterFreq - m_CenterFreq);
-          updateOverlay();
+          refreshOverlay();
         }
       }
       else if (event->buttons() == Qt::RightButton)
       {
         // reset frequency zoom
         resetHorizontalZoom();
-        updateOverlay();
+        refreshOverlay();
       }
     }
   }
@@ -659,7 +691,7 @@ void AbstractWaterfall::mousePressEvent(QMouseEvent * event)
       {
         // reset frequency zoom
         resetHorizontalZoom();
-        updateOverlay();
+        refreshOverlay();
       }
     }
     else if (m_CursorCaptured == BOOKMARK)
@@ -722,6 +754,8 @@ void AbstractWaterfall::mouseReleaseEvent(QMouseEvent * event)
 // Make a single zoom step on the X axis.
 void AbstractWaterfall::zoomStepX(float step, int x)
 {
+  beginInteraction();
+
   // calculate new range shown on FFT, at least 5 bins
   qint64 new_range = qBound(m_fftDataSize > 0 ? 5.0 * m_SampleFreq / m_fftDataSize : 10.0,
       (double)(m_Span) * step,
@@ -745,10 +779,10 @@ void AbstractWaterfall::zoomStepX(float step, int x)
   }
 
   qint64 fc = (f_min + f_max) / 2;
-  updateOverlay();
+  refreshOverlay();
 
   // Explicitly set m_Span instead of calling setSpanFreq(), which also calls
-  // setFftCenterFreq() and updateOverlay() internally. Span needs to be set
+  // setFftCenterFreq() and refreshOverlay() internally. Span needs to be set
   // before frequency limits can be checked in setFftCenterFreq().
   m_Span = new_range;
   setFftCenterFreq(fc - m_CenterFreq);
@@ -844,7 +878,7 @@ void AbstractWaterfall::wheelEvent(QWheelEvent * event)
     }
   }
 
-  updateOverlay();
+  refreshOverlay();
   m_CumWheelDelta = 0;
 }
 
@@ -854,8 +888,10 @@ void AbstractWaterfall::resizeEvent(QResizeEvent* event)
   qreal dpi_factor = screen()->devicePixelRatio();
 
   // mandatory to call for QOpenGLWidget to resize framebuffer
-  if (event != nullptr)
+  if (event != nullptr) {
     QOpenGLWidget::resizeEvent(event);
+    beginInteraction();
+  }
 
   if (!size().isValid())
     return;
@@ -877,7 +913,7 @@ void AbstractWaterfall::resizeEvent(QResizeEvent* event)
       msec_per_wfline = wf_span / (m_WaterfallHeight * (isHdpiAware() ? dpi_factor : 1));
   }
 
-  updateOverlay();
+  refreshOverlay();
 }
 
 void AbstractWaterfall::paintTimeStamps(
@@ -891,16 +927,21 @@ void AbstractWaterfall::paintTimeStamps(
   int items = 0;
   int leftSpacing = 0;
   qreal dpi_factor = isHdpiAware() ? screen()->devicePixelRatio() : 1;
+  qreal scale = dpi_factor * (1 << m_timeZoom);
+  qreal lines = m_TimeStampCounter;
+  qreal maxLines;
 
   auto it = m_TimeStamps.begin();
 
   painter.setFont(m_Font);
 
-  y += m_TimeStampCounter / dpi_factor;
-
   if (m_TimeStampMaxHeight < where.height())
     m_TimeStampMaxHeight = where.height();
 
+  // Keep the timestamps that the most zoomed-out level could show
+  maxLines = (m_TimeStampMaxHeight + textHeight - where.y()) * dpi_factor
+      * (1 << qMax(m_timeHistory.levels() - 1, 0));
+
   painter.setPen(m_TimeStampColor);
 
 #if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
@@ -909,7 +950,16 @@ void AbstractWaterfall::paintTimeStamps(
   leftSpacing = metrics.width("00:00:00.000");
 #endif // QT_VERSION_CHECK
 
-  while (y < m_TimeStampMaxHeight + textHeight && it != m_TimeStamps.end()) {
+  while (lines < maxLines && it != m_TimeStamps.end()) {
+    y = where.y() + SCAST(int, lines / scale);
+
+    if (y >= m_TimeStampMaxHeight + textHeight) {
+      lines += it->counter;
+      ++it;
+      ++items;
+      continue;
+    }
+
     QString const &timeStampText =
       m_TimeStampsUTC ? it->utcTimeStampText : it->timeStampText;
 #if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
@@ -929,7 +979,7 @@ void AbstractWaterfall::paintTimeStamps(
       painter.drawLine(where.x(), y, textWidth + where.x(), y);
     }
 
-    y += it->counter / dpi_factor;
+    lines += it->counter;
     ++it;
     ++items;
   }
@@ -1048,6 +1098,148 @@ void AbstractWaterfall::setNewFftData(
     int size,
     QDateTime const &t,
     bool looped)
+{
+  if (SuWidgetsRecorder::isRecording())
+    this->recordFftData(fftData, wfData, size, t, looped);
+
+  this->ingestFftData(fftData, wfData, size, t, looped);
+}
+
+/**
+ * Set new FFT data as linear power.
+ * @param power Pointer to the FFT bins, in linear power units.
+ * @param size The FFT size.
+ * @param offsetDb Gain (in dB) applied after the conversion to dB.
+ *
+ * The conversion to dB is done by the widget (see
+ * SuWidgetsKernels::powerToDb), and waterfall lines are averaged in
+ * linear power.
+ */
+void AbstractWaterfall::setNewPowerFftData(
+    const float *power,
+    int size,
+    float offsetDb,
+    QDateTime const &t,
+    bool looped)
+{
+  float *acc = this->prepareLinearFftData(size, offsetDb);
+
+  SuWidgetsKernels::powerToDb(
+        m_linearDb.data(),
+        power,
+        offsetDb,
+        SCAST(SUSCOUNT, size),
+        acc);
+
+  this->ingestLinearFftData(size, acc != nullptr, t, looped);
+}
+
+/**
+ * Set new FFT data as raw complex bins. The power of each bin is |X|^2.
+ * @see setNewPowerFftData
+ */
+void AbstractWaterfall::setNewComplexFftData(
+    const SUCOMPLEX *bins,
+    int size,
+    float offsetDb,
+    QDateTime const &t,
+    bool looped)
+{
+  float *acc = this->prepareLinearFftData(size, offsetDb);
+
+  SuWidgetsKernels::complexToDb(
+        m_linearDb.data(),
+        bins,
+        offsetDb,
+        SCAST(SUSCOUNT, size),
+        acc);
+
+  this->ingestLinearFftData(size, acc != nullptr, t, looped);
+}
+
+//
+// Returns the linear accumulator to add the new FFT to, if waterfall
+// lines are being averaged.
+//
+float *AbstractWaterfall::prepareLinearFftData(int size, float offsetDb)
+{
+  size_t len = SCAST(size_t, qMax(size, 0));
+
+  m_linearDb.resize(len);
+
+  if (msec_per_wfline <= 0)
+    return nullptr;
+
+  if (!m_accumLinear
+      || m_accum.size() != len
+      || m_linearOffsetDb != offsetDb) {
+    m_accum.resize(len);
+    this->resetFftAccumulator();
+    m_accumLinear    = true;
+    m_linearOffsetDb = offsetDb;
+  }
+
+  return m_accum.data();
+}
+
+void AbstractWaterfall::ingestLinearFftData(
+    int size,
+    bool accumulated,
+    QDateTime const &t,
+    bool looped)
+{
+  if (accumulated)
+    m_samplesInAccum++;
+
+  // Recorded already converted to dB
+  if (SuWidgetsRecorder::isRecording())
+    this->recordFftData(m_linearDb.data(), m_linearDb.data(), size, t, looped);
+
+  this->ingestFftData(
+        m_linearDb.data(),
+        m_linearDb.data(),
+        size,
+        t,
+        looped,
+        accumulated);
+}
+
+void AbstractWaterfall::recordFftData(
+    const float *fftData,
+    const float *wfData,
+    int size,
+    QDateTime const &t,
+    bool looped)
+{
+  if (size > 0) {
+    bool separate = wfData != nullptr && wfData != fftData;
+    std::vector<float> payload(fftData, fftData + size);
+    qint64 args[] = {
+      size,
+      t.toMSecsSinceEpoch(),
+      looped,
+      separate};
+
+    if (separate)
+      payload.insert(payload.end(), wfData, wfData + size);
+
+    SuWidgetsRecorder::record(
+          this,
+          SUWIDGETS_TRACE_WATERFALL_FFT,
+          payload.data(),
+          payload.size() * sizeof(float),
+          args,
+          4);
+  }
+}
+
+void AbstractWaterfall::ingestFftData(
+    const float *fftData,
+    const float *wfData,
+    int size,
+    QDateTime const &t,
+    bool looped,
+    bool accumulated)
 {
   bool shouldAddTimestamp = false;
 
@@ -1061,6 +1253,12 @@ void AbstractWaterfall::setNewFftData(
   m_fftDataSize = size;
   m_lastFft = t;
 
+  if ((m_levelEstimation || m_autoRange) && fftData != nullptr) {
+    m_levelEstimator.feed(fftData, size);
+    if (m_autoRange)
+      this->applyAutoRange();
+  }
+
   if (m_tentativeCenterFreq != 0) {
     m_tentativeCenterFreq = 0;
     m_DrawOverlay = true;
@@ -1068,7 +1266,8 @@ void AbstractWaterfall::setNewFftData(
 
   if (wfData != nullptr && size > 0) {
     if (msec_per_wfline > 0) {
-      this->accumulateFftData(wfData, size);
+      if (!accumulated)
+        this->accumulateFftData(wfData, size);
 
       if (tnow_ms < tlast_wf_ms || tnow_ms - tlast_wf_ms >= msec_per_wfline) {
         int line_count = (tnow_ms - tlast_wf_ms) / msec_per_wfline;
@@ -1078,15 +1277,14 @@ void AbstractWaterfall::setNewFftData(
           line_count = 1;
           tlast_wf_ms = tnow_ms;
         }
-        this->averageFftData();
-        this->addNewWfLine(m_accum.data(), size, line_count);
+        this->pushWfLine(this->averageFftData(), size, line_count);
         shouldAddTimestamp = true;
         this->resetFftAccumulator();
         m_TimeStampCounter += line_count;
       }
     } else {
       tlast_wf_ms = tnow_ms;
-      this->addNewWfLine(wfData, size, 1);
+      this->pushWfLine(wfData, size, 1);
       shouldAddTimestamp = true;
       ++m_TimeStampCounter;
     }
@@ -1129,6 +1327,25 @@ void AbstractWaterfall::setNewPartialFftData(
     QDateTime const &t,
     bool looped)
 {
+  if (SuWidgetsRecorder::isRecording() && size > 0) {
+    qint64 args[] = {
+      size,
+      startFreq,
+      endFreq,
+      t.toMSecsSinceEpoch(),
+      looped,
+      m_CenterFreq,
+      SCAST(qint64, m_SampleFreq)};
+
+    SuWidgetsRecorder::record(
+          this,
+          SUWIDGETS_TRACE_WATERFALL_PARTIAL_FFT,
+          fftData,
+          SCAST(quint64, size) * sizeof(float),
+          args,
+          7);
+  }
+
   if (!m_partialFreqActive) {
     size_t k = 1;
     size_t full_size = size * m_SampleFreq / (endFreq - startFreq);
@@ -1185,7 +1402,13 @@ void AbstractWaterfall::setNewPartialFftData(
     m_fullFftData[i] = accum / count;
   }
 
-  setNewFftData(m_fullFftData.data(), m_fullFftData.size(), t, looped);
+  // Not recorded again: the partial update already was
+  ingestFftData(
+        m_fullFftData.data(),
+        m_fullFftData.data(),
+        m_fullFftData.size(),
+        t,
+        looped);
 }
 
 void AbstractWaterfall::clearPartialFftData()
@@ -1335,7 +1558,7 @@ void AbstractWaterfall::setPandapterRange(float min, float max)
 
   m_PandMindB = min;
   m_PandMaxdB = max;
-  updateOverlay();
+  refreshOverlay();
   m_PeakHoldValid = false;
 }
 
@@ -1352,13 +1575,15 @@ void AbstractWaterfall::setWaterfallRange(float min, float max)
 void AbstractWaterfall::setInfoText(QString const &text)
 {
   m_infoText = text;
-  updateOverlay();
+  invalidateOverlayLayers(OVERLAY_LAYER_MASK(OVERLAY_LAYER_DYNAMIC));
+  refreshOverlay();
 }
 
 void AbstractWaterfall::setInfoTextColor(QColor const &color)
 {
   m_infoTextColor = color;
-  updateOverlay();
+  invalidateOverlayLayers(OVERLAY_LAYER_MASK(OVERLAY_LAYER_DYNAMIC));
+  refreshOverlay();
 }
 
   static QString
@@ -1539,7 +1764,7 @@ void AbstractWaterfall::setDemodRanges(qint64 FLowCmin, qint64 FLowCmax,
   m_FHiCmax=FHiCmax;
   m_symetric=symetric;
   clampDemodParameters();
-  updateOverlay();
+  refreshOverlay();
 }
 
 void AbstractWaterfall::setCenterFreq(qint64 f)
@@ -1552,7 +1777,7 @@ void AbstractWaterfall::setCenterFreq(qint64 f)
   m_tentativeCenterFreq += f - m_CenterFreq;
   m_CenterFreq = f;
 
-  updateOverlay();
+  refreshOverlay();
 
   m_PeakHoldValid = false;
 }
@@ -1601,7 +1826,8 @@ void AbstractWaterfall::removeChannel(NamedChannelSetIterator it)
 {
   m_channelSet.remove(it);
 
-  updateOverlay();
+  invalidateOverlayLayers(OVERLAY_LAYER_MASK(OVERLAY_LAYER_CHANNELS));
+  refreshOverlay();
 }
 
 void AbstractWaterfall::refreshChannel(NamedChannelSetIterator &it)
@@ -1610,7 +1836,8 @@ void AbstractWaterfall::refreshChannel(NamedChannelSetIterator &it)
   if (m_channelSet.isOutOfPlace(it))
     it = m_channelSet.relocate(it);
 
-  updateOverlay();
+  invalidateOverlayLayers(OVERLAY_LAYER_MASK(OVERLAY_LAYER_CHANNELS));
+  refreshOverlay();
 }
 
 NamedChannelSetIterator AbstractWaterfall::findChannel(qint64 freq)
@@ -1629,14 +1856,67 @@ NamedChannelSetIterator AbstractWaterfall::channelCEnd() const
 }
 
 
-// Ensure overlay is updated by either scheduling or forcing a redraw
-void AbstractWaterfall::updateOverlay()
+// Ensure overlay is updated by either scheduling or forcing a redraw. Only
+// the layers whose keys changed will be redrawn.
+void AbstractWaterfall::refreshOverlay()
 {
   m_DrawOverlay = true;
 
-  // draw immediately if there won't be new FFT data coming soon to triger redraw
-  if (!m_Running || this->slow())
-    draw();
+  // draw immediately if there won't be new FFT data coming soon to triger redraw.
+  // While interacting, all the refreshes until the next event loop
+  // iteration are coalesced into one.
+  if (!m_Running || this->slow()) {
+    if (!m_interacting) {
+      draw();
+    } else if (!m_drawScheduled) {
+      m_drawScheduled = true;
+      QTimer::singleShot(0, this, SLOT(onScheduledDraw()));
+    }
+  }
+}
+
+/**
+ * Enter interaction mode (resize, zoom...) until no new interaction happens
+ * for the idle time. Meanwhile overlay redraws are coalesced, antialiasing
+ * is disabled and resized images are scaled with the fast transformation.
+ */
+void AbstractWaterfall::beginInteraction()
+{
+  m_interacting = true;
+  m_interactionTimer.start();
+}
+
+void AbstractWaterfall::setInteractionIdleTime(int ms)
+{
+  m_interactionTimer.setInterval(ms);
+}
+
+void AbstractWaterfall::onInteractionTimeout()
+{
+  // Full-quality redraw
+  m_interacting = false;
+  refreshOverlay();
+  update();
+}
+
+void AbstractWaterfall::onScheduledDraw()
+{
+  m_drawScheduled = false;
+  draw();
+}
+
+// Force a redraw of all overlay layers
+void AbstractWaterfall::updateOverlay()
+{
+  invalidateOverlayLayers(OVERLAY_ALL_LAYERS);
+  refreshOverlay();
+}
+
+// Bookmarks changed in the bookmark source, query them again
+void AbstractWaterfall::updateBookmarks()
+{
+  invalidateOverlayLayers(OVERLAY_LAYER_MASK(OVERLAY_LAYER_BOOKMARKS));
+  refreshOverlay();
 }
 
 /** Reset horizontal zoom to 100% and centered around 0. */
@@ -1652,7 +1932,7 @@ void AbstractWaterfall::resetHorizontalZoom()
 void AbstractWaterfall::moveToCenterFreq()
 {
   setFftCenterFreq(0);
-  updateOverlay();
+  refreshOverlay();
   m_PeakHoldValid = false;
 }
 
@@ -1660,7 +1940,7 @@ void AbstractWaterfall::moveToCenterFreq()
 void AbstractWaterfall::moveToDemodFreq()
 {
   setFftCenterFreq(m_DemodCenterFreq-m_CenterFreq);
-  updateOverlay();
+  refreshOverlay();
 
   m_PeakHoldValid = false;
 }
@@ -1673,28 +1953,29 @@ void AbstractWaterfall::setFftPlotColor(const QColor color)
   m_FftFillCol.setAlpha(0x1A);
   m_PeakHoldColor = color;
   m_PeakHoldColor.setAlpha(60);
-  updateOverlay();
+  refreshOverlay();
 }
 
 /** Set filter box color */
 void AbstractWaterfall::setFilterBoxColor(const QColor color)
 {
   m_FilterBoxColor = color;
-  updateOverlay();
+  refreshOverlay();
 }
 
 /** Set timestamp color */
 void AbstractWaterfall::setTimeStampColor(const QColor color)
 {
   m_TimeStampColor = color;
-  updateOverlay();
+  refreshOverlay();
 }
 
 /** Set FFT bg color. */
 void AbstractWaterfall::setFftBgColor(const QColor color)
 {
   m_FftBgColor = color;
-  updateOverlay();
+  invalidateOverlayLayers(OVERLAY_LAYER_MASK(OVERLAY_LAYER_GRID));
+  refreshOverlay();
 }
 
 /** Set FFT axes color. */
@@ -1702,13 +1983,17 @@ void AbstractWaterfall::setFftAxesColor(const QColor color)
 {
   m_FftCenterAxisColor = color;
   m_FftAxesColor = color;
+  invalidateOverlayLayers(OVERLAY_LAYER_MASK(OVERLAY_LAYER_GRID));
 }
 
 /** Set FFT text color. */
 void AbstractWaterfall::setFftTextColor(const QColor color)
 {
   m_FftTextColor = color;
-  updateOverlay();
+  invalidateOverlayLayers(
+      OVERLAY_LAYER_MASK(OVERLAY_LAYER_GRID)
+      | OVERLAY_LAYER_MASK(OVERLAY_LAYER_FATS));
+  refreshOverlay();
 }
 
 /** Enable/disable filling the area below the FFT plot. */
@@ -1785,8 +2070,10 @@ void AbstractWaterfall::pushFAT(const FrequencyAllocationTable *fat)
 {
   this->m_FATs[fat->getName()] = fat;
 
+  this->invalidateOverlayLayers(OVERLAY_LAYER_MASK(OVERLAY_LAYER_FATS));
+
   if (this->m_ShowFATs)
-    this->updateOverlay();
+    this->refreshOverlay();
 }
 
 bool AbstractWaterfall::removeFAT(std::string const &name)
@@ -1798,8 +2085,10 @@ bool AbstractWaterfall::removeFAT(std::string const &name)
 
   this->m_FATs.erase(p);
 
+  this->invalidateOverlayLayers(OVERLAY_LAYER_MASK(OVERLAY_LAYER_FATS));
+
   if (this->m_ShowFATs)
-    this->updateOverlay();
+    this->refreshOverlay();
 
   return true;
 }
@@ -1807,7 +2096,7 @@ bool AbstractWaterfall::removeFAT(std::string const &name)
 void AbstractWaterfall::setFATsVisible(bool visible)
 {
   this->m_ShowFATs = visible;
-  this->updateOverlay();
+  this->refreshOverlay();
 }
 
 int AbstractWaterfall::drawFATs(
@@ -1823,14 +2112,11 @@ int AbstractWaterfall::drawFATs(
 
   for (auto fat : m_FATs) {
     if (fat.second != nullptr) {
-      FrequencyBandIterator p = fat.second->find(StartFreq);
-
-      while (p != fat.second->cbegin() && p->second.max > StartFreq)
-        --p;
+      fat.second->findBands(StartFreq, EndFreq, m_FATBands);
 
-      for (; p != fat.second->cend() && p->second.min < EndFreq; ++p) {
-        int x0 = xFromFreq(p->second.min);
-        int x1 = xFromFreq(p->second.max);
+      for (auto const &band : m_FATBands) {
+        int x0 = xFromFreq(band.min);
+        int x1 = xFromFreq(band.max);
         bool leftborder = true;
         bool rightborder = true;
         int tw, boxw;
@@ -1851,8 +2137,8 @@ int AbstractWaterfall::drawFATs(
 
         boxw = x1 - x0;
 
-        ctx.painter->setBrush(QBrush(p->second.color));
-        ctx.painter->setPen(p->second.color);
+        ctx.painter->setBrush(QBrush(band.color));
+        ctx.painter->setPen(band.color);
 
         ctx.painter->drawRect(
             x0,
@@ -1875,7 +2161,7 @@ int AbstractWaterfall::drawFATs(
               h);
 
         label = ctx.metrics->elidedText(
-            QString::fromStdString(p->second.primary),
+            QString::fromStdString(band.primary),
             Qt::ElideRight,
             boxw);
 
@@ -2017,6 +2303,7 @@ void AbstractWaterfall::drawAxes(DrawingContext &ctx, qint64 StartFreq, qint64 E
   m_XAxisYCenter = h - ctx.metrics->height() / 2;
   int xAxisHeight = ctx.metrics->height() + 2 * VER_MARGIN;
   int xAxisTop = h - xAxisHeight;
+  m_XAxisTop = xAxisTop;
   int fLabelTop = xAxisTop + VER_MARGIN;
 
   if (m_CenterLineEnabled) {
@@ -2135,137 +2422,557 @@ void AbstractWaterfall::drawAxes(DrawingContext &ctx, qint64 StartFreq, qint64 E
   // Draw unit name on top left corner
   rect.setRect(HOR_MARGIN, 0, unitWidth, th);
   ctx.painter->drawText(rect, Qt::AlignRight|Qt::AlignVCenter, m_unitName);
+}
+
+void AbstractWaterfall::drawChannelBoxes(
+    DrawingContext &ctx,
+    qint64 StartFreq,
+    qint64 EndFreq,
+    int bandY)
+{
+  for (auto i = m_channelSet.find(StartFreq - m_Span); i != m_channelSet.cend(); ++i) {
+    auto p = i.value();
+    int x_fCenter = xFromFreq(p->frequency);
+    int x_fMin = xFromFreq(p->frequency + p->lowFreqCut);
+    int x_fMax = xFromFreq(p->frequency + p->highFreqCut);
+
+    if (p->frequency + p->highFreqCut < StartFreq)
+      continue;
+
+    if (EndFreq < p->frequency + p->lowFreqCut)
+      break;
+
+    if (p->bandLike) {
+      WFHelpers::drawChannelBox(
+          *ctx.painter,
+          ctx.height,
+          x_fMin,
+          x_fMax,
+          x_fCenter,
+          p->boxColor,
+          p->markerColor,
+          p->name,
+          p->markerColor,
+          ctx.metrics->height() / 2,
+          bandY + p->nestLevel * ctx.metrics->height());
+    } else {
+      WFHelpers::drawChannelBox(
+          *ctx.painter,
+          ctx.height,
+          x_fMin,
+          x_fMax,
+          x_fCenter,
+          p->boxColor,
+          p->markerColor,
+          p->name,
+          QColor(),
+          -1,
+          bandY + p->nestLevel * ctx.metrics->height());
+    }
+  }
+}
+
+void AbstractWaterfall::drawInfoText(DrawingContext &ctx)
+{
+  int flags = Qt::AlignRight |  Qt::AlignTop | Qt::TextWordWrap;
+  QRectF pixRect = QRectF(0, 0, ctx.width, ctx.height);
+
+  pixRect.setWidth(pixRect.width() - 10);
+
+  QRectF rect = ctx.painter->boundingRect(
+      pixRect,
+      flags,
+      m_infoText);
+
+  rect.setX(pixRect.width() - rect.width());
+  rect.setY(0);
+
+  ctx.painter->setPen(QPen(m_infoTextColor, 2, Qt::SolidLine));
+  ctx.painter->drawText(rect, flags, m_infoText);
+}
+
+// Build the key that identifies the contents of an overlay layer. If the
+// key of a layer does not change, its cached pixmap can be reused as is.
+void AbstractWaterfall::makeOverlayLayerKey(
+    int layer,
+    OverlayLayerKey &key,
+    qint64 StartFreq,
+    qint64 EndFreq)
+{
+  QFontMetrics metrics(m_Font);
 
-  if (m_BookmarksEnabled && m_BookmarkSource != nullptr)
-    this->drawBookmarks(ctx, StartFreq, EndFreq, xAxisTop);
+  key = OverlayLayerKey();
+
+  key.width  = m_Size.width();
+  key.height = m_SpectrumPlotHeight;
+
+  switch (layer) {
+    case OVERLAY_LAYER_GRID:
+      key.startFreq = StartFreq;
+      key.endFreq   = EndFreq;
+      key.params[0] = m_PandMindB;
+      key.params[1] = m_PandMaxdB;
+      key.params[2] = m_ZeroPoint;
+      key.params[3] = m_dBPerUnit;
+      key.params[4] = m_CenterLineEnabled
+          ? SCAST(qreal, m_CenterFreq - m_tentativeCenterFreq)
+          : 0;
+      break;
+
+    case OVERLAY_LAYER_BOOKMARKS:
+      key.startFreq = StartFreq;
+      key.endFreq   = EndFreq;
+      key.params[0] = SCAST(qreal, m_FATs.size()) * metrics.height();
+      key.params[1] = m_XAxisTop;
+      break;
+
+    case OVERLAY_LAYER_FATS:
+      key.startFreq = StartFreq;
+      key.endFreq   = EndFreq;
+      key.params[0] = m_YAxisWidth;
+      key.params[1] = m_ShowFATs;
+      break;
+
+    case OVERLAY_LAYER_CHANNELS:
+      key.startFreq = StartFreq;
+      key.endFreq   = EndFreq;
+      key.params[0] = m_FATBandY;
+      break;
+
+    case OVERLAY_LAYER_DYNAMIC:
+      // Info text does not depend on the frequency range
+      break;
+  }
+}
+
+void AbstractWaterfall::drawOverlayLayer(
+    int layer,
+    DrawingContext &ctx,
+    qint64 StartFreq,
+    qint64 EndFreq)
+{
+  switch (layer) {
+    case OVERLAY_LAYER_GRID:
+      this->drawAxes(ctx, StartFreq, EndFreq);
+      break;
+
+    case OVERLAY_LAYER_BOOKMARKS:
+      if (m_BookmarksEnabled && m_BookmarkSource != nullptr)
+        this->drawBookmarks(ctx, StartFreq, EndFreq, m_XAxisTop);
+      else
+        m_BookmarkTags.clear();
+      break;
+
+    case OVERLAY_LAYER_FATS:
+      m_FATBandY = m_ShowFATs ? this->drawFATs(ctx, StartFreq, EndFreq) : 0;
+      break;
+
+    case OVERLAY_LAYER_CHANNELS:
+      if (m_channelsEnabled)
+        this->drawChannelBoxes(ctx, StartFreq, EndFreq, m_FATBandY);
+      break;
+
+    case OVERLAY_LAYER_DYNAMIC:
+      if (!m_infoText.isEmpty())
+        this->drawInfoText(ctx);
+      break;
+  }
 }
 
 // Called to draw an overlay bitmap containing grid and text that
-// does not need to be recreated every fft data update.
+// does not need to be recreated every fft data update. The overlay is
+// composed from cached layers, and only those layers whose inputs have
+// changed since the last call are redrawn.
 void AbstractWaterfall::drawOverlay()
 {
   if (m_OverlayPixmap.isNull())
     return;
 
-  int             bandY = 0;
   QFontMetrics    metrics(m_Font);
-  QPainter        painter(&m_OverlayPixmap);
   DrawingContext  ctx;
+  OverlayLayerKey key;
+  bool            recompose = false;
 
   qint64  StartFreq = m_CenterFreq + m_FftCenter - m_Span / 2;
   qint64  EndFreq = StartFreq + m_Span;
 
-  ctx.painter = &painter;
   ctx.metrics = &metrics;
   ctx.width   = m_Size.width();
   ctx.height  = m_SpectrumPlotHeight;
 
-  painter.setFont(m_Font);
+  // Layers are evaluated in composition order, as the keys of the upper
+  // layers depend on values computed while drawing the lower ones.
+  for (int i = 0; i < OVERLAY_LAYER_COUNT; ++i) {
+    OverlayLayer &layer = m_OverlayLayers[i];
 
-  // Draw axes
-  this->drawAxes(ctx, StartFreq, EndFreq);
+    this->makeOverlayLayerKey(i, key, StartFreq, EndFreq);
 
-  // Draw frequency allocation tables
-  if (m_ShowFATs)
-    bandY = this->drawFATs(ctx, StartFreq, EndFreq);
+    if (!layer.dirty && layer.key == key && !layer.pixmap.isNull())
+      continue;
 
-  // Draw named channel (boxes)
+    if (layer.pixmap.size() != m_OverlayPixmap.size()) {
+      layer.pixmap = QPixmap(m_OverlayPixmap.size());
+      layer.pixmap.setDevicePixelRatio(m_OverlayPixmap.devicePixelRatio());
+    }
 
-  if (m_channelsEnabled) {
-    for (auto i = m_channelSet.find(StartFreq - m_Span); i != m_channelSet.cend(); ++i) {
-      auto p = i.value();
-      int x_fCenter = xFromFreq(p->frequency);
-      int x_fMin = xFromFreq(p->frequency + p->lowFreqCut);
-      int x_fMax = xFromFreq(p->frequency + p->highFreqCut);
+    layer.pixmap.fill(Qt::transparent);
 
-      if (p->frequency + p->highFreqCut < StartFreq)
-        continue;
+    QPainter painter(&layer.pixmap);
+    ctx.painter = &painter;
+    painter.setFont(m_Font);
+    this->drawOverlayLayer(i, ctx, StartFreq, EndFreq);
+    painter.end();
 
-      if (EndFreq < p->frequency + p->lowFreqCut)
-        break;
+    layer.key   = key;
+    layer.dirty = false;
+    recompose   = true;
+  }
 
-      if (p->bandLike) {
-        WFHelpers::drawChannelBox(
-            painter,
-            ctx.height,
-            x_fMin,
-            x_fMax,
-            x_fCenter,
-            p->boxColor,
-            p->markerColor,
-            p->name,
-            p->markerColor,
-            ctx.metrics->height() / 2,
-            bandY + p->nestLevel * ctx.metrics->height());
-      } else {
-        WFHelpers::drawChannelBox(
-            painter,
-            ctx.height,
-            x_fMin,
-            x_fMax,
-            x_fCenter,
-            p->boxColor,
-            p->markerColor,
-            p->name,
-            QColor(),
-            -1,
-            bandY + p->nestLevel * ctx.metrics->height());
-      }
+  if (recompose) {
+    QPainter painter(&m_OverlayPixmap);
+
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.drawPixmap(0, 0, m_OverlayLayers[OVERLAY_LAYER_GRID].pixmap);
+    painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+
+    for (int i = OVERLAY_LAYER_GRID + 1; i < OVERLAY_LAYER_COUNT; ++i)
+      painter.drawPixmap(0, 0, m_OverlayLayers[i].pixmap);
+
+    painter.end();
+  }
+}
+
+void AbstractWaterfall::memoryUsage(SuWidgetsMemoryUsage &usage) const
+{
+  usage[SUWIDGETS_MEMORY_ACCUMULATORS] +=
+        (m_accum.capacity()
+         + m_accumDb.capacity()
+         + m_linearDb.capacity()
+         + m_fullFftData.capacity()) * sizeof(float);
+  usage[SUWIDGETS_MEMORY_ACCUMULATORS] += m_levelEstimator.memoryUsage();
+  usage[SUWIDGETS_MEMORY_HISTORIES] += m_timeHistory.memoryUsage()
+      + m_timeExpanded.capacity() * sizeof(float);
+  usage[SUWIDGETS_MEMORY_TEXTURES]  +=
+        m_spectrumLayer.memoryUsage() + m_waterfallLayer.memoryUsage();
+  usage[SUWIDGETS_MEMORY_IMAGES] +=
+        SuWidgetsMemory::pixmapBytes(m_2DPixmap)
+      + SuWidgetsMemory::pixmapBytes(m_OverlayPixmap);
+}
+
+/**
+ * Paint an image through a persistent texture. Returns false if it could
+ * not be done (e.g. unsupported image format), in which case the caller
+ * falls back to QPainter. Target coordinates are in logical pixels.
+ */
+bool AbstractWaterfall::paintTextureLayer(
+    QPainter &painter,
+    WFTextureLayer &layer,
+    QImage const &image,
+    QRectF const &target)
+{
+  QOpenGLContext *ctx = context();
+  qreal dpr = devicePixelRatioF();
+  QRect viewport(
+        0,
+        0,
+        SCAST(int, width() * dpr),
+        SCAST(int, height() * dpr));
+  bool ok = false;
+
+  if (m_textureLayersFailed || ctx == nullptr)
+    return false;
+
+  painter.beginNativePainting();
+
+  if (!m_blitter.isCreated()) {
+    if (m_blitter.create())
+      connect(
+            ctx,
+            SIGNAL(aboutToBeDestroyed()),
+            this,
+            SLOT(releaseTextureLayers()),
+            Qt::UniqueConnection);
+    else
+      m_textureLayersFailed = true;
+  }
+
+  if (m_blitter.isCreated() && layer.upload(ctx->functions(), image)) {
+    ctx->functions()->glViewport(0, 0, viewport.width(), viewport.height());
+    layer.render(
+          m_blitter,
+          QRectF(
+            target.x() * dpr,
+            target.y() * dpr,
+            target.width() * dpr,
+            target.height() * dpr),
+          viewport);
+    ok = true;
+  }
+
+  painter.endNativePainting();
+
+  return ok;
+}
+
+void AbstractWaterfall::releaseTextureLayers()
+{
+  if (context() == nullptr)
+    return;
+
+  makeCurrent();
+  m_spectrumLayer.release();
+  m_waterfallLayer.release();
+  if (m_blitter.isCreated())
+    m_blitter.destroy();
+  doneCurrent();
+}
+
+//
+// Histories: the most zoomed-out level of the time history is dropped
+//
+quint64 AbstractWaterfall::reclaimMemory(
+    SuWidgetsMemoryCategory category,
+    quint64 bytes)
+{
+  quint64 freed = 0;
+
+  if (category != SUWIDGETS_MEMORY_HISTORIES)
+    return 0;
+
+  while (freed < bytes && m_timeHistory.levels() > 1) {
+    quint64 before = m_timeHistory.memoryUsage();
+
+    m_timeHistory.dropLevel();
+    freed += before - m_timeHistory.memoryUsage();
+  }
+
+  if (m_timeZoom >= m_timeHistory.levels())
+    setTimeZoom(m_timeHistory.levels() - 1);
+
+  return freed;
+}
+
+/**
+ * Enable the noise floor and peak level estimation. It is also enabled
+ * while auto-range is on.
+ * @see getNoiseFloor
+ * @see getPeakLevel
+ */
+void AbstractWaterfall::setLevelEstimation(bool enabled)
+{
+  if (enabled != m_levelEstimation) {
+    m_levelEstimation = enabled;
+    if (!m_autoRange)
+      m_levelEstimator.reset();
+  }
+}
+
+/**
+ * Let the widget set the pandapter and waterfall ranges from the
+ * estimated noise floor and peak level.
+ */
+void AbstractWaterfall::setAutoRange(bool enabled)
+{
+  if (enabled != m_autoRange) {
+    m_autoRange = enabled;
+    if (!m_levelEstimation)
+      m_levelEstimator.reset();
+  }
+}
+
+/**
+ * Set the minimum change (in dB) of either end of the range that makes
+ * the auto-range update it.
+ */
+void AbstractWaterfall::setAutoRangeHysteresis(float db)
+{
+  m_autoRangeHysteresis = qMax(db, 0.f);
+}
+
+float AbstractWaterfall::getNoiseFloor()
+{
+  return m_levelEstimator.noiseFloor();
+}
+
+float AbstractWaterfall::getPeakLevel()
+{
+  return m_levelEstimator.peakLevel();
+}
+
+void AbstractWaterfall::applyAutoRange()
+{
+  float min = m_levelEstimator.noiseFloor() - WF_AUTO_RANGE_FLOOR_MARGIN_DB;
+  float max = m_levelEstimator.peakLevel()  + WF_AUTO_RANGE_PEAK_MARGIN_DB;
+
+  min = qBound(FFT_MIN_DB, min, FFT_MAX_DB);
+  max = qBound(FFT_MIN_DB, max, FFT_MAX_DB);
+
+  if (max - min < 2 * m_autoRangeHysteresis)
+    return;
+
+  if (fabsf(min - m_PandMindB) < m_autoRangeHysteresis
+      && fabsf(max - m_PandMaxdB) < m_autoRangeHysteresis)
+    return;
+
+  setPandapterRange(min, max);
+  setWaterfallRange(min, max);
+  emit pandapterRangeChanged(m_PandMindB, m_PandMaxdB);
+}
+
+/**
+ * Enable the time-axis zoom.
+ * @param levels Number of zoom levels (the last one shows 2^(levels - 1)
+ * lines per row). 0 disables the time history.
+ * @param rows Rows kept by every level.
+ */
+void AbstractWaterfall::setTimeHistory(int levels, int rows)
+{
+  m_timeHistory.configure(levels, rows);
+
+  if (m_timeZoom > 0)
+    setTimeZoom(0);
+}
+
+/**
+ * Zoom the time axis out, so that every waterfall row shows 2^level lines.
+ * The waterfall is redrawn from the time history.
+ */
+void AbstractWaterfall::setTimeZoom(int level)
+{
+  level = qBound(0, level, qMax(m_timeHistory.levels() - 1, 0));
+
+  if (level != m_timeZoom) {
+    m_timeZoom = level;
+    redrawWaterfallHistory();
+    update();
+  }
+}
+
+void AbstractWaterfall::setTimeReduction(WaterfallTimeReduction reduction)
+{
+  if (reduction != m_timeReduction) {
+    m_timeReduction = reduction;
+    if (m_timeZoom > 0) {
+      redrawWaterfallHistory();
+      update();
     }
   }
+}
+
+/**
+ * Default history redraw: replays the visible rows of the current zoom
+ * level through addNewWfLine(), oldest first. At zoom 0, live lines are
+ * drawn at their own width, so reduced rows are expanded back to it: a
+ * change of width would reset the GL waterfall on the next line.
+ */
+void AbstractWaterfall::redrawWaterfallHistory()
+{
+  int width, size, age;
+  bool expand;
 
-  // Draw info text (if enabled)
-  if (!m_infoText.isEmpty()) {
-    int flags = Qt::AlignRight |  Qt::AlignTop | Qt::TextWordWrap;
-    QRectF pixRect = m_OverlayPixmap.rect();
+  if (!m_timeHistory.enabled())
+    return;
+
+  clearWaterfall();
 
-    pixRect.setWidth(pixRect.width() - 10);
+  width  = m_timeHistory.width();
+  size   = m_timeLineWidth;
+  expand = m_timeZoom == 0 && size > width;
+  age    = qMin(m_timeHistory.available(m_timeZoom), m_timeHistory.rows());
 
-    QRectF rect = painter.boundingRect(
-        pixRect,
-        flags,
-        m_infoText);
+  if (expand)
+    m_timeExpanded.resize(SCAST(size_t, size));
 
-    rect.setX(pixRect.width() - rect.width());
-    rect.setY(0);
+  while (age-- > 0) {
+    const float *row = m_timeHistory.row(m_timeZoom, age, m_timeReduction);
 
-    painter.setPen(QPen(m_infoTextColor, 2, Qt::SolidLine));
-    painter.drawText(rect, flags, m_infoText);
+    if (expand) {
+      // Every bin takes the value of the group it was reduced into
+      for (int i = 0; i < size; ++i)
+        m_timeExpanded[SCAST(size_t, i)] =
+            row[SCAST(qint64, i) * width / size];
+
+      addNewWfLine(m_timeExpanded.data(), size, 1);
+    } else {
+      addNewWfLine(row, width, 1);
+    }
   }
+}
 
-  painter.end();
+/**
+ * Add waterfall lines. With the time history enabled, lines go through it
+ * and, when zoomed out, the waterfall only scrolls when a row of the
+ * current zoom level is completed. At zoom 0 lines are drawn as they come:
+ * history rows are reduced to WATERFALL_HISTORY_MAX_WIDTH bins.
+ */
+void AbstractWaterfall::pushWfLine(const float *wfData, int size, int repeats)
+{
+  int rows = 0;
+
+  if (!m_timeHistory.enabled()) {
+    addNewWfLine(wfData, size, repeats);
+    return;
+  }
+
+  m_timeLineWidth = size;
+
+  for (int i = 0; i < repeats; ++i)
+    if (m_timeHistory.push(wfData, size) >= m_timeZoom)
+      ++rows;
+
+  if (m_timeZoom == 0) {
+    addNewWfLine(wfData, size, repeats);
+    return;
+  }
+
+  rows = qMin(rows, m_timeHistory.available(m_timeZoom));
+
+  while (rows-- > 0)
+    addNewWfLine(
+          m_timeHistory.row(m_timeZoom, rows, m_timeReduction),
+          m_timeHistory.width(),
+          1);
 }
 
 void AbstractWaterfall::accumulateFftData(const float *fftData, int size)
 {
-  int i;
-
-  if (m_accum.size() != static_cast<size_t>(size)) {
+  if (m_accumLinear || m_accum.size() != static_cast<size_t>(size)) {
     m_accum.resize(static_cast<size_t>(size));
     this->resetFftAccumulator();
+    m_accumLinear = false;
   }
 
   if (m_samplesInAccum == 0) {
     std::memcpy(m_accum.data(), fftData, size * sizeof(float));
   } else {
-    for (i = 0; i < size; ++i)
-      m_accum[i] += fftData[i];
+    SuWidgetsKernels::accumulate(m_accum.data(), fftData, SCAST(SUSCOUNT, size));
   }
 
   m_samplesInAccum++;
 }
 
-void AbstractWaterfall::averageFftData()
+// Returns the averaged line, in dB
+const float *AbstractWaterfall::averageFftData()
 {
-  if (m_samplesInAccum == 0)
-    return;
+  if (m_samplesInAccum > 0) {
+    float f = 1.0f / m_samplesInAccum;
+    SuWidgetsKernels::scale(m_accum.data(), f, m_accum.size());
+
+    // avoids repeated calls causing issues
+    m_samplesInAccum = 1;
+  }
 
-  float f = 1.0f / m_samplesInAccum;
-  for (size_t i = 0; i < m_accum.size(); i++)
-    m_accum[i] *= f;
+  if (m_accumLinear) {
+    m_accumDb.resize(m_accum.size());
+    SuWidgetsKernels::powerToDb(
+          m_accumDb.data(),
+          m_accum.data(),
+          m_linearOffsetDb,
+          m_accum.size());
+    return m_accumDb.data();
+  }
 
-  // avoids repeated calls causing issues
-  m_samplesInAccum = 1;
+  return m_accum.data();
 }
 
 void AbstractWaterfall::resetFftAccumulator()
@@ -2283,6 +2990,7 @@ void AbstractWaterfall::drawSpectrum()
 
   // draw the pandapter spectrum over the overlay (really underlay)
   m_2DPixmap = m_OverlayPixmap.copy();
+  m_spectrumLayer.invalidate();
 
   // Do we have valid FFT data?
   if (m_fftDataSize < 1)
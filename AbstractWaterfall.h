@@ -39,10 +39,17 @@
 #include <vector>
 #include <QMap>
 #include <QOpenGLWidget>
+#include <QOpenGLTextureBlitter>
+#include <QTimer>
 
 #define WATERFALL_BOOKMARKS_SUPPORT
 
 #include "WFHelpers.h"
+#include "WaterfallHistory.h"
+#include "WFTextureLayer.h"
+#include "WFLevelEstimator.h"
+#include "SuWidgetsMemory.h"
+#include <sigutils/types.h>
 
 struct DrawingContext {
   QPainter     *painter;
@@ -51,7 +58,60 @@ struct DrawingContext {
   int height;
 };
 
-class AbstractWaterfall : public QOpenGLWidget
+//
+// The spectrum overlay is composed from several cached layers, in this
+// order. Each layer is only redrawn when its key (the visible range, the
+// widget geometry and a few layer-specific parameters) changes or when it
+// is explicitly invalidated.
+//
+enum OverlayLayerIndex {
+  OVERLAY_LAYER_GRID,       // Background, grid lines and axis labels
+  OVERLAY_LAYER_BOOKMARKS,  // Bookmark tags
+  OVERLAY_LAYER_FATS,       // Frequency allocation tables
+  OVERLAY_LAYER_CHANNELS,   // Named channel boxes
+  OVERLAY_LAYER_DYNAMIC,    // Info text
+  OVERLAY_LAYER_COUNT
+};
+
+#define OVERLAY_LAYER_MASK(layer) (1u << (layer))
+#define OVERLAY_ALL_LAYERS        ((1u << OVERLAY_LAYER_COUNT) - 1)
+#define OVERLAY_LAYER_KEY_PARAMS  5
+
+struct OverlayLayerKey {
+  qint64 startFreq = 0;
+  qint64 endFreq   = 0;
+  int    width     = 0;
+  int    height    = 0;
+  qreal  params[OVERLAY_LAYER_KEY_PARAMS] = {0, 0, 0, 0, 0};
+
+  inline bool
+  operator==(OverlayLayerKey const &other) const
+  {
+    if (startFreq != other.startFreq || endFreq != other.endFreq
+        || width != other.width || height != other.height)
+      return false;
+
+    for (int i = 0; i < OVERLAY_LAYER_KEY_PARAMS; ++i)
+      if (params[i] != other.params[i])
+        return false;
+
+    return true;
+  }
+
+  inline bool
+  operator!=(OverlayLayerKey const &other) const
+  {
+    return !(*this == other);
+  }
+};
+
+struct OverlayLayer {
+  QPixmap         pixmap;
+  OverlayLayerKey key;
+  bool            dirty = true;
+};
+
+class AbstractWaterfall : public QOpenGLWidget, public SuWidgetsMemoryClient
 {
   Q_OBJECT
 
@@ -59,6 +119,9 @@ class AbstractWaterfall : public QOpenGLWidget
     explicit AbstractWaterfall(QWidget *parent = 0);
     ~AbstractWaterfall();
 
+    void memoryUsage(SuWidgetsMemoryUsage &) const override;
+    quint64 reclaimMemory(SuWidgetsMemoryCategory, quint64) override;
+
     QSize minimumSizeHint() const;
     QSize sizeHint() const;
 
@@ -70,15 +133,28 @@ class AbstractWaterfall : public QOpenGLWidget
     void setExpectedRate(int rate) { m_expectedRate = rate; }
     void setFilterClickResolution(int clickres) { m_FilterClickResolution = clickres; }
     void setFilterBoxEnabled(bool enabled) { m_FilterBoxEnabled = enabled; }
-    void setCenterLineEnabled(bool enabled) { m_CenterLineEnabled = enabled; }
+    void setCenterLineEnabled(bool enabled)
+    {
+      m_CenterLineEnabled = enabled;
+      invalidateOverlayLayers(OVERLAY_LAYER_MASK(OVERLAY_LAYER_GRID));
+    }
     void setTooltipsEnabled(bool enabled) { m_TooltipsEnabled = enabled; }
-    void setBookmarksEnabled(bool enabled) { m_BookmarksEnabled = enabled; }
+    void setBookmarksEnabled(bool enabled)
+    {
+      m_BookmarksEnabled = enabled;
+      invalidateOverlayLayers(OVERLAY_LAYER_MASK(OVERLAY_LAYER_BOOKMARKS));
+    }
     void setTimeStampsEnabled(bool enabled) { m_TimeStampsEnabled = enabled; }
-    void setTimeStampsUTC(bool utc) { m_TimeStampsUTC = utc; drawOverlay(); }
+    void setTimeStampsUTC(bool utc) { m_TimeStampsUTC = utc; update(); }
 
     virtual bool isHdpiAware() { return false; }
 
-    void setChannelsEnabled(bool enabled) { m_channelsEnabled = enabled; updateOverlay(); }
+    void setChannelsEnabled(bool enabled)
+    {
+      m_channelsEnabled = enabled;
+      invalidateOverlayLayers(OVERLAY_LAYER_MASK(OVERLAY_LAYER_CHANNELS));
+      refreshOverlay();
+    }
 
     void setUseLBMdrag(bool enabled)
     {
@@ -90,7 +166,11 @@ class AbstractWaterfall : public QOpenGLWidget
     }
 
 #ifdef WATERFALL_BOOKMARKS_SUPPORT
-    void setBookmarkSource(BookmarkSource *src) { m_BookmarkSource = src; }
+    void setBookmarkSource(BookmarkSource *src)
+    {
+      m_BookmarkSource = src;
+      invalidateOverlayLayers(OVERLAY_LAYER_MASK(OVERLAY_LAYER_BOOKMARKS));
+    }
 #endif // WATERFALL_BOOKMARKS_SUPPORT
 
     bool removeFAT(std::string const &);
@@ -110,6 +190,20 @@ class AbstractWaterfall : public QOpenGLWidget
         QDateTime const &t = QDateTime::currentDateTime(),
         bool looped = false);
 
+    void setNewPowerFftData(
+        const float *power,
+        int size,
+        float offsetDb = 0,
+        QDateTime const &t = QDateTime::currentDateTime(),
+        bool looped = false);
+
+    void setNewComplexFftData(
+        const SUCOMPLEX *bins,
+        int size,
+        float offsetDb = 0,
+        QDateTime const &t = QDateTime::currentDateTime(),
+        bool looped = false);
+
     void setNewPartialFftData(
         const float *fftData,
         int size,
@@ -128,7 +222,11 @@ class AbstractWaterfall : public QOpenGLWidget
     }
 
     void setCenterFreq(qint64 f);
-    void setFreqUnits(qint32 unit) { m_FreqUnits = unit; }
+    void setFreqUnits(qint32 unit)
+    {
+      m_FreqUnits = unit;
+      invalidateOverlayLayers(OVERLAY_LAYER_MASK(OVERLAY_LAYER_GRID));
+    }
 
     void setDemodCenterFreq(qint64 f) { m_DemodCenterFreq = f; }
 
@@ -147,7 +245,7 @@ class AbstractWaterfall : public QOpenGLWidget
     void setFilterOffset(qint64 freq_hz)
     {
       m_DemodCenterFreq = m_CenterFreq + freq_hz;
-      drawOverlay();
+      refreshOverlay();
     }
     qint64 getFilterOffset()
     {
@@ -163,19 +261,19 @@ class AbstractWaterfall : public QOpenGLWidget
     {
       m_DemodLowCutFreq = LowCut;
       m_DemodHiCutFreq = HiCut;
-      drawOverlay();
+      refreshOverlay();
     }
 
     void setdBPerUnit(float dBPerUnit)
     {
       m_dBPerUnit = dBPerUnit;
-      drawOverlay();
+      refreshOverlay();
     }
 
     void setZeroPoint(float zeroPoint)
     {
       m_ZeroPoint = zeroPoint;
-      drawOverlay();
+      refreshOverlay();
     }
 
     void getHiLowCutFrequencies(qint64 *LowCut, qint64 *HiCut)
@@ -209,6 +307,7 @@ class AbstractWaterfall : public QOpenGLWidget
     void setUnitName(QString const &name)
     {
       m_unitName = name;
+      invalidateOverlayLayers(OVERLAY_LAYER_MASK(OVERLAY_LAYER_GRID));
     }
 
     QString getUnitName() const
@@ -223,7 +322,7 @@ class AbstractWaterfall : public QOpenGLWidget
         m_Span = s;
         setFftCenterFreq(m_FftCenter);
       }
-      drawOverlay();
+      refreshOverlay();
     }
 
     quint64 getSpanFreq() const
@@ -241,10 +340,23 @@ class AbstractWaterfall : public QOpenGLWidget
       return this->m_FftCenter;
     }
 
-    void setHdivDelta(int delta) { m_HdivDelta = delta; }
-    void setVdivDelta(int delta) { m_VdivDelta = delta; }
+    void setHdivDelta(int delta)
+    {
+      m_HdivDelta = delta;
+      invalidateOverlayLayers(OVERLAY_LAYER_MASK(OVERLAY_LAYER_GRID));
+    }
+
+    void setVdivDelta(int delta)
+    {
+      m_VdivDelta = delta;
+      invalidateOverlayLayers(OVERLAY_LAYER_MASK(OVERLAY_LAYER_GRID));
+    }
 
-    void setFreqDigits(int digits) { m_FreqDigits = digits>=0 ? digits : 0; }
+    void setFreqDigits(int digits)
+    {
+      m_FreqDigits = digits>=0 ? digits : 0;
+      invalidateOverlayLayers(OVERLAY_LAYER_MASK(OVERLAY_LAYER_GRID));
+    }
 
     /* Determines full bandwidth. */
     void setSampleRate(double rate)
@@ -252,7 +364,7 @@ class AbstractWaterfall : public QOpenGLWidget
       if (rate > 0.0)
       {
         m_SampleFreq = rate;
-        drawOverlay();
+        refreshOverlay();
       }
     }
 
@@ -275,6 +387,46 @@ class AbstractWaterfall : public QOpenGLWidget
     double  getWfTimeRes();
     void    setFftRate(int rate_hz);
     void    setFrequencyLimits(qint64 min, qint64 max);
+
+    // Time-axis zoom (see WaterfallHistory). 0 levels disable it.
+    void    setTimeHistory(int levels, int rows = WATERFALL_HISTORY_DEFAULT_ROWS);
+    void    setTimeZoom(int level);
+    void    setTimeReduction(WaterfallTimeReduction);
+
+    int
+    getTimeZoom() const
+    {
+      return m_timeZoom;
+    }
+
+    WaterfallTimeReduction
+    getTimeReduction() const
+    {
+      return m_timeReduction;
+    }
+
+    // Noise floor and peak level estimation (see WFLevelEstimator)
+    void    setLevelEstimation(bool);
+    void    setAutoRange(bool);
+    void    setAutoRangeHysteresis(float db);
+    float   getNoiseFloor();
+    float   getPeakLevel();
+
+    bool
+    getAutoRange() const
+    {
+      return m_autoRange;
+    }
+
+    // While resizing or zooming, drawing is coalesced and cheaper
+    void    setInteractionIdleTime(int ms);
+
+    bool
+    isInteracting() const
+    {
+      return m_interacting;
+    }
+
     void    setFrequencyLimitsEnabled(bool);
     virtual void clearWaterfall() = 0;
     virtual bool saveWaterfall(const QString & filename) const = 0;
@@ -328,10 +480,16 @@ class AbstractWaterfall : public QOpenGLWidget
     virtual void setWaterfallRange(float min, float max);
     void setPeakDetection(bool enabled, float c);
     void updateOverlay();
+    void updateBookmarks();
 
     void setInfoText(QString const &);
     void setInfoTextColor(QColor const &);
 
+    // Private slots
+    void releaseTextureLayers();
+    void onInteractionTimeout();
+    void onScheduledDraw();
+
     void setPercent2DScreen(int percent)
     {
       m_Percent2DScreen = percent;
@@ -343,6 +501,7 @@ class AbstractWaterfall : public QOpenGLWidget
     //re-implemented widget event handlers
     virtual void paintEvent(QPaintEvent *event);
     virtual void resizeEvent(QResizeEvent* event);
+    void beginInteraction();
     void mouseMoveEvent(QMouseEvent * event);
     void mousePressEvent(QMouseEvent * event);
     void mouseReleaseEvent(QMouseEvent * event);
@@ -383,6 +542,17 @@ class AbstractWaterfall : public QOpenGLWidget
 
     void        paintTimeStamps(QPainter &, QRect const &);
     void        drawOverlay();
+    void        refreshOverlay();
+    void        makeOverlayLayerKey(int, OverlayLayerKey &, qint64, qint64);
+    void        drawOverlayLayer(int, DrawingContext &, qint64, qint64);
+
+    inline void invalidateOverlayLayers(unsigned int mask)
+    {
+      for (int i = 0; i < OVERLAY_LAYER_COUNT; ++i)
+        if (mask & OVERLAY_LAYER_MASK(i))
+          m_OverlayLayers[i].dirty = true;
+    }
+
     void        makeFrequencyStrs();
     int         xFromFreq(qint64 freq);
     qint64      freqFromX(int x);
@@ -407,19 +577,55 @@ class AbstractWaterfall : public QOpenGLWidget
 
     int  drawFATs(DrawingContext &, qint64, qint64);
     void drawBookmarks(DrawingContext &, qint64, qint64, int xAxisTop);
+    void drawChannelBoxes(DrawingContext &, qint64, qint64, int bandY);
+    void drawInfoText(DrawingContext &);
     void drawAxes(DrawingContext &, qint64, qint64);
     void drawSpectrum();
     virtual void drawWaterfall(QPainter &) {}
 
     virtual void addNewWfLine(const float *wfData, int size, int repeats) = 0;
-
+    virtual void redrawWaterfallHistory();
+    bool paintTextureLayer(
+        QPainter &,
+        WFTextureLayer &,
+        QImage const &,
+        QRectF const &target);
+    void pushWfLine(const float *wfData, int size, int repeats);
+
+    void ingestFftData(
+        const float *fftData,
+        const float *wfData,
+        int size,
+        QDateTime const &t,
+        bool looped,
+        bool accumulated = false);
+    void recordFftData(
+        const float *fftData,
+        const float *wfData,
+        int size,
+        QDateTime const &t,
+        bool looped);
+    float *prepareLinearFftData(int size, float offsetDb);
+    void applyAutoRange();
+    void ingestLinearFftData(
+        int size,
+        bool accumulated,
+        QDateTime const &t,
+        bool looped);
     void accumulateFftData(const float *fftData, int size);
-    void averageFftData();
+    const float *averageFftData();
     void resetFftAccumulator();
 
-    // FFT line averaging accumulator
+    // FFT line averaging accumulator. Holds linear power when fed by
+    // setNewPowerFftData / setNewComplexFftData
     std::vector<float>  m_accum;
+    std::vector<float>  m_accumDb;
     int                 m_samplesInAccum;
+    bool                m_accumLinear = false;
+    float               m_linearOffsetDb = 0;
+
+    // Linear FFT data converted to dB
+    std::vector<float>  m_linearDb;
 
     // In partial update mode, keep a buffer of full frequency range data
     // Full frequency range is m_CenterFreq +- (m_SampleFreq/2)
@@ -449,6 +655,9 @@ class AbstractWaterfall : public QOpenGLWidget
     eCapturetype    m_CursorCaptured;
     QPixmap     m_2DPixmap;
     QPixmap     m_OverlayPixmap;
+    OverlayLayer m_OverlayLayers[OVERLAY_LAYER_COUNT];
+    int         m_XAxisTop = 0;
+    int         m_FATBandY = 0;
     QSize       m_Size;
     QString     m_Str;
     QString     m_HDivText[HORZ_DIVS_MAX+1];
@@ -538,6 +747,30 @@ class AbstractWaterfall : public QOpenGLWidget
     int         m_TimeStampCounter = 64;
     int         m_TimeStampMaxHeight = 0;
 
+    // Persistent textures of the pandapter pixmap and the waterfall image
+    QOpenGLTextureBlitter  m_blitter;
+    WFTextureLayer         m_spectrumLayer;
+    WFTextureLayer         m_waterfallLayer{true};
+    bool                   m_textureLayersFailed = false;
+
+    // Time-axis zoom: each waterfall row summarizes 2^m_timeZoom lines
+    WaterfallHistory       m_timeHistory;
+    int                    m_timeZoom      = 0;
+    WaterfallTimeReduction m_timeReduction = WATERFALL_TIME_MEAN;
+    int                    m_timeLineWidth = 0; // Of the last line pushed
+    std::vector<float>     m_timeExpanded;
+
+    // Level estimation and auto-range
+    WFLevelEstimator       m_levelEstimator;
+    bool                   m_levelEstimation     = false;
+    bool                   m_autoRange           = false;
+    float                  m_autoRangeHysteresis = WF_AUTO_RANGE_HYSTERESIS_DB;
+
+    // Interaction mode
+    QTimer                 m_interactionTimer;
+    bool                   m_interacting   = false;
+    bool                   m_drawScheduled = false;
+
     // Frequency navigation limits
     bool        m_enforceFreqLimits = false;
     qint64      m_lowerFreqLimit    = 0;
@@ -553,6 +786,7 @@ class AbstractWaterfall : public QOpenGLWidget
     // Frequency allocations
     bool m_ShowFATs = false;
     std::map<std::string, const FrequencyAllocationTable *> m_FATs;
+    std::vector<FrequencyBand> m_FATBands;
 
     // Named channels
     bool            m_channelsEnabled = true;
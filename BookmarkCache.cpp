@@ -0,0 +1,186 @@
+//
+//    BookmarkCache.cpp: Asynchronous, caching bookmark source
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include "BookmarkCache.h"
+
+// Number of visible spans that are prefetched at each side
+#define BOOKMARK_CACHE_PREFETCH_SPANS 1
+// Prefetch when the visible range gets this close (in spans) to the edges
+#define BOOKMARK_CACHE_REFILL_MARGIN  .5
+
+///////////////////////////// BookmarkCacheWorker //////////////////////////////
+BookmarkCacheWorker::BookmarkCacheWorker(
+    BookmarkSource *source,
+    QObject *parent) : QObject(parent)
+{
+  m_source = source;
+}
+
+BookmarkCacheWorker::~BookmarkCacheWorker()
+{
+
+}
+
+void
+BookmarkCacheWorker::fetch(qint64 start, qint64 end, quint64 generation)
+{
+  QList<BookmarkInfo> bookmarks;
+
+  if (m_source != nullptr)
+    bookmarks = m_source->getBookmarksInRange(start, end);
+
+  emit fetched(start, end, generation, bookmarks);
+}
+
+//////////////////////////////// BookmarkCache /////////////////////////////////
+BookmarkCache::BookmarkCache(BookmarkSource *source, QObject *parent) :
+  QObject(parent)
+{
+  qRegisterMetaType<QList<BookmarkInfo>>("QList<BookmarkInfo>");
+
+  m_workerThread = new QThread(this);
+  m_worker       = new BookmarkCacheWorker(source);
+
+  m_worker->moveToThread(m_workerThread);
+
+  connect(
+        this,
+        SIGNAL(triggerFetch(qint64, qint64, quint64)),
+        m_worker,
+        SLOT(fetch(qint64, qint64, quint64)));
+
+  connect(
+        m_worker,
+        SIGNAL(fetched(qint64, qint64, quint64, QList<BookmarkInfo>)),
+        this,
+        SLOT(onFetched(qint64, qint64, quint64, QList<BookmarkInfo>)));
+
+  m_workerThread->start();
+}
+
+BookmarkCache::~BookmarkCache()
+{
+  m_workerThread->quit();
+  m_workerThread->wait();
+
+  delete m_worker;
+}
+
+void
+BookmarkCache::request(qint64 start, qint64 end)
+{
+  if (m_pending) {
+    // Already on its way
+    if (m_pendingGeneration == m_generation
+        && m_pendingStart <= start
+        && end <= m_pendingEnd)
+      return;
+
+    // Only the last window is relevant, older ones are overwritten
+    m_queued      = true;
+    m_queuedStart = start;
+    m_queuedEnd   = end;
+    return;
+  }
+
+  m_pending           = true;
+  m_pendingStart      = start;
+  m_pendingEnd        = end;
+  m_pendingGeneration = m_generation;
+
+  emit triggerFetch(start, end, m_generation);
+}
+
+void
+BookmarkCache::prefetchAround(qint64 start, qint64 end)
+{
+  qint64 span = end - start;
+
+  this->request(
+        start - BOOKMARK_CACHE_PREFETCH_SPANS * span,
+        end   + BOOKMARK_CACHE_PREFETCH_SPANS * span);
+}
+
+QList<BookmarkInfo>
+BookmarkCache::getBookmarksInRange(qint64 start, qint64 end)
+{
+  QList<BookmarkInfo> bookmarks;
+  qint64 margin = static_cast<qint64>(BOOKMARK_CACHE_REFILL_MARGIN * (end - start));
+
+  if (!this->covers(start, end)) {
+    // Cache miss: return what we have, the rest will arrive later
+    this->prefetchAround(start, end);
+  } else if (start - m_cacheStart < margin || m_cacheEnd - end < margin) {
+    // Cache hit, but the user is panning towards one of the edges
+    this->prefetchAround(start, end);
+  }
+
+  for (auto p = m_cache.lower_bound(start);
+       p != m_cache.end() && p->first <= end;
+       ++p)
+    bookmarks.append(p->second);
+
+  return bookmarks;
+}
+
+void
+BookmarkCache::invalidate()
+{
+  ++m_generation;
+
+  m_cache.clear();
+  m_cacheValid = false;
+  m_queued     = false;
+
+  // Let the view ask again. This triggers a new fetch.
+  emit updated();
+}
+
+void
+BookmarkCache::onFetched(
+    qint64 start,
+    qint64 end,
+    quint64 generation,
+    QList<BookmarkInfo> bookmarks)
+{
+  bool fresh = generation == m_generation;
+
+  m_pending = false;
+
+  if (fresh) {
+    m_cache.clear();
+
+    for (auto &p : bookmarks)
+      m_cache.insert(std::make_pair(p.frequency, p));
+
+    m_cacheStart = start;
+    m_cacheEnd   = end;
+    m_cacheValid = true;
+  }
+
+  if (m_queued) {
+    m_queued = false;
+
+    if (!fresh || !this->covers(m_queuedStart, m_queuedEnd))
+      this->request(m_queuedStart, m_queuedEnd);
+  }
+
+  if (fresh)
+    emit updated();
+}
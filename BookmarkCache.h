@@ -0,0 +1,109 @@
+//
+//    BookmarkCache.h: Asynchronous, caching bookmark source
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef BOOKMARKCACHE_H
+#define BOOKMARKCACHE_H
+
+#include <QObject>
+#include <QThread>
+#include <QMetaType>
+#include <map>
+
+#include "WFHelpers.h"
+
+Q_DECLARE_METATYPE(BookmarkInfo)
+
+class BookmarkCacheWorker : public QObject {
+  Q_OBJECT
+
+  BookmarkSource *m_source = nullptr;
+
+public:
+  BookmarkCacheWorker(BookmarkSource *, QObject *parent = nullptr);
+  ~BookmarkCacheWorker() override;
+
+public slots:
+  void fetch(qint64 start, qint64 end, quint64 generation);
+
+signals:
+  void fetched(qint64, qint64, quint64, QList<BookmarkInfo>);
+};
+
+//
+// BookmarkCache sits between a waterfall and a slow BookmarkSource. It
+// keeps the bookmarks of a window around the visible range, and refills
+// it from a worker thread as the user pans. getBookmarksInRange() never
+// blocks: it returns whatever is cached, and updated() is emitted when
+// new bookmarks arrive. Connect it to AbstractWaterfall::updateBookmarks().
+//
+// The wrapped source is queried from the worker thread only, and must
+// not be accessed concurrently by its owner while the cache is alive.
+//
+class BookmarkCache : public QObject, public BookmarkSource {
+  Q_OBJECT
+
+  QThread             *m_workerThread = nullptr;
+  BookmarkCacheWorker *m_worker = nullptr;
+
+  // Cached window [m_cacheStart, m_cacheEnd)
+  std::multimap<qint64, BookmarkInfo> m_cache;
+  bool     m_cacheValid = false;
+  qint64   m_cacheStart = 0;
+  qint64   m_cacheEnd   = 0;
+
+  // Last window requested to the worker
+  bool     m_pending      = false;
+  qint64   m_pendingStart = 0;
+  qint64   m_pendingEnd   = 0;
+  quint64  m_pendingGeneration = 0;
+
+  // Window to request once the pending fetch is done
+  bool     m_queued      = false;
+  qint64   m_queuedStart = 0;
+  qint64   m_queuedEnd   = 0;
+
+  // Fetches issued before the last invalidation are discarded
+  quint64  m_generation = 0;
+
+  void request(qint64 start, qint64 end);
+  void prefetchAround(qint64 start, qint64 end);
+
+public:
+  BookmarkCache(BookmarkSource *source, QObject *parent = nullptr);
+  ~BookmarkCache() override;
+
+  QList<BookmarkInfo> getBookmarksInRange(qint64, qint64) override;
+
+  inline bool
+  covers(qint64 start, qint64 end) const
+  {
+    return m_cacheValid && m_cacheStart <= start && end <= m_cacheEnd;
+  }
+
+public slots:
+  void invalidate();
+
+  // Private slots
+  void onFetched(qint64, qint64, quint64, QList<BookmarkInfo>);
+
+signals:
+  void triggerFetch(qint64, qint64, quint64);
+  void updated();
+};
+
+#endif // BOOKMARKCACHE_H
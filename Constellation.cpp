@@ -19,6 +19,7 @@
 //
 
 #include "Constellation.h"
+#include "SuWidgetsRecorder.h"
 
 #include <QPainter>
 #include <assert.h>
@@ -75,7 +76,7 @@ Constellation::recalculateDisplayData(void)
 void
 Constellation::drawAxes(void)
 {
-  QPainter painter(&this->axesPixmap);
+  QPainter painter(&this->layers.beginAxes());
   QPen pen(this->axes);
 
   painter.fillRect(0, 0, this->width, this->height, this->background);
@@ -107,14 +108,12 @@ Constellation::drawAxes(void)
     }
 
   }
-
-  this->axesDrawn = true;
 }
 
 void
 Constellation::drawConstellation(void)
 {
-  QPainter painter(&this->contentPixmap);
+  QPainter painter(&this->layers.beginData());
   QColor fg = this->foreground;
   SUCOMPLEX c;
   float alphaK;
@@ -157,24 +156,16 @@ Constellation::draw(void)
   if (this->geometry != this->size()) {
     this->geometry = this->size();
     this->haveGeometry = true;
-    this->contentPixmap  = QPixmap(this->geometry.width(), this->geometry.height());
-    this->axesPixmap = QPixmap(this->geometry.width(), this->geometry.height());
-    this->axesDrawn = false;
+    this->layers.resize(this->geometry);
   }
 
-  if (!this->axesDrawn) {
+  if (!this->layers.axesValid()) {
     this->recalculateDisplayData();
     this->drawAxes();
     emit this->axesUpdated();
   }
 
-  /* Dump to content pixmap */
-  this->contentPixmap = this->axesPixmap.copy(
-        0,
-        0,
-        this->geometry.width(),
-        this->geometry.height());
-
+  /* Axes are composed with the points in paint() */
   this->drawConstellation();
 }
 
@@ -183,7 +174,41 @@ void
 Constellation::paint(void)
 {
   QPainter painter(this);
-  painter.drawPixmap(0, 0, this->contentPixmap);
+  this->layers.compose(painter);
+}
+
+void
+Constellation::memoryUsage(SuWidgetsMemoryUsage &usage) const
+{
+  usage[SUWIDGETS_MEMORY_HISTORIES] +=
+        this->history.capacity() * sizeof(SUCOMPLEX);
+  usage[SUWIDGETS_MEMORY_IMAGES] += this->layers.memoryUsage();
+}
+
+// The history is halved as many times as needed, and restarted
+quint64
+Constellation::reclaimMemory(SuWidgetsMemoryCategory category, quint64 bytes)
+{
+  size_t size   = this->history.size();
+  size_t target = size;
+  quint64 before =
+        this->history.capacity() * sizeof(SUCOMPLEX);
+
+  if (category != SUWIDGETS_MEMORY_HISTORIES)
+    return 0;
+
+  while (target / 2 >= SUWIDGETS_MEMORY_MIN_HISTORY
+         && (size - target) * sizeof(SUCOMPLEX) < bytes)
+    target /= 2;
+
+  if (target < size)
+    this->setHistorySize(static_cast<unsigned int>(target));
+  this->history.shrink_to_fit();
+
+  this->invalidate();
+
+  return before - (
+        this->history.capacity() * sizeof(SUCOMPLEX));
 }
 
 void
@@ -201,6 +226,13 @@ Constellation::feed(const SUCOMPLEX *samples, unsigned int length)
   unsigned int size = static_cast<unsigned int>(this->history.size());
   unsigned int chunk;
 
+  if (SuWidgetsRecorder::isRecording())
+    SuWidgetsRecorder::record(
+          this,
+          SUWIDGETS_TRACE_CONSTELLATION_FEED,
+          samples,
+          length * sizeof(SUCOMPLEX));
+
   if (length > size) {
     p = length - size;
     length = size;
@@ -237,9 +269,6 @@ Constellation::feed(const SUCOMPLEX *samples, unsigned int length)
 Constellation::Constellation(QWidget *parent) :
   ThrottleableWidget(parent)
 {
-  this->contentPixmap = QPixmap(0, 0);
-  this->axesPixmap = QPixmap(0, 0);
-
   this->history.resize(CONSTELLATION_DEFAULT_HISTORY_SIZE);
 
   this->background = CONSTELLATION_DEFAULT_BACKGROUND_COLOR;
@@ -27,6 +27,8 @@
 #include <tgmath.h>
 #include <sigutils/types.h>
 #include "ThrottleableWidget.h"
+#include "SuWidgetsMemory.h"
+#include "LayeredCompositor.h"
 
 #define CONSTELLATION_DEFAULT_BACKGROUND_COLOR QColor(0,     0,   0)
 #define CONSTELLATION_DEFAULT_FOREGROUND_COLOR QColor(255, 255, 255)
@@ -34,7 +36,7 @@
 
 #define CONSTELLATION_DEFAULT_HISTORY_SIZE 256
 
-class Constellation : public ThrottleableWidget
+class Constellation : public ThrottleableWidget, public SuWidgetsMemoryClient
 {
   Q_OBJECT
 
@@ -65,8 +67,7 @@ class Constellation : public ThrottleableWidget
 
 
   // Drawing area properties
-  QPixmap contentPixmap;
-  QPixmap axesPixmap;
+  LayeredCompositor layers;
 
   QSize geometry;
 
@@ -83,7 +84,6 @@ class Constellation : public ThrottleableWidget
   float zoom = .5f;
   unsigned int bits = 2;
   bool haveGeometry = false;
-  bool axesDrawn = false;
   SUFLOAT gain = 1.414f;
 
   // Cached data
@@ -106,7 +106,7 @@ public:
   setBackgroundColor(const QColor &c)
   {
     this->background = c;
-    this->axesDrawn = false;
+    this->layers.invalidateAxes();
     this->invalidate();
     emit backgroundColorChanged();
   }
@@ -121,7 +121,7 @@ public:
   setAxesColor(const QColor &c)
   {
     this->axes = c;
-    this->axesDrawn = false;
+    this->layers.invalidateAxes();
     this->invalidate();
     emit axesColorChanged();
   }
@@ -136,7 +136,7 @@ public:
   setForegroundColor(const QColor &c)
   {
     this->foreground = c;
-    this->axesDrawn = false;
+    this->layers.invalidateAxes();
     this->invalidate();
     emit foregroundColorChanged();
   }
@@ -152,7 +152,7 @@ public:
   {
     if (this->bits != bits) {
       this->bits = bits;
-      this->axesDrawn = false;
+      this->layers.invalidateAxes();
       this->invalidate();
       emit orderHintChanged();
     }
@@ -190,6 +190,9 @@ public:
 
   Constellation(QWidget *parent = nullptr);
 
+  void memoryUsage(SuWidgetsMemoryUsage &) const override;
+  quint64 reclaimMemory(SuWidgetsMemoryCategory, quint64) override;
+
 signals:
   void orderHintChanged();
   void backgroundColorChanged();
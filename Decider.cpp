@@ -19,6 +19,42 @@
 
 #include "Decider.h"
 
+#include "SuWidgetsKernels.h"
+
+static inline void
+computeMetric(
+    const SUCOMPLEX *data,
+    float *metric,
+    size_t len,
+    Decider::DecisionMode mode)
+{
+  if (mode == Decider::ARGUMENT)
+    SuWidgetsKernels::arg(metric, data, len);
+  else
+    SuWidgetsKernels::magnitude(metric, data, len);
+}
+
+// Branchless, so that it vectorizes. Truncation equals floor after clamping
+// to [0, top], and NaNs end up in the first interval.
+static inline void
+quantize(
+    const float *metric,
+    Symbol *symbols,
+    size_t len,
+    float min,
+    float invDelta,
+    float top)
+{
+  float t;
+
+  for (size_t i = 0; i < len; ++i) {
+    t = (metric[i] - min) * invDelta;
+    t = t > 0 ? t : 0;
+    t = t < top ? t : top;
+    symbols[i] = static_cast<Symbol>(static_cast<int>(t));
+  }
+}
+
 Decider::Decider()
 {
 
@@ -27,48 +63,86 @@ Decider::Decider()
 void
 Decider::feed(const SUCOMPLEX *data, size_t len)
 {
-  this->buffer.resize(len);
+  // No reallocation unless the buffer grows past its capacity
+  if (this->buffer.size() != len)
+    this->buffer.resize(len);
+
   this->decide(data, this->buffer.data(), len);
 }
 
+void
+Decider::feed(const SUCOMPLEX *data, size_t len, DecisionStats &stats)
+{
+  if (this->buffer.size() != len)
+    this->buffer.resize(len);
+
+  this->decide(data, this->buffer.data(), len, stats);
+}
+
 void
 Decider::decide(
     const SUCOMPLEX *data,
     Symbol *buffer,
     size_t len) const
 {
-  float arg;
-  int sym;
-
-  switch (this->mode) {
-    case ARGUMENT:
-      for (unsigned int i = 0; i < len; ++i) {
-        SUWIDGETS_DETECT_ARGUMENT(arg, data[i]);
-
-        sym = static_cast<int>(
-              floorf((arg - this->min) / (this->delta)));
-        if (sym < 0)
-          sym = 0;
-        else if (sym >= this->intervals)
-          sym = this->intervals - 1;
-
-        buffer[i] = static_cast<Symbol>(sym);
-      }
-      break;
+  float metric[DECIDER_BLOCK_SIZE];
+  float top = static_cast<float>(this->intervals - 1);
+  size_t chunk;
+
+  for (size_t p = 0; p < len; p += chunk) {
+    chunk = std::min(len - p, static_cast<size_t>(DECIDER_BLOCK_SIZE));
+
+    computeMetric(data + p, metric, chunk, this->mode);
+    quantize(metric, buffer + p, chunk, this->min, this->invDelta, top);
+  }
+}
+
+void
+Decider::decide(
+    const SUCOMPLEX *data,
+    Symbol *buffer,
+    size_t len,
+    DecisionStats &stats) const
+{
+  float metric[DECIDER_BLOCK_SIZE];
+  float top = static_cast<float>(this->intervals - 1);
+  unsigned int states = static_cast<unsigned int>(this->intervals);
+  unsigned int bins = static_cast<unsigned int>(stats.histogram.size());
+  float binScale = static_cast<float>(bins) / this->scale;
+  unsigned int *hist = stats.histogram.data();
+  unsigned int *trans;
+  int bin, prev;
+  size_t chunk;
+
+  if (stats.transitions.size() != states * states) {
+    stats.transitions.assign(states * states, 0);
+    stats.last = -1;
+  }
+
+  trans = stats.transitions.data();
+  prev  = stats.last;
 
-    case MODULUS:
-      for (unsigned int i = 0; i < len; ++i) {
-        SUWIDGETS_DETECT_MODULUS(arg, data[i]);
+  for (size_t p = 0; p < len; p += chunk) {
+    chunk = std::min(len - p, static_cast<size_t>(DECIDER_BLOCK_SIZE));
 
-        sym = static_cast<int>(
-              floorf((arg - this->min) / (this->delta)));
-        if (sym < 0)
-          sym = 0;
-        else if (sym >= this->intervals)
-          sym = this->intervals - 1;
+    computeMetric(data + p, metric, chunk, this->mode);
+    quantize(metric, buffer + p, chunk, this->min, this->invDelta, top);
 
-        buffer[i] = static_cast<Symbol>(sym);
+    // Histogram binning as in Histogram::feed
+    if (bins > 0) {
+      for (size_t i = 0; i < chunk; ++i) {
+        bin = static_cast<int>((metric[i] - this->min) * binScale);
+        if (bin >= 0 && bin < static_cast<int>(bins))
+          ++hist[bin];
       }
-      break;
+    }
+
+    for (size_t i = 0; i < chunk; ++i) {
+      if (prev >= 0)
+        ++trans[static_cast<unsigned>(prev) * states + buffer[p + i]];
+      prev = buffer[p + i];
+    }
   }
+
+  stats.last = prev;
 }
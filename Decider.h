@@ -26,6 +26,7 @@
 #include <sigutils/types.h>
 #include <cstdint>
 #include <vector>
+#include <algorithm>
 
 // Qt 6 broke something
 #ifdef I
@@ -40,6 +41,29 @@ typedef uint8_t Symbol;
 #define SUWIDGETS_DETECT_MODULUS(dest, orig) \
   dest = SU_C_ABS(orig)
 
+// Samples are decided in blocks of this size (metric scratch on stack)
+#define DECIDER_BLOCK_SIZE 512
+
+//
+// Statistics accumulated while deciding. The histogram spans [min, max)
+// of the decision metric with as many bins as the vector holds (leave it
+// empty to skip it). Transition counts are indexed by
+// prev * intervals + curr, and are reset when the number of intervals
+// changes.
+//
+struct DecisionStats {
+  std::vector<unsigned int> histogram;
+  std::vector<unsigned int> transitions;
+  int last = -1; // Last symbol decided, -1 if none
+
+  void
+  clear(void)
+  {
+    std::fill(this->histogram.begin(), this->histogram.end(), 0);
+    std::fill(this->transitions.begin(), this->transitions.end(), 0);
+  }
+};
+
 class Decider
 {
   public:
@@ -53,11 +77,20 @@ class Decider
     int bps = 1;
     int intervals = 2;
     float delta = static_cast<float>(M_PI);
+    float invDelta = static_cast<float>(1. / M_PI);
     float min = 0;
     float max = static_cast<float>(2 * M_PI);
     float scale = static_cast<float>(2 * M_PI);
     std::vector<Symbol> buffer;
 
+    void
+    updateDelta(void)
+    {
+      this->scale = this->max - this->min;
+      this->delta = this->scale / this->intervals;
+      this->invDelta = 1.f / this->delta;
+    }
+
   public:
     float
     getDelta(void) const
@@ -70,8 +103,7 @@ class Decider
     {
       if (fabsf(this->min - val) > 1e-15f) {
         this->min = val;
-        this->scale = this->max - this->min;
-        this->delta = this->scale / this->intervals;
+        this->updateDelta();
       }
     }
 
@@ -80,8 +112,7 @@ class Decider
     {
       if (fabsf(this->max - val) > 1e-15f) {
         this->max = val;
-        this->scale = this->max - this->min;
-        this->delta = this->scale / this->intervals;
+        this->updateDelta();
       }
     }
 
@@ -115,8 +146,7 @@ class Decider
       if (this->bps != static_cast<int>(bps)) {
         this->bps = static_cast<int>(bps);
         this->intervals = 1 << bps;
-        this->scale = this->max - this->min;
-        this->delta = this->scale / this->intervals;
+        this->updateDelta();
       }
     }
 
@@ -139,8 +169,14 @@ class Decider
     }
 
     void feed(const SUCOMPLEX *data, size_t len);
+    void feed(const SUCOMPLEX *data, size_t len, DecisionStats &stats);
 
     void decide(const SUCOMPLEX *data, Symbol *symbols, size_t len) const;
+    void decide(
+        const SUCOMPLEX *data,
+        Symbol *symbols,
+        size_t len,
+        DecisionStats &stats) const;
 
     Decider();
 };
@@ -0,0 +1,432 @@
+//
+//    EyeDiagram.cpp: Persistence eye diagram
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include "EyeDiagram.h"
+#include "SuWidgetsHelpers.h"
+#include "SuWidgetsKernels.h"
+#include "gradient.h"
+
+#include <QMutexLocker>
+#include <QPainter>
+#include <cmath>
+
+EyeDiagram::EyeDiagram(QWidget *parent) :
+  ThrottleableWidget(parent)
+{
+  m_updatePending.store(false);
+
+  m_background = EYEDIAGRAM_DEFAULT_BACKGROUND_COLOR;
+  m_axes       = EYEDIAGRAM_DEFAULT_AXES_COLOR;
+
+  for (int i = 0; i < 256; ++i)
+    m_colorTbl[i] = qRgb(
+          SCAST(int, 255 * wf_gradient[i][0]),
+          SCAST(int, 255 * wf_gradient[i][1]),
+          SCAST(int, 255 * wf_gradient[i][2]));
+
+  resetDensity();
+  invalidate();
+}
+
+void
+EyeDiagram::memoryUsage(SuWidgetsMemoryUsage &usage) const
+{
+  QMutexLocker locker(&m_dataMutex);
+
+  usage[SUWIDGETS_MEMORY_ACCUMULATORS] +=
+        (m_density.capacity()
+         + m_ys.capacity()
+         + m_pointY.capacity()
+         + m_weightLo.capacity()
+         + m_weightHi.capacity()
+         + m_db.capacity()) * sizeof(float)
+      + (m_pointX.capacity() + m_index.capacity()) * sizeof(int32_t);
+  usage[SUWIDGETS_MEMORY_IMAGES] += SuWidgetsMemory::imageBytes(m_image);
+}
+
+// Called with the data mutex held
+void
+EyeDiagram::resetDensity()
+{
+  m_density.assign(SCAST(size_t, m_columns) * SCAST(size_t, m_rows), 0);
+  m_haveLast  = false;
+  m_undecayed = 0;
+}
+
+//
+// Joins the previous sample with every new one. Column c of a segment
+// starting at column x gets y0 + slope * (c - x): the inner loop has no
+// dependencies between iterations, and wrapping around the right edge is
+// left to deposit().
+//
+void
+EyeDiagram::rasterize(const float *ys, SUSCOUNT count, qreal colsPerSample)
+{
+  size_t maxPoints = count * (SCAST(size_t, colsPerSample) + 2);
+  size_t points = 0;
+  qreal x  = m_x;
+  float y0 = m_lastY;
+
+  if (m_pointY.size() < maxPoints) {
+    m_pointY.resize(maxPoints);
+    m_pointX.resize(maxPoints);
+  }
+
+  for (SUSCOUNT i = 0; i < count; ++i) {
+    qreal x1 = x + colsPerSample;
+    float y1 = ys[i];
+
+    if (m_haveLast) {
+      int32_t c0    = SCAST(int32_t, std::ceil(x));
+      int32_t n     = SCAST(int32_t, std::ceil(x1)) - c0;
+      float   slope = SCAST(float, (y1 - y0) / colsPerSample);
+      float   start = y0 + slope * SCAST(float, c0 - x);
+      float  *py    = m_pointY.data() + points;
+      int32_t *px   = m_pointX.data() + points;
+
+      for (int32_t j = 0; j < n; ++j) {
+        py[j] = start + slope * SCAST(float, j);
+        px[j] = c0 + j;
+      }
+
+      points += SCAST(size_t, n);
+    }
+
+    x  = x1 >= m_columns ? x1 - m_columns : x1;
+    y0 = y1;
+    m_haveLast = true;
+  }
+
+  m_x     = x;
+  m_lastY = y0;
+
+  deposit(points);
+}
+
+//
+// Cell indices and weights are computed in a vectorizable pass, and hits
+// are scattered in a second one. Points out of the vertical range get a
+// weight of zero instead of a branch.
+//
+void
+EyeDiagram::deposit(size_t points)
+{
+  float   last = SCAST(float, m_rows - 1);
+  float  *density = m_density.data();
+  int32_t columns = m_columns;
+
+  if (m_index.size() < points) {
+    m_index.resize(points);
+    m_weightLo.resize(points);
+    m_weightHi.resize(points);
+  }
+
+  for (size_t i = 0; i < points; ++i) {
+    float   y   = m_pointY[i];
+    int32_t col = m_pointX[i];
+    float   in  = y >= 0.f && y < last ? 1.f : 0.f;
+    int32_t row;
+    float   frac;
+
+    col  = col >= columns ? col - columns : col;
+    y    = in > 0.f ? y : 0.f;
+    row  = SCAST(int32_t, y);
+    frac = y - SCAST(float, row);
+
+    m_index[i]    = row * columns + col;
+    m_weightLo[i] = in * (1.f - frac);
+    m_weightHi[i] = in * frac;
+  }
+
+  for (size_t i = 0; i < points; ++i) {
+    density[m_index[i]]           += m_weightLo[i];
+    density[m_index[i] + columns] += m_weightHi[i];
+  }
+}
+
+// Called with the data mutex held
+void
+EyeDiagram::decay()
+{
+  qreal traces = SCAST(qreal, m_undecayed) / (m_span * m_period);
+
+  if (traces > 0) {
+    SuWidgetsKernels::scale(
+          m_density.data(),
+          SCAST(float, exp(-traces / m_persistence)),
+          m_density.size());
+    m_undecayed = 0;
+  }
+}
+
+void
+EyeDiagram::feed(const SUCOMPLEX *samples, SUSCOUNT length)
+{
+  {
+    QMutexLocker locker(&m_dataMutex);
+    qreal colsPerSample = m_columns / (m_span * m_period);
+    float origin = .5f * SCAST(float, m_rows - 1);
+    float k = -origin * m_gain / m_range;
+    SUSCOUNT chunk;
+
+    m_ys.resize(EYEDIAGRAM_CHUNK_SIZE);
+
+    for (SUSCOUNT p = 0; p < length; p += chunk) {
+      const SUCOMPLEX *x = samples + p;
+      float *ys = m_ys.data();
+
+      chunk = qMin(length - p, SCAST(SUSCOUNT, EYEDIAGRAM_CHUNK_SIZE));
+
+      if (m_component == EYE_DIAGRAM_IN_PHASE) {
+        for (SUSCOUNT i = 0; i < chunk; ++i)
+          ys[i] = origin + k * SU_C_REAL(x[i]);
+      } else {
+        for (SUSCOUNT i = 0; i < chunk; ++i)
+          ys[i] = origin + k * SU_C_IMAG(x[i]);
+      }
+
+      rasterize(ys, chunk, colsPerSample);
+    }
+
+    m_undecayed += length;
+  }
+
+  // Coalesce redraw requests from other threads
+  if (!m_updatePending.exchange(true))
+    QMetaObject::invokeMethod(this, "onFed", Qt::QueuedConnection);
+}
+
+void
+EyeDiagram::setSymbolPeriod(qreal samples)
+{
+  QMutexLocker locker(&m_dataMutex);
+
+  m_period = qMax(samples, SCAST(qreal, 1));
+  resetDensity();
+  invalidate();
+}
+
+void
+EyeDiagram::setSpan(int symbols)
+{
+  QMutexLocker locker(&m_dataMutex);
+
+  m_span = qMax(symbols, 1);
+  resetDensity();
+  invalidate();
+}
+
+void
+EyeDiagram::setGain(SUFLOAT gain)
+{
+  QMutexLocker locker(&m_dataMutex);
+
+  m_gain = gain;
+  resetDensity();
+  invalidate();
+}
+
+void
+EyeDiagram::setRange(SUFLOAT range)
+{
+  QMutexLocker locker(&m_dataMutex);
+
+  if (range > 0) {
+    m_range = range;
+    resetDensity();
+    invalidate();
+  }
+}
+
+void
+EyeDiagram::setComponent(EyeDiagramComponent component)
+{
+  QMutexLocker locker(&m_dataMutex);
+
+  m_component = component;
+  resetDensity();
+  invalidate();
+}
+
+void
+EyeDiagram::setResolution(int columns, int rows)
+{
+  QMutexLocker locker(&m_dataMutex);
+
+  m_columns = qMax(columns, 2);
+  m_rows    = qMax(rows, 2);
+  m_x       = 0;
+  resetDensity();
+  invalidate();
+}
+
+void
+EyeDiagram::shift(qreal samples)
+{
+  QMutexLocker locker(&m_dataMutex);
+  qreal colsPerSample = m_columns / (m_span * m_period);
+
+  m_x = fmod(m_x + samples * colsPerSample, m_columns);
+  if (m_x < 0)
+    m_x += m_columns;
+
+  resetDensity();
+  invalidate();
+}
+
+void
+EyeDiagram::setPersistence(qreal traces)
+{
+  QMutexLocker locker(&m_dataMutex);
+
+  m_persistence = qMax(traces, SCAST(qreal, 1));
+}
+
+void
+EyeDiagram::setDynamicRange(float db)
+{
+  if (db > 0) {
+    m_dynamicRange = db;
+    invalidate();
+  }
+}
+
+void
+EyeDiagram::setPalette(const QColor *table)
+{
+  for (int i = 0; i < 256; ++i)
+    m_colorTbl[i] = qRgb(table[i].red(), table[i].green(), table[i].blue());
+
+  invalidate();
+}
+
+void
+EyeDiagram::clear()
+{
+  QMutexLocker locker(&m_dataMutex);
+
+  resetDensity();
+  invalidate();
+}
+
+//
+// Levels are taken in dB below the densest cell, and mapped to the
+// palette over the dynamic range. Cells below it are background.
+//
+void
+EyeDiagram::draw()
+{
+  QRgb bg = m_background.rgb();
+  size_t cells;
+  float peak, low, k;
+  int columns, rows;
+
+  if (!size().isValid())
+    return;
+
+  {
+    QMutexLocker locker(&m_dataMutex);
+
+    decay();
+
+    columns = m_columns;
+    rows    = m_rows;
+    cells   = m_density.size();
+    peak    = SuWidgetsKernels::maximum(m_density.data(), cells);
+
+    m_db.resize(cells);
+    if (peak > 0)
+      SuWidgetsKernels::powerToDb(m_db.data(), m_density.data(), 0, cells);
+  }
+
+  if (m_image.width() != columns || m_image.height() != rows)
+    m_image = QImage(columns, rows, QImage::Format_RGB32);
+
+  if (peak <= 0) {
+    m_image.fill(bg);
+    return;
+  }
+
+  low = SuWidgetsKernels::maximum(m_db.data(), cells) - m_dynamicRange;
+  k   = 255.f / m_dynamicRange;
+
+  for (int j = 0; j < rows; ++j) {
+    QRgb *line = RCAST(QRgb *, m_image.scanLine(j));
+    const float *db = m_db.data() + SCAST(size_t, j) * SCAST(size_t, columns);
+
+    for (int i = 0; i < columns; ++i) {
+      float level = (db[i] - low) * k;
+
+      if (level < 0.f)
+        line[i] = bg;
+      else
+        line[i] = m_colorTbl[level < 255.f ? SCAST(int, level) : 255];
+    }
+  }
+}
+
+void
+EyeDiagram::drawAxes(QPainter &painter)
+{
+  QPen pen(m_axes);
+  int w = width();
+  int h = height();
+
+  pen.setStyle(Qt::DotLine);
+  painter.setPen(pen);
+
+  // Zero level
+  painter.drawLine(0, h / 2, w - 1, h / 2);
+
+  // Symbol boundaries
+  for (int i = 1; i < m_span; ++i) {
+    int x = i * w / m_span;
+    painter.drawLine(x, 0, x, h - 1);
+  }
+}
+
+void
+EyeDiagram::paint()
+{
+  QPainter painter(this);
+
+  if (m_image.isNull()) {
+    painter.fillRect(rect(), m_background);
+  } else {
+    // The density buffer has its own resolution
+    painter.setRenderHint(QPainter::SmoothPixmapTransform, !isInteracting());
+    painter.drawImage(rect(), m_image);
+  }
+
+  drawAxes(painter);
+}
+
+// Only the scaling of paint() was degraded
+void
+EyeDiagram::interactionFinished()
+{
+  update();
+}
+
+void
+EyeDiagram::onFed()
+{
+  m_updatePending.store(false);
+  invalidate();
+}
@@ -0,0 +1,225 @@
+//
+//    EyeDiagram.h: Persistence eye diagram
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef EYEDIAGRAM_H
+#define EYEDIAGRAM_H
+
+#include <QFrame>
+#include <QImage>
+#include <QMutex>
+
+#include <atomic>
+#include <vector>
+#include <sigutils/types.h>
+#include "ThrottleableWidget.h"
+#include "SuWidgetsMemory.h"
+
+#define EYEDIAGRAM_DEFAULT_BACKGROUND_COLOR QColor(0,     0,   0)
+#define EYEDIAGRAM_DEFAULT_AXES_COLOR       QColor(128, 128, 128)
+
+// Density buffer resolution, independent of the widget size
+#define EYEDIAGRAM_DEFAULT_COLUMNS          512
+#define EYEDIAGRAM_DEFAULT_ROWS             256
+
+#define EYEDIAGRAM_DEFAULT_SYMBOL_PERIOD    8.
+#define EYEDIAGRAM_DEFAULT_SPAN             2
+#define EYEDIAGRAM_DEFAULT_PERSISTENCE      64.   // In traces
+#define EYEDIAGRAM_DEFAULT_DYNAMIC_RANGE    40.f  // In dB
+
+// Samples rasterized per pass
+#define EYEDIAGRAM_CHUNK_SIZE               1024
+
+enum EyeDiagramComponent {
+  EYE_DIAGRAM_IN_PHASE,
+  EYE_DIAGRAM_QUADRATURE
+};
+
+//
+// Eye diagram drawn as a density plot. Samples are folded every `span`
+// symbol periods into a 2-D buffer of hits: consecutive samples are
+// joined by linear interpolation, and every column crossed by the segment
+// gets a hit split between the two nearest rows. Hits decay exponentially
+// with a time constant of `persistence` traces.
+//
+// The density is shown in dB below its peak through a 256-color palette,
+// like the waterfall. feed() may be called from any thread, and drawing
+// costs O(pixels) regardless of the sample rate.
+//
+class EyeDiagram : public ThrottleableWidget, public SuWidgetsMemoryClient
+{
+  Q_OBJECT
+
+  Q_PROPERTY(
+      QColor backgroundColor
+      READ getBackgroundColor
+      WRITE setBackgroundColor
+      NOTIFY backgroundColorChanged)
+
+  Q_PROPERTY(
+      QColor axesColor
+      READ getAxesColor
+      WRITE setAxesColor
+      NOTIFY axesColorChanged)
+
+  // Density and folding state, guarded by m_dataMutex
+  mutable QMutex m_dataMutex;
+  std::vector<float> m_density;
+  int     m_columns = EYEDIAGRAM_DEFAULT_COLUMNS;
+  int     m_rows    = EYEDIAGRAM_DEFAULT_ROWS;
+  qreal   m_period  = EYEDIAGRAM_DEFAULT_SYMBOL_PERIOD;
+  int     m_span    = EYEDIAGRAM_DEFAULT_SPAN;
+  qreal   m_x       = 0;   // Column of the next sample
+  float   m_lastY   = 0;   // Row of the previous sample
+  bool    m_haveLast = false;
+  quint64 m_undecayed = 0; // Samples fed since the last decay
+  SUFLOAT m_gain    = 1;
+  SUFLOAT m_range   = 1;   // Amplitude at the top row
+  EyeDiagramComponent m_component = EYE_DIAGRAM_IN_PHASE;
+
+  // Rasterizer scratch
+  std::vector<float>   m_ys;
+  std::vector<float>   m_pointY;
+  std::vector<int32_t> m_pointX;
+  std::vector<int32_t> m_index;
+  std::vector<float>   m_weightLo;
+  std::vector<float>   m_weightHi;
+
+  // Drawing
+  std::atomic<bool> m_updatePending;
+  std::vector<float> m_db;
+  QImage   m_image;
+  uint32_t m_colorTbl[256];
+  QColor   m_background;
+  QColor   m_axes;
+  qreal    m_persistence  = EYEDIAGRAM_DEFAULT_PERSISTENCE;
+  float    m_dynamicRange = EYEDIAGRAM_DEFAULT_DYNAMIC_RANGE;
+
+  // Private methods
+  void resetDensity();
+  void rasterize(const float *ys, SUSCOUNT count, qreal colsPerSample);
+  void deposit(size_t points);
+  void decay();
+  void drawAxes(QPainter &);
+
+public:
+  void
+  setBackgroundColor(const QColor &c)
+  {
+    m_background = c;
+    invalidate();
+    emit backgroundColorChanged();
+  }
+
+  const QColor &
+  getBackgroundColor() const
+  {
+    return m_background;
+  }
+
+  void
+  setAxesColor(const QColor &c)
+  {
+    m_axes = c;
+    invalidate();
+    emit axesColorChanged();
+  }
+
+  const QColor &
+  getAxesColor() const
+  {
+    return m_axes;
+  }
+
+  qreal
+  getSymbolPeriod() const
+  {
+    return m_period;
+  }
+
+  int
+  getSpan() const
+  {
+    return m_span;
+  }
+
+  SUFLOAT
+  getGain() const
+  {
+    return m_gain;
+  }
+
+  SUFLOAT
+  getRange() const
+  {
+    return m_range;
+  }
+
+  EyeDiagramComponent
+  getComponent() const
+  {
+    return m_component;
+  }
+
+  qreal
+  getPersistence() const
+  {
+    return m_persistence;
+  }
+
+  float
+  getDynamicRange() const
+  {
+    return m_dynamicRange;
+  }
+
+  // Changing any of these clears the diagram
+  void setSymbolPeriod(qreal samples);
+  void setSpan(int symbols);
+  void setGain(SUFLOAT);
+  void setRange(SUFLOAT);
+  void setComponent(EyeDiagramComponent);
+  void setResolution(int columns, int rows);
+
+  // Moves the traces to come `samples` samples to the right
+  void shift(qreal samples);
+
+  void setPersistence(qreal traces);
+  void setDynamicRange(float db);
+  void setPalette(const QColor *table);
+  void clear();
+
+  void feed(const SUCOMPLEX *samples, SUSCOUNT length);
+
+  void draw() override;
+  void paint() override;
+  void interactionFinished() override;
+
+  EyeDiagram(QWidget *parent = nullptr);
+
+  void memoryUsage(SuWidgetsMemoryUsage &) const override;
+
+signals:
+  void backgroundColorChanged();
+  void axesColorChanged();
+
+public slots:
+  // Private slots
+  void onFed();
+};
+
+#endif // EYEDIAGRAM_H
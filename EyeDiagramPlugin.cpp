@@ -0,0 +1,89 @@
+//
+//    EyeDiagramPlugin.cpp: Plugin for the eye diagram
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "EyeDiagram.h"
+#include "EyeDiagramPlugin.h"
+
+#include <QtPlugin>
+
+EyeDiagramPlugin::EyeDiagramPlugin(QObject *parent)
+  : QObject(parent)
+{
+  m_initialized = false;
+}
+
+void EyeDiagramPlugin::initialize(QDesignerFormEditorInterface * /* core */)
+{
+  if (m_initialized)
+    return;
+
+  // Add extension registrations, etc. here
+
+  m_initialized = true;
+}
+
+bool EyeDiagramPlugin::isInitialized() const
+{
+  return m_initialized;
+}
+
+QWidget *EyeDiagramPlugin::createWidget(QWidget *parent)
+{
+  return new EyeDiagram(parent);
+}
+
+QString EyeDiagramPlugin::name() const
+{
+  return QLatin1String("EyeDiagram");
+}
+
+QString EyeDiagramPlugin::group() const
+{
+  return QLatin1String("");
+}
+
+QIcon EyeDiagramPlugin::icon() const
+{
+  return QIcon(":/icons/open_icon.png");
+}
+
+QString EyeDiagramPlugin::toolTip() const
+{
+  return QLatin1String("");
+}
+
+QString EyeDiagramPlugin::whatsThis() const
+{
+  return QLatin1String("Density eye diagram of a baseband signal");
+}
+
+bool EyeDiagramPlugin::isContainer() const
+{
+  return false;
+}
+
+QString EyeDiagramPlugin::domXml() const
+{
+  return QLatin1String("<widget class=\"EyeDiagram\" name=\"eyeDiagram\">\n</widget>\n");
+}
+
+QString EyeDiagramPlugin::includeFile() const
+{
+  return QLatin1String("EyeDiagram.h");
+}
+
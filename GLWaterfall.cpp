@@ -48,6 +48,7 @@
 #endif
 
 #include "SuWidgetsHelpers.h"
+#include "SuWidgetsKernels.h"
 #include "GLWaterfall.h"
 #include "gradient.h"
 
@@ -58,6 +59,7 @@
 #define GL_WATERFALL_TEX_MAX_DB  (200.f)
 #define GL_WATERFALL_TEX_DR      (GL_WATERFALL_TEX_MAX_DB - GL_WATERFALL_TEX_MIN_DB)
 #define GL_WATERFALL_MAX_LINE_POOL_SIZE 30
+#define GL_WATERFALL_MIN_ROW_COUNT      256
 #define GL_WATERFALL_MIN_BULK_TRANSFER  10
 
 struct vertex {
@@ -201,15 +203,12 @@ GLLine::reduceMean(const float *values, int length)
   float k       = 1. / chunkSize;
 
   if (chunkSize > 0) {
-    int i, j, p = 0;
+    int p;
 
-#pragma GCC unroll 4
-    for (i = 0; i < length; i += chunkSize) {
-      float val = 0;
-      for (j = 0; j < chunkSize; ++j)
-        val += k * values[i + j];
-      data[p++] = val;
-    }
+    for (p = 0; p < res; ++p)
+      data[p] = k * SuWidgetsKernels::sum(
+            values + p * chunkSize,
+            static_cast<SUSCOUNT>(chunkSize));
 
     rescaleMean();
   }
@@ -223,18 +222,12 @@ GLLine::reduceMax(const float *values, int length)
   float *data   = this->data();
 
   if (chunkSize > 0) {
-    int i, p = 0;
+    int p;
 
-#pragma GCC unroll 4
-    for (i = 0; i < length; i += chunkSize) {
-      float max = -INFINITY;
-      int j;
-      for (j = 0; j < chunkSize; ++j)
-        if (values[i + j] > max)
-          max = values[i + j];
-
-      data[p++] = max;
-    }
+    for (p = 0; p < res; ++p)
+      data[p] = SuWidgetsKernels::maximum(
+            values + p * chunkSize,
+            static_cast<SUSCOUNT>(chunkSize));
 
     rescaleMax();
   }
@@ -502,6 +495,60 @@ GLWaterfallOpenGLContext::flushLinePool()
   m_pool.clear();
 }
 
+quint64
+GLWaterfallOpenGLContext::lineMemoryUsage() const
+{
+  quint64 bytes = 0;
+
+  for (auto const &line : m_history)
+    bytes += line.capacity() * sizeof(float);
+
+  for (auto const &line : m_pool)
+    bytes += line.capacity() * sizeof(float);
+
+  return bytes;
+}
+
+quint64
+GLWaterfallOpenGLContext::textureMemoryUsage() const
+{
+  quint64 texels;
+
+  if (m_waterfall == nullptr || !m_waterfall->isCreated())
+    return 0;
+
+  // R16F, plus a third for the mipmaps
+  texels = SCAST(quint64, GLLine::allocationFor(m_rowSize))
+      * SCAST(quint64, m_rowCount);
+
+  return texels * 2 * 4 / 3;
+}
+
+//
+// Halves the number of rows of the waterfall texture (i.e. the length of
+// the visible history), down to GL_WATERFALL_MIN_ROW_COUNT. The waterfall
+// is cleared. Requires the GL context to be current.
+//
+quint64
+GLWaterfallOpenGLContext::shrinkTexture()
+{
+  quint64 before = textureMemoryUsage();
+
+  if (before == 0 || m_rowCount / 2 < GL_WATERFALL_MIN_ROW_COUNT)
+    return 0;
+
+  m_rowCount /= 2;
+  m_row       = 0;
+
+  while (m_history.size() > SCAST(unsigned, m_rowCount))
+    m_history.pop_back();
+
+  flushLinePool();
+  resetWaterfall();
+
+  return before - textureMemoryUsage();
+}
+
 void
 GLWaterfallOpenGLContext::setPalette(const QColor *table)
 {
@@ -708,6 +755,54 @@ GLWaterfall::~GLWaterfall()
   doneCurrent();
 }
 
+void
+GLWaterfall::memoryUsage(SuWidgetsMemoryUsage &usage) const
+{
+  AbstractWaterfall::memoryUsage(usage);
+
+  usage[SUWIDGETS_MEMORY_HISTORIES] += m_glCtx.lineMemoryUsage();
+  usage[SUWIDGETS_MEMORY_TEXTURES]  += m_glCtx.textureMemoryUsage();
+}
+
+//
+// Histories: the pool of recycled lines is released, then time history
+// levels (see AbstractWaterfall::reclaimMemory). Textures: the
+// waterfall is made shorter (see GLWaterfallOpenGLContext::shrinkTexture)
+//
+quint64
+GLWaterfall::reclaimMemory(SuWidgetsMemoryCategory category, quint64 bytes)
+{
+  quint64 freed = 0;
+  quint64 before;
+
+  switch (category) {
+    case SUWIDGETS_MEMORY_HISTORIES:
+      before = m_glCtx.lineMemoryUsage();
+      m_glCtx.flushLinePool();
+      freed = before - m_glCtx.lineMemoryUsage();
+      if (freed < bytes)
+        freed += AbstractWaterfall::reclaimMemory(category, bytes - freed);
+      break;
+
+    case SUWIDGETS_MEMORY_TEXTURES:
+      makeCurrent();
+      while (freed < bytes) {
+        quint64 step = m_glCtx.shrinkTexture();
+        if (step == 0)
+          break;
+        freed += step;
+      }
+      doneCurrent();
+      update();
+      break;
+
+    default:
+      break;
+  }
+
+  return freed;
+}
+
 void
 GLWaterfall::clearWaterfall()
 {
@@ -794,6 +889,22 @@ GLWaterfall::paintGL()
       height() * dpi_factor, left, right);
 }
 
+//
+// Lines still waiting to be uploaded are dropped and the texture is
+// cleared before replaying the history rows.
+//
+void
+GLWaterfall::redrawWaterfallHistory()
+{
+  makeCurrent();
+
+  m_glCtx.m_history.clear();
+  if (m_glCtx.m_waterfall != nullptr && m_glCtx.m_waterfall->isCreated())
+    m_glCtx.resetWaterfall();
+
+  AbstractWaterfall::redrawWaterfallHistory();
+}
+
 void GLWaterfall::addNewWfLine(const float* wfData, int size, int repeats)
 {
   makeCurrent();
@@ -196,6 +196,9 @@ struct GLWaterfallOpenGLContext {
   void                     flushLinesBulk();
   void                     flushLines();
   void                     flushLinePool();
+  quint64                  lineMemoryUsage() const;
+  quint64                  textureMemoryUsage() const;
+  quint64                  shrinkTexture();
   void                     flushPalette();
   void                     setDynamicRange(float, float);
   void                     resetWaterfall();
@@ -213,6 +216,9 @@ class GLWaterfall : public AbstractWaterfall
     explicit GLWaterfall(QWidget *parent = nullptr);
     ~GLWaterfall() override;
 
+    void memoryUsage(SuWidgetsMemoryUsage &) const override;
+    quint64 reclaimMemory(SuWidgetsMemoryCategory, quint64) override;
+
     void initializeGL() override;
     void paintGL() override;
 
@@ -233,6 +239,7 @@ class GLWaterfall : public AbstractWaterfall
 
   protected:
     void addNewWfLine(const float *wfData, int size, int repeats) override;
+    void redrawWaterfallHistory() override;
 };
 
 #endif // GL_WATERFALL_H
@@ -0,0 +1,1145 @@
+//
+//    GLWaveform.cpp: OpenGL time view widget
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+// Apple deprecated OpenGL, I don't need to be warned, but for now it still works
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+
+#include "GLWaveform.h"
+#include <QPainter>
+#include <QVector2D>
+#include <cmath>
+
+extern QColor yiqTable[];
+
+#define GL_WAVEFORM_YIQ_SIZE 1024
+
+//
+// Zoomed out: one fragment per pixel, the pixel column is mapped to the
+// range of blocks it covers and the limits of these blocks are reduced
+// in the shader. This reproduces WaveView::drawWaveFar.
+//
+static const char *farVertexShader = R"(
+  attribute vec2 vertex_coords;
+
+  void
+  main()
+  {
+    gl_Position = vec4(vertex_coords, 0.0, 1.0);
+  }
+)";
+
+static const char *farFragmentShader = R"(
+  uniform sampler2D m_blocks;
+  uniform sampler2D m_yiq;
+  uniform sampler2D m_palette;
+  uniform vec2      texSize;
+  uniform float     count;
+  uniform float     offset;
+  uniform float     bpp;
+  uniform float     vMin;
+  uniform float     upp;
+  uniform vec4      fg;
+  uniform float     mode;
+  uniform float     contrast;
+  uniform float     origin;
+  uniform float     showWf;
+  uniform float     showEnv;
+
+  const float PI2 = 6.283185307179586;
+
+  vec4
+  fetch(float i)
+  {
+    float row = floor(i / texSize.x);
+    float col = i - row * texSize.x;
+    return texture2D(
+      m_blocks,
+      vec2((col + 0.5) / texSize.x, (row + 0.5) / texSize.y));
+  }
+
+  vec3
+  phaseColor(float p)
+  {
+    if (mode > 1.5) {
+      float idx = mod(floor(contrast * p / PI2 * 255.0) + origin, 256.0);
+      return texture2D(m_palette, vec2((idx + 0.5) / 256.0, 0.5)).rgb;
+    } else if (mode > 0.5) {
+      if (p < 0.0)
+        p += PI2;
+      return texture2D(m_yiq, vec2(p / PI2, 0.5)).rgb;
+    }
+
+    return fg.rgb;
+  }
+
+  void
+  main()
+  {
+    float x    = floor(gl_FragCoord.x);
+    float b0   = max(ceil(x * bpp + offset), 0.0);
+    float b1   = min(ceil((x + 1.0) * bpp + offset), count);
+    float v    = vMin + floor(gl_FragCoord.y) * upp;
+    float h    = 0.5 * upp;
+    float lo   = 1e30;
+    float hi   = -1e30;
+    float env  = 0.0;
+    float step = max(1.0, ceil((b1 - b0) / %1.0));
+    vec4  last = vec4(0.0);
+    vec4  c    = vec4(0.0);
+
+    if (b1 <= b0)
+      discard;
+
+    // Join with the previous column
+    if (b0 > 0.0) {
+      vec4 prev = fetch(b0 - 1.0);
+      lo = prev.g;
+      hi = prev.r;
+    }
+
+    for (int i = 0; i < %1; ++i) {
+      float b = b0 + float(i) * step;
+      if (b >= b1)
+        break;
+      last = fetch(b);
+      lo   = min(lo, last.r);
+      hi   = max(hi, last.g);
+      env  = max(env, last.b);
+    }
+
+    if (showEnv > 0.5 && abs(v) <= env + h)
+      c = vec4(phaseColor(last.a), showWf > 0.5 ? 0.33 : 1.0);
+
+    if (showWf > 0.5 && v >= lo - h && v <= hi + h) {
+      float a   = showEnv > 0.5 ? 0.33 : 0.66;
+      float alpha = a + c.a * (1.0 - a);
+      c = vec4((fg.rgb * a + c.rgb * c.a * (1.0 - a)) / alpha, alpha);
+    }
+
+    if (c.a <= 0.0)
+      discard;
+
+    gl_FragColor = c;
+  }
+)";
+
+//
+// Zoomed in: samples (and the envelope around them) are uploaded as
+// vertices, relative to the first sample of the window.
+//
+static const char *closeVertexShader = R"(
+  attribute vec2  sample_coords;
+  attribute float sample_param;
+  uniform   float offset;
+  uniform   float spp;
+  uniform   float vMin;
+  uniform   float upp;
+  uniform   float width;
+  uniform   float height;
+  uniform   float pointSize;
+  varying   float f_param;
+
+  void
+  main()
+  {
+    float x = (sample_coords.x - offset) / spp + 0.5;
+    float y = (sample_coords.y - vMin) / upp + 0.5;
+
+    gl_Position  = vec4(2.0 * x / width - 1.0, 2.0 * y / height - 1.0, 0.0, 1.0);
+    gl_PointSize = pointSize;
+    f_param      = sample_param;
+  }
+)";
+
+static const char *closeFragmentShader = R"(
+  uniform sampler2D m_yiq;
+  uniform sampler2D m_palette;
+  uniform vec4      fg;
+  uniform float     mode;
+  uniform float     contrast;
+  uniform float     origin;
+  varying float     f_param;
+
+  const float PI2 = 6.283185307179586;
+
+  void
+  main()
+  {
+    vec3 color = fg.rgb;
+
+    if (mode > 1.5) {
+      float idx = mod(floor(contrast * f_param / PI2 * 255.0) + origin, 256.0);
+      color = texture2D(m_palette, vec2((idx + 0.5) / 256.0, 0.5)).rgb;
+    } else if (mode > 0.5) {
+      float p = f_param < 0.0 ? f_param + PI2 : f_param;
+      color = texture2D(m_yiq, vec2(p / PI2, 0.5)).rgb;
+    }
+
+    gl_FragColor = vec4(color, fg.a);
+  }
+)";
+
+static const float quadVertices[] = {
+  -1, -1,
+  +1, -1,
+  -1, +1,
+  +1, +1
+};
+
+////////////////////////// GLWaveformOpenGLContext /////////////////////////////
+GLWaveformOpenGLContext::GLWaveformOpenGLContext() :
+  m_quad(QOpenGLBuffer::VertexBuffer),
+  m_samples(QOpenGLBuffer::VertexBuffer),
+  m_envelope(QOpenGLBuffer::VertexBuffer)
+{
+  m_paletBuf.resize(256 * 4);
+}
+
+GLWaveformOpenGLContext::~GLWaveformOpenGLContext()
+{
+  finalize();
+
+  delete m_blocks;
+  delete m_yiq;
+  delete m_palette;
+  delete m_functions;
+}
+
+void
+GLWaveformOpenGLContext::initialize()
+{
+  QImage yiq(GL_WAVEFORM_YIQ_SIZE, 1, QImage::Format_RGBX8888);
+
+  for (int i = 0; i < GL_WAVEFORM_YIQ_SIZE; ++i)
+    yiq.setPixel(i, 0, yiqTable[i].rgb());
+
+  if (m_functions == nullptr)
+    m_functions = new QOpenGLFunctions(QOpenGLContext::currentContext());
+
+  m_functions->glEnable(GL_BLEND);
+  m_functions->glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+#ifdef GL_PROGRAM_POINT_SIZE
+  m_functions->glEnable(GL_PROGRAM_POINT_SIZE);
+#endif // GL_PROGRAM_POINT_SIZE
+
+  m_vao.create();
+  if (m_vao.isCreated())
+    m_vao.bind();
+
+  m_quad.create();
+  m_quad.bind();
+  m_quad.allocate(quadVertices, sizeof(quadVertices));
+  m_quad.release();
+
+  m_samples.create();
+  m_samples.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+  m_envelope.create();
+  m_envelope.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+
+  m_yiq = new QOpenGLTexture(QOpenGLTexture::Target2D);
+  m_yiq->setWrapMode(QOpenGLTexture::ClampToEdge);
+  m_yiq->setMinificationFilter(QOpenGLTexture::Nearest);
+  m_yiq->setMagnificationFilter(QOpenGLTexture::Nearest);
+  m_yiq->setData(yiq, QOpenGLTexture::DontGenerateMipMaps);
+
+  m_palette = new QOpenGLTexture(QOpenGLTexture::Target2D);
+  m_palette->setWrapMode(QOpenGLTexture::ClampToEdge);
+  m_palette->setMinificationFilter(QOpenGLTexture::Nearest);
+  m_palette->setMagnificationFilter(QOpenGLTexture::Nearest);
+  m_palette->setSize(256, 1);
+  m_palette->setFormat(QOpenGLTexture::RGBA8_UNorm);
+  m_palette->allocateStorage(
+      QOpenGLTexture::PixelFormat::RGBA,
+      QOpenGLTexture::PixelType::UInt8);
+  m_updatePalette = true;
+
+  m_blocks = new QOpenGLTexture(QOpenGLTexture::Target2D);
+
+  m_farProgram.addShaderFromSourceCode(
+        QOpenGLShader::Vertex,
+        farVertexShader);
+  m_farProgram.addShaderFromSourceCode(
+        QOpenGLShader::Fragment,
+        QString(farFragmentShader).arg(GL_WAVEFORM_MAX_COL_BLOCKS));
+  m_farProgram.link();
+
+  m_closeProgram.addShaderFromSourceCode(
+        QOpenGLShader::Vertex,
+        closeVertexShader);
+  m_closeProgram.addShaderFromSourceCode(
+        QOpenGLShader::Fragment,
+        closeFragmentShader);
+  m_closeProgram.link();
+
+  if (m_vao.isCreated())
+    m_vao.release();
+
+  m_window.valid = false;
+}
+
+void
+GLWaveformOpenGLContext::finalize()
+{
+  if (m_vao.isCreated())
+    m_vao.destroy();
+
+  m_quad.destroy();
+  m_samples.destroy();
+  m_envelope.destroy();
+
+  if (m_blocks != nullptr && m_blocks->isCreated())
+    m_blocks->destroy();
+
+  if (m_yiq != nullptr && m_yiq->isCreated())
+    m_yiq->destroy();
+
+  if (m_palette != nullptr && m_palette->isCreated())
+    m_palette->destroy();
+
+  m_window.valid = false;
+}
+
+void
+GLWaveformOpenGLContext::setPalette(const QColor *table)
+{
+  for (int i = 0; i < 256; ++i) {
+    m_paletBuf[4 * i + 0] = static_cast<uint8_t>(table[i].red());
+    m_paletBuf[4 * i + 1] = static_cast<uint8_t>(table[i].green());
+    m_paletBuf[4 * i + 2] = static_cast<uint8_t>(table[i].blue());
+    m_paletBuf[4 * i + 3] = 255;
+  }
+
+  m_updatePalette = true;
+}
+
+void
+GLWaveformOpenGLContext::flushPalette()
+{
+  m_palette->setData(
+        QOpenGLTexture::PixelFormat::RGBA,
+        QOpenGLTexture::PixelType::UInt8,
+        m_paletBuf.data());
+}
+
+/////////////////////////////// GLWaveform /////////////////////////////////////
+GLWaveform::GLWaveform(QWidget *parent) :
+  QOpenGLWidget(parent),
+  m_data(&m_view)
+{
+  m_view.setSampleRate(1024000);
+  m_view.setForeground(m_foreground);
+
+  connect(
+        &m_view,
+        SIGNAL(ready()),
+        this,
+        SLOT(onWaveViewChanges()));
+
+  connect(
+        &m_view,
+        SIGNAL(progress()),
+        this,
+        SLOT(onWaveViewChanges()));
+}
+
+GLWaveform::~GLWaveform()
+{
+  makeCurrent();
+  m_glCtx.finalize();
+  doneCurrent();
+}
+
+void
+GLWaveform::initializeGL()
+{
+  m_glCtx.initialize();
+
+  connect(
+      context(),
+      SIGNAL(aboutToBeDestroyed()),
+      this,
+      SLOT(onContextBeingDestroyed()));
+}
+
+void
+GLWaveform::onContextBeingDestroyed()
+{
+  makeCurrent();
+  m_glCtx.finalize();
+  doneCurrent();
+}
+
+//
+// Same level selection as WaveView::drawWave. Returns -1 if raw samples
+// must be drawn instead.
+//
+int
+GLWaveform::selectLevel() const
+{
+  qreal spp = m_view.getSamplesPerPixel();
+  int levels = m_view.getWaveTree()->size();
+  int level;
+
+  if (spp <= GL_WAVEFORM_CLOSE_SPP || levels == 0)
+    return -1;
+
+  level = SCAST(int, floor(log(spp) / log(WAVEFORM_BLOCK_LENGTH))) - 1;
+
+  if (level < 0)
+    level = 0;
+
+  if (level >= levels)
+    level = levels - 1;
+
+  return level;
+}
+
+bool
+GLWaveform::uploadBlocks(int level, qint64 from, qint64 to)
+{
+  const WaveLimitVector &blocks = (*m_view.getWaveTree())[level];
+  GLWaveformWindow &window = m_glCtx.m_window;
+  qint64 size = SCAST(qint64, blocks.size());
+  qint64 span = to - from;
+  qint64 margin = span * (GL_WAVEFORM_WINDOW_SPANS - 1) / 2;
+  qint64 first, last, count;
+  GLint maxTexSize = 0;
+  int rows, texRows;
+  float *buf;
+
+  first = qMax(SCAST(qint64, 0), from - margin);
+  last  = qMin(size, to + margin);
+  count = last - first;
+
+  if (count <= 0)
+    return false;
+
+  m_glCtx.m_functions->glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTexSize);
+
+  rows = SCAST(int, (count + GL_WAVEFORM_TEX_ROW_LEN - 1) / GL_WAVEFORM_TEX_ROW_LEN);
+  if (rows > maxTexSize || GL_WAVEFORM_TEX_ROW_LEN > maxTexSize)
+    return false;
+
+  // Round up the number of rows, so that small changes in the window
+  // size do not reallocate the texture
+  texRows = 1;
+  while (texRows < rows)
+    texRows <<= 1;
+
+  m_glCtx.m_blockBuf.resize(
+        SCAST(size_t, 4 * texRows * GL_WAVEFORM_TEX_ROW_LEN));
+  buf = m_glCtx.m_blockBuf.data();
+
+  for (qint64 i = 0; i < count; ++i) {
+    const WaveLimits &z = blocks[SCAST(size_t, first + i)];
+    SUFLOAT param;
+
+    if (m_showPhaseDiff)
+      param = z.freq < 0 ? z.freq + SCAST(SUFLOAT, 2 * PI) : z.freq;
+    else
+      param = SU_C_ARG(z.mean);
+
+    buf[4 * i + 0] = SCAST(float, m_view.cast(z.min));
+    buf[4 * i + 1] = SCAST(float, m_view.cast(z.max));
+    buf[4 * i + 2] = SCAST(float, z.envelope);
+    buf[4 * i + 3] = SCAST(float, param);
+  }
+
+  if (!m_glCtx.m_blocks->isCreated()
+      || m_glCtx.m_blocks->height() != texRows) {
+    if (m_glCtx.m_blocks->isCreated())
+      m_glCtx.m_blocks->destroy();
+
+    m_glCtx.m_blocks->setSize(GL_WAVEFORM_TEX_ROW_LEN, texRows);
+    m_glCtx.m_blocks->setFormat(QOpenGLTexture::RGBA32F);
+    m_glCtx.m_blocks->setWrapMode(QOpenGLTexture::ClampToEdge);
+    m_glCtx.m_blocks->setMinificationFilter(QOpenGLTexture::Nearest);
+    m_glCtx.m_blocks->setMagnificationFilter(QOpenGLTexture::Nearest);
+    m_glCtx.m_blocks->allocateStorage(
+        QOpenGLTexture::PixelFormat::RGBA,
+        QOpenGLTexture::PixelType::Float32);
+  }
+
+  m_glCtx.m_blocks->setData(
+        QOpenGLTexture::PixelFormat::RGBA,
+        QOpenGLTexture::PixelType::Float32,
+        buf);
+
+  window.level = level;
+  window.first = first;
+  window.count = count;
+  window.valid = true;
+
+  return true;
+}
+
+void
+GLWaveform::uploadSamples(qint64 from, qint64 to)
+{
+  const WaveViewTree *tree = m_view.getWaveTree();
+  const SUCOMPLEX *data = tree->getData();
+  GLWaveformWindow &window = m_glCtx.m_window;
+  qint64 size = SCAST(qint64, tree->getLength());
+  qint64 span = to - from;
+  qint64 margin = span * (GL_WAVEFORM_WINDOW_SPANS - 1) / 2;
+  qint64 first, last, count;
+  SUFLOAT prevPhase = 0;
+
+  first = qMax(SCAST(qint64, 0), from - margin);
+  last  = qMin(size, to + margin);
+  count = last - first;
+
+  window.level = -1;
+  window.first = first;
+  window.count = qMax(count, SCAST(qint64, 0));
+  window.valid = true;
+
+  if (count <= 0)
+    return;
+
+  m_glCtx.m_sampleBuf.resize(SCAST(size_t, 2 * count));
+
+  for (qint64 i = 0; i < count; ++i) {
+    m_glCtx.m_sampleBuf[2 * i + 0] = SCAST(float, i);
+    m_glCtx.m_sampleBuf[2 * i + 1] = SCAST(float, m_view.cast(data[first + i]));
+  }
+
+  m_glCtx.m_samples.bind();
+  m_glCtx.m_samples.allocate(
+        m_glCtx.m_sampleBuf.data(),
+        SCAST(int, m_glCtx.m_sampleBuf.size() * sizeof(float)));
+  m_glCtx.m_samples.release();
+
+  if (m_showEnvelope) {
+    if (first > 0)
+      prevPhase = SU_C_ARG(data[first - 1]);
+
+    m_glCtx.m_envelopeBuf.resize(SCAST(size_t, 6 * count));
+
+    for (qint64 i = 0; i < count; ++i) {
+      float *v     = m_glCtx.m_envelopeBuf.data() + 6 * i;
+      SUFLOAT mag   = SU_C_ABS(data[first + i]);
+      SUFLOAT phase = SU_C_ARG(data[first + i]);
+      SUFLOAT param = phase;
+
+      if (m_showPhaseDiff) {
+        param = phase - prevPhase;
+        if (param < 0)
+          param += SCAST(SUFLOAT, 2 * PI);
+      }
+
+      prevPhase = phase;
+
+      v[0] = v[3] = SCAST(float, i);
+      v[1] = +SCAST(float, mag);
+      v[4] = -SCAST(float, mag);
+      v[2] = v[5] = SCAST(float, param);
+    }
+
+    m_glCtx.m_envelope.bind();
+    m_glCtx.m_envelope.allocate(
+          m_glCtx.m_envelopeBuf.data(),
+          SCAST(int, m_glCtx.m_envelopeBuf.size() * sizeof(float)));
+    m_glCtx.m_envelope.release();
+  }
+}
+
+void
+GLWaveform::setCommonUniforms(QOpenGLShaderProgram &program, int h)
+{
+  qreal mode = 0;
+
+  if (m_showPhase)
+    mode = m_showPhaseDiff ? 2 : 1;
+
+  program.setUniformValue("m_yiq", 1);
+  program.setUniformValue("m_palette", 2);
+  program.setUniformValue("vMin", SCAST(GLfloat, m_view.getMin()));
+  program.setUniformValue(
+        "upp",
+        SCAST(GLfloat, m_view.getViewRange() / h));
+  program.setUniformValue("mode", SCAST(GLfloat, mode));
+  program.setUniformValue("contrast", SCAST(GLfloat, m_phaseDiffContrast));
+  program.setUniformValue("origin", SCAST(GLfloat, m_phaseDiffOrigin));
+}
+
+void
+GLWaveform::renderFar(int level)
+{
+  GLWaveformWindow &window = m_glCtx.m_window;
+  int w = m_view.width();
+  int h = m_view.height();
+  int levels = m_view.getWaveTree()->size();
+  int bits;
+  qint64 from, to, size;
+  qreal blockLen;
+  bool haveWindow = false;
+
+  // If the window does not fit in a texture, try with coarser levels
+  for (; level < levels && !haveWindow; ++level) {
+    bits     = (level + 1) * WAVEFORM_BLOCK_BITS;
+    size     = SCAST(qint64, (*m_view.getWaveTree())[level].size());
+    from     = SCAST(qint64, std::floor(m_view.px2samp(0))) >> bits;
+    to       = (SCAST(qint64, std::ceil(m_view.px2samp(w))) >> bits) + 2;
+    from     = qBound(SCAST(qint64, 0), from - 1, size);
+    to       = qBound(SCAST(qint64, 0), to, size);
+
+    if (from >= to)
+      return;
+
+    haveWindow = window.contains(level, from, to)
+        || uploadBlocks(level, from, to);
+  }
+
+  if (!haveWindow)
+    return;
+
+  bits     = (window.level + 1) * WAVEFORM_BLOCK_BITS;
+  blockLen = SCAST(qreal, 1ll << bits);
+
+  m_glCtx.m_farProgram.bind();
+  setCommonUniforms(m_glCtx.m_farProgram, h);
+
+  m_glCtx.m_farProgram.setUniformValue("m_blocks", 0);
+  m_glCtx.m_farProgram.setUniformValue(
+        "texSize",
+        QVector2D(
+          GL_WAVEFORM_TEX_ROW_LEN,
+          m_glCtx.m_blocks->height()));
+  m_glCtx.m_farProgram.setUniformValue(
+        "count",
+        SCAST(GLfloat, window.count));
+  m_glCtx.m_farProgram.setUniformValue(
+        "offset",
+        SCAST(GLfloat,
+          SCAST(qreal, m_view.getSampleStart() - (window.first << bits))
+          / blockLen));
+  m_glCtx.m_farProgram.setUniformValue(
+        "bpp",
+        SCAST(GLfloat, m_view.getSamplesPerPixel() / blockLen));
+  m_glCtx.m_farProgram.setUniformValue("fg", m_foreground);
+  m_glCtx.m_farProgram.setUniformValue(
+        "showWf",
+        SCAST(GLfloat, m_showWaveform ? 1 : 0));
+  m_glCtx.m_farProgram.setUniformValue(
+        "showEnv",
+        SCAST(GLfloat, m_showEnvelope ? 1 : 0));
+
+  m_glCtx.m_blocks->bind(0);
+  m_glCtx.m_yiq->bind(1);
+  m_glCtx.m_palette->bind(2);
+
+  m_glCtx.m_quad.bind();
+  m_glCtx.m_farProgram.setAttributeBuffer(
+        "vertex_coords",
+        GL_FLOAT,
+        0,
+        2,
+        2 * sizeof(float));
+  m_glCtx.m_farProgram.enableAttributeArray("vertex_coords");
+
+  m_glCtx.m_functions->glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+  m_glCtx.m_farProgram.disableAttributeArray("vertex_coords");
+  m_glCtx.m_quad.release();
+
+  m_glCtx.m_blocks->release();
+  m_glCtx.m_yiq->release();
+  m_glCtx.m_palette->release();
+  m_glCtx.m_farProgram.release();
+}
+
+void
+GLWaveform::renderClose()
+{
+  QOpenGLShaderProgram &program = m_glCtx.m_closeProgram;
+  GLWaveformWindow &window = m_glCtx.m_window;
+  int w = m_view.width();
+  int h = m_view.height();
+  qreal spp = m_view.getSamplesPerPixel();
+  qint64 size = SCAST(qint64, m_view.getLength());
+  qint64 from, to;
+  QColor color = m_foreground;
+
+  from = qBound(
+        SCAST(qint64, 0),
+        SCAST(qint64, std::floor(m_view.px2samp(0))) - 1,
+        size);
+  to   = qBound(
+        SCAST(qint64, 0),
+        SCAST(qint64, std::ceil(m_view.px2samp(w))) + 2,
+        size);
+
+  if (from >= to)
+    return;
+
+  if (!window.contains(-1, from, to))
+    uploadSamples(from, to);
+
+  if (window.count <= 0)
+    return;
+
+  program.bind();
+  setCommonUniforms(program, h);
+
+  program.setUniformValue(
+        "offset",
+        SCAST(GLfloat, m_view.getSampleStart() - window.first));
+  program.setUniformValue("spp", SCAST(GLfloat, spp));
+  program.setUniformValue("width", SCAST(GLfloat, w));
+  program.setUniformValue("height", SCAST(GLfloat, h));
+  program.setUniformValue(
+        "pointSize",
+        SCAST(GLfloat, WAVEFORM_CIRCLE_DIM * devicePixelRatioF()));
+
+  m_glCtx.m_yiq->bind(1);
+  m_glCtx.m_palette->bind(2);
+
+  if (m_showEnvelope) {
+    color.setAlphaF(m_showWaveform ? .33 : 1.);
+    program.setUniformValue("fg", color);
+
+    m_glCtx.m_envelope.bind();
+    program.setAttributeBuffer(
+          "sample_coords",
+          GL_FLOAT,
+          0,
+          2,
+          3 * sizeof(float));
+    program.setAttributeBuffer(
+          "sample_param",
+          GL_FLOAT,
+          2 * sizeof(float),
+          1,
+          3 * sizeof(float));
+    program.enableAttributeArray("sample_coords");
+    program.enableAttributeArray("sample_param");
+
+    m_glCtx.m_functions->glDrawArrays(
+          GL_TRIANGLE_STRIP,
+          0,
+          SCAST(GLsizei, 2 * window.count));
+
+    program.disableAttributeArray("sample_param");
+    m_glCtx.m_envelope.release();
+  }
+
+  if (m_showWaveform) {
+    color.setAlphaF(spp > 1 ? sqrt(1. / spp) : 1.);
+    program.setUniformValue("fg", color);
+    program.setUniformValue("mode", SCAST(GLfloat, 0));
+    program.setAttributeValue("sample_param", SCAST(GLfloat, 0));
+
+    m_glCtx.m_samples.bind();
+    program.setAttributeBuffer(
+          "sample_coords",
+          GL_FLOAT,
+          0,
+          2,
+          2 * sizeof(float));
+    program.enableAttributeArray("sample_coords");
+
+    m_glCtx.m_functions->glDrawArrays(
+          GL_LINE_STRIP,
+          0,
+          SCAST(GLsizei, window.count));
+
+    if (spp < 1. / (2 * WAVEFORM_CIRCLE_DIM))
+      m_glCtx.m_functions->glDrawArrays(
+            GL_POINTS,
+            0,
+            SCAST(GLsizei, window.count));
+
+    m_glCtx.m_samples.release();
+  }
+
+  program.disableAttributeArray("sample_coords");
+
+  m_glCtx.m_yiq->release();
+  m_glCtx.m_palette->release();
+  program.release();
+}
+
+void
+GLWaveform::drawStatus(QString const &text)
+{
+  QPainter p(this);
+
+  p.setPen(m_foreground);
+  p.drawText(rect(), Qt::AlignCenter, text);
+  p.end();
+}
+
+void
+GLWaveform::paintGL()
+{
+  qreal dpr = devicePixelRatioF();
+  int w = SCAST(int, width() * dpr);
+  int h = SCAST(int, height() * dpr);
+  int level;
+
+  if (w < 1 || h < 1)
+    return;
+
+  m_view.setGeometry(w, h);
+
+  if (!m_haveGeometry) {
+    m_haveGeometry = true;
+    if (m_autoFitToEnvelope)
+      fitToEnvelope();
+    else
+      zoomVerticalReset();
+    zoomHorizontalReset();
+  }
+
+  m_glCtx.m_functions->glViewport(0, 0, w, h);
+  m_glCtx.m_functions->glClearColor(
+        SCAST(GLfloat, m_background.redF()),
+        SCAST(GLfloat, m_background.greenF()),
+        SCAST(GLfloat, m_background.blueF()),
+        1.f);
+  m_glCtx.m_functions->glClear(GL_COLOR_BUFFER_BIT);
+
+  if (!m_view.isComplete()) {
+    drawStatus(
+          m_view.isRunning()
+          ? "Processing waveform"
+          : "No wave data");
+    return;
+  }
+
+  if (m_view.getLength() == 0)
+    return;
+
+  if (m_glCtx.m_vao.isCreated())
+    m_glCtx.m_vao.bind();
+
+  m_glCtx.m_functions->glEnable(GL_BLEND);
+  m_glCtx.m_functions->glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  if (m_glCtx.m_updatePalette) {
+    m_glCtx.flushPalette();
+    m_glCtx.m_updatePalette = false;
+  }
+
+  level = selectLevel();
+
+  if (level < 0)
+    renderClose();
+  else
+    renderFar(level);
+
+  if (m_glCtx.m_vao.isCreated())
+    m_glCtx.m_vao.release();
+}
+
+/////////////////////////////// Data and zoom //////////////////////////////////
+void
+GLWaveform::setData(
+    const std::vector<SUCOMPLEX> *data,
+    bool keepView,
+    bool flush)
+{
+  bool   appending  = data != nullptr && data == m_data.loanedBuffer();
+  qint64 prevLength = SCAST(qint64, m_view.getLength());
+  qint64 newLength  = data == nullptr ? 0 : static_cast<qint64>(data->size());
+  qint64 extra      = newLength - prevLength;
+
+  m_askedToKeepView = keepView;
+
+  if (appending) {
+    if (flush) {
+      m_view.setBuffer(data);
+    } else if (extra > 0) {
+      m_view.refreshBuffer(data);
+    }
+  } else {
+    if (data != nullptr)
+      m_data = WaveBuffer(&m_view, data);
+    else
+      m_data = WaveBuffer(&m_view);
+  }
+
+  invalidateWindow();
+}
+
+void
+GLWaveform::setData(
+    const SUCOMPLEX *data,
+    size_t size,
+    bool keepView,
+    bool flush,
+    bool appending)
+{
+  qint64 prevLength = SCAST(qint64, m_view.getLength());
+  qint64 extra      = size - prevLength;
+
+  m_askedToKeepView = keepView;
+
+  if (appending) {
+    if (flush) {
+      m_view.setBuffer(data, size);
+    } else if (extra > 0) {
+      m_view.refreshBuffer(data, size);
+    }
+  } else {
+    if (data != nullptr)
+      m_data = WaveBuffer(&m_view, data, size);
+    else
+      m_data = WaveBuffer(&m_view);
+  }
+
+  invalidateWindow();
+}
+
+void
+GLWaveform::safeCancel()
+{
+  m_view.safeCancel();
+}
+
+void
+GLWaveform::zoomHorizontalReset()
+{
+  if (m_haveGeometry) {
+    qint64 length = SCAST(qint64, m_data.length());
+
+    if (length > 0)
+      zoomHorizontal(SCAST(qint64, 0), length - 1);
+    else
+      zoomHorizontal(
+          SCAST(qint64, 0),
+          SCAST(qint64, getSampleRate()));
+  }
+}
+
+void
+GLWaveform::zoomHorizontal(qint64 start, qint64 end)
+{
+  if (start != getSampleStart() || end != getSampleEnd()) {
+    m_view.setHorizontalZoom(start, end);
+    update();
+    emit horizontalRangeChanged(start, end);
+  }
+}
+
+void
+GLWaveform::zoomHorizontal(qint64 x, qreal amount)
+{
+  qreal relPoint = SCAST(qreal, x) / m_view.width();
+  qreal fixedSamp = std::round(m_view.px2samp(x));
+  qreal newRange  = std::ceil(amount * m_view.getViewSampleInterval());
+
+  zoomHorizontal(
+        SCAST(qint64, std::round(fixedSamp - relPoint * newRange)),
+        SCAST(qint64, std::round(fixedSamp + (1.0 - relPoint) * newRange)));
+}
+
+void
+GLWaveform::zoomVerticalReset()
+{
+  zoomVertical(-1., 1.);
+}
+
+void
+GLWaveform::zoomVertical(qreal min, qreal max)
+{
+  m_view.setVerticalZoom(min, max);
+  update();
+  emit verticalRangeChanged(min, max);
+}
+
+void
+GLWaveform::fitToEnvelope()
+{
+  qreal envelope = m_view.getEnvelope();
+
+  if (envelope > 0)
+    zoomVertical(-envelope, envelope);
+}
+
+/////////////////////////////// Properties /////////////////////////////////////
+void
+GLWaveform::setBackgroundColor(const QColor &c)
+{
+  m_background = c;
+  update();
+  emit backgroundColorChanged();
+}
+
+void
+GLWaveform::setForegroundColor(const QColor &c)
+{
+  m_foreground = c;
+  m_view.setForeground(c);
+  update();
+  emit foregroundColorChanged();
+}
+
+void
+GLWaveform::setPalette(const QColor *table)
+{
+  m_view.setPalette(table);
+  m_glCtx.setPalette(table);
+  update();
+}
+
+void
+GLWaveform::setSampleRate(qreal rate)
+{
+  m_view.setSampleRate(rate);
+  update();
+}
+
+void
+GLWaveform::setRealComponent(bool real)
+{
+  m_view.setRealComponent(real);
+  invalidateWindow();
+  fitToEnvelope();
+  update();
+}
+
+void
+GLWaveform::setShowWaveform(bool show)
+{
+  m_showWaveform = show;
+  m_view.setShowWaveform(show);
+  update();
+}
+
+void
+GLWaveform::setShowEnvelope(bool show)
+{
+  m_showEnvelope = show;
+  m_view.setShowEnvelope(show);
+  invalidateWindow();
+  update();
+}
+
+void
+GLWaveform::setShowPhase(bool show)
+{
+  m_showPhase = show;
+  m_view.setShowPhase(show);
+  update();
+}
+
+void
+GLWaveform::setShowPhaseDiff(bool show)
+{
+  m_showPhaseDiff = show;
+  m_view.setShowPhaseDiff(show);
+  invalidateWindow();
+  update();
+}
+
+void
+GLWaveform::setPhaseDiffOrigin(unsigned origin)
+{
+  m_phaseDiffOrigin = origin & 0xff;
+  m_view.setPhaseDiffOrigin(origin);
+  update();
+}
+
+void
+GLWaveform::setPhaseDiffContrast(qreal contrast)
+{
+  m_phaseDiffContrast = contrast;
+  m_view.setPhaseDiffContrast(contrast);
+  update();
+}
+
+void
+GLWaveform::setAutoFitToEnvelope(bool autoFit)
+{
+  m_autoFitToEnvelope = autoFit;
+}
+
+/////////////////////////////// Events /////////////////////////////////////////
+void
+GLWaveform::mousePressEvent(QMouseEvent *event)
+{
+  if (event->button() == Qt::LeftButton) {
+    m_dragging   = true;
+    m_clickX     = event->pos().x();
+    m_savedStart = getSampleStart();
+    m_savedEnd   = getSampleEnd();
+  }
+}
+
+void
+GLWaveform::mouseMoveEvent(QMouseEvent *event)
+{
+  if (m_dragging) {
+    qreal dpr = devicePixelRatioF();
+    qint64 delta = SCAST(
+          qint64,
+          (m_clickX - event->pos().x()) * dpr * m_view.getSamplesPerPixel());
+
+    zoomHorizontal(m_savedStart + delta, m_savedEnd + delta);
+  }
+}
+
+void
+GLWaveform::mouseReleaseEvent(QMouseEvent *event)
+{
+  if (event->button() == Qt::LeftButton)
+    m_dragging = false;
+}
+
+void
+GLWaveform::wheelEvent(QWheelEvent *event)
+{
+  int delta = event->angleDelta().y();
+  qreal dpr = devicePixelRatioF();
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+  int x = SCAST(int, event->position().x());
+#else
+  int x = event->x();
+#endif // QT_VERSION
+
+  if (delta >= -WAVEFORM_DELTA_LIMIT && delta <= WAVEFORM_DELTA_LIMIT) {
+    qreal amount = std::pow(
+          static_cast<qreal>(1.1),
+          static_cast<qreal>(-delta / 120.));
+    zoomHorizontal(SCAST(qint64, x * dpr), amount);
+  }
+}
+
+/////////////////////////////// Slots //////////////////////////////////////////
+void
+GLWaveform::onWaveViewChanges()
+{
+  invalidateWindow();
+
+  if (!m_askedToKeepView) {
+    if (m_autoFitToEnvelope)
+      fitToEnvelope();
+    else
+      zoomVerticalReset();
+
+    zoomHorizontalReset();
+  }
+
+  update();
+}
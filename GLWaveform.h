@@ -0,0 +1,266 @@
+//
+//    GLWaveform.h: OpenGL time view widget
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef GLWAVEFORM_H
+#define GLWAVEFORM_H
+
+#include <QOpenGLWidget>
+#include <QOpenGLFunctions>
+#include <QOpenGLBuffer>
+#include <QOpenGLVertexArrayObject>
+#include <QOpenGLTexture>
+#include <QOpenGLShader>
+#include <QOpenGLShaderProgram>
+#include <QMouseEvent>
+#include <QWheelEvent>
+
+#include "Waveform.h"
+
+// Texture rows used to store one window of a WaveViewTree level
+#define GL_WAVEFORM_TEX_ROW_LEN     4096
+
+// Maximum number of blocks inspected by the shader per pixel column
+#define GL_WAVEFORM_MAX_COL_BLOCKS  64
+
+// Samples per pixel below which raw samples are drawn as lines
+#define GL_WAVEFORM_CLOSE_SPP       8.
+
+// How many visible spans are kept around the view in the GPU
+#define GL_WAVEFORM_WINDOW_SPANS    3
+
+//
+// The GPU keeps a window of data around the current view. For far zoom
+// levels, this window is a range of blocks from one level of the
+// WaveViewTree (min, max, envelope and phase packed in one RGBA texel). For
+// close zoom levels, it is a range of raw samples uploaded as vertices.
+// Panning and zooming inside the window only change shader uniforms. The
+// window is only uploaded again when the view leaves it, the level
+// changes or the data itself changes.
+//
+struct GLWaveformWindow {
+  int    level = -1;   // -1: raw samples
+  qint64 first = 0;    // First block (or sample) in the window
+  qint64 count = 0;    // Number of blocks (or samples)
+  bool   valid = false;
+
+  inline bool
+  contains(int lvl, qint64 from, qint64 to) const
+  {
+    return valid && lvl == level && from >= first && to <= first + count;
+  }
+};
+
+struct GLWaveformOpenGLContext {
+  QOpenGLFunctions     *m_functions = nullptr;
+  QOpenGLVertexArrayObject m_vao;
+  QOpenGLBuffer         m_quad;
+  QOpenGLBuffer         m_samples;
+  QOpenGLBuffer         m_envelope;
+  QOpenGLShaderProgram  m_farProgram;
+  QOpenGLShaderProgram  m_closeProgram;
+  QOpenGLTexture       *m_blocks   = nullptr;
+  QOpenGLTexture       *m_yiq      = nullptr;
+  QOpenGLTexture       *m_palette  = nullptr;
+  bool                  m_updatePalette = false;
+  std::vector<uint8_t>  m_paletBuf;
+
+  // Host-side staging buffers, reused across uploads
+  std::vector<float>    m_blockBuf;
+  std::vector<float>    m_sampleBuf;
+  std::vector<float>    m_envelopeBuf;
+
+  GLWaveformWindow      m_window;
+
+  GLWaveformOpenGLContext();
+  ~GLWaveformOpenGLContext();
+
+  void initialize();
+  void finalize();
+  void setPalette(const QColor *table);
+  void flushPalette();
+};
+
+class GLWaveform : public QOpenGLWidget
+{
+  Q_OBJECT
+
+  Q_PROPERTY(
+      QColor backgroundColor
+      READ getBackgroundColor
+      WRITE setBackgroundColor
+      NOTIFY backgroundColorChanged)
+
+  Q_PROPERTY(
+      QColor foregroundColor
+      READ getForegroundColor
+      WRITE setForegroundColor
+      NOTIFY foregroundColorChanged)
+
+  // Properties
+  QColor m_background = WAVEFORM_DEFAULT_BACKGROUND_COLOR;
+  QColor m_foreground = WAVEFORM_DEFAULT_FOREGROUND_COLOR;
+
+  bool     m_showWaveform  = true;
+  bool     m_showEnvelope  = false;
+  bool     m_showPhase     = false;
+  bool     m_showPhaseDiff = false;
+  qreal    m_phaseDiffContrast = 1;
+  unsigned m_phaseDiffOrigin = 0;
+  bool     m_autoFitToEnvelope = true;
+
+  // State
+  WaveView   m_view;
+  WaveBuffer m_data;
+  bool       m_askedToKeepView = false;
+  bool       m_haveGeometry = false;
+
+  bool       m_dragging = false;
+  int        m_clickX = 0;
+  qint64     m_savedStart = 0;
+  qint64     m_savedEnd = 0;
+
+  GLWaveformOpenGLContext m_glCtx;
+
+  int  selectLevel() const;
+  bool uploadBlocks(int level, qint64 from, qint64 to);
+  void uploadSamples(qint64 from, qint64 to);
+  void renderFar(int level);
+  void renderClose();
+  void setCommonUniforms(QOpenGLShaderProgram &, int);
+  void drawStatus(QString const &);
+
+  inline void
+  invalidateWindow()
+  {
+    m_glCtx.m_window.valid = false;
+  }
+
+protected:
+  void mouseMoveEvent(QMouseEvent *event) override;
+  void mousePressEvent(QMouseEvent *event) override;
+  void mouseReleaseEvent(QMouseEvent *event) override;
+  void wheelEvent(QWheelEvent *event) override;
+
+public:
+  GLWaveform(QWidget *parent = nullptr);
+  ~GLWaveform() override;
+
+  void initializeGL() override;
+  void paintGL() override;
+
+  inline qint64
+  getSampleStart() const
+  {
+    return m_view.getSampleStart();
+  }
+
+  inline qint64
+  getSampleEnd() const
+  {
+    return m_view.getSampleEnd();
+  }
+
+  inline qreal
+  getMin() const
+  {
+    return m_view.getMin();
+  }
+
+  inline qreal
+  getMax() const
+  {
+    return m_view.getMax();
+  }
+
+  inline size_t
+  getDataLength() const
+  {
+    return m_data.length();
+  }
+
+  inline qreal
+  getSampleRate() const
+  {
+    return m_view.getSampleRate();
+  }
+
+  inline bool
+  isComplete() const
+  {
+    return m_view.isComplete();
+  }
+
+  const QColor &
+  getBackgroundColor() const
+  {
+    return m_background;
+  }
+
+  const QColor &
+  getForegroundColor() const
+  {
+    return m_foreground;
+  }
+
+  void setBackgroundColor(const QColor &);
+  void setForegroundColor(const QColor &);
+  void setPalette(const QColor *);
+
+  void setData(
+      const std::vector<SUCOMPLEX> *,
+      bool keepView = false,
+      bool flush = false);
+
+  void setData(
+      const SUCOMPLEX *,
+      size_t size,
+      bool keepView = false,
+      bool flush = false,
+      bool appending = false);
+
+  void setSampleRate(qreal);
+  void setRealComponent(bool);
+  void setShowWaveform(bool);
+  void setShowEnvelope(bool);
+  void setShowPhase(bool);
+  void setShowPhaseDiff(bool);
+  void setPhaseDiffOrigin(unsigned);
+  void setPhaseDiffContrast(qreal);
+  void setAutoFitToEnvelope(bool);
+
+  void zoomHorizontalReset();
+  void zoomHorizontal(qint64, qint64);
+  void zoomHorizontal(qint64 x, qreal amount);
+  void zoomVerticalReset();
+  void zoomVertical(qreal, qreal);
+  void fitToEnvelope();
+
+  void safeCancel();
+
+signals:
+  void backgroundColorChanged();
+  void foregroundColorChanged();
+  void horizontalRangeChanged(qint64 min, qint64 max);
+  void verticalRangeChanged(qreal min, qreal max);
+
+public slots:
+  void onWaveViewChanges();
+  void onContextBeingDestroyed();
+};
+
+#endif // GLWAVEFORM_H
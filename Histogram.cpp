@@ -19,6 +19,7 @@
 
 #include "Histogram.h"
 #include "SuWidgetsHelpers.h"
+#include "SuWidgetsRecorder.h"
 
 #include <QPainter>
 #include <QPainterPath>
@@ -447,6 +448,12 @@ Histogram::setDrawThreshold(bool draw)
 void
 Histogram::feed(const SUFLOAT *data, unsigned int length)
 {
+  if (SuWidgetsRecorder::isRecording())
+    this->recordFeed(
+          SUWIDGETS_TRACE_HISTOGRAM_FEED_REAL,
+          data,
+          length * sizeof(SUFLOAT));
+
   if (this->decider != nullptr && length > 0) {
     int bin;
     bool invalidate = false;
@@ -475,6 +482,12 @@ Histogram::feed(const SUFLOAT *data, unsigned int length)
 void
 Histogram::feed(const SUCOMPLEX *samples, unsigned int length)
 {
+  if (SuWidgetsRecorder::isRecording())
+    this->recordFeed(
+          SUWIDGETS_TRACE_HISTOGRAM_FEED_COMPLEX,
+          samples,
+          length * sizeof(SUCOMPLEX));
+
   if (this->decider != nullptr && length > 0) {
     int bin;
     bool invalidate = false;
@@ -521,6 +534,64 @@ Histogram::feed(const SUCOMPLEX *samples, unsigned int length)
   }
 }
 
+//
+// Samples are binned with the decider settings at the time of the call,
+// so these are recorded along with them. Without a decider samples are
+// ignored, and so they are not recorded.
+//
+void
+Histogram::recordFeed(
+    SuWidgetsTraceEvent type,
+    const void *data,
+    quint64 size)
+{
+  qint64 args[4];
+
+  if (this->decider == nullptr)
+    return;
+
+  args[0] = this->decider->getDecisionMode();
+  args[1] = this->decider->getBps();
+  args[2] = SuWidgetsRecorder::floatArg(this->decider->getMinimum());
+  args[3] = SuWidgetsRecorder::floatArg(this->decider->getMaximum());
+
+  SuWidgetsRecorder::record(this, type, data, size, args, 4);
+}
+
+//
+// Adds the counts of a fused decision pass (see Decider::decide). Stats
+// must have been gathered with as many bins as this histogram has, and
+// cleared before each pass so that counts are not added twice.
+//
+void
+Histogram::feed(DecisionStats const &stats)
+{
+  unsigned long hlen = this->history.size();
+  bool invalidate = false;
+
+  if (stats.histogram.size() != hlen)
+    return;
+
+  if (SuWidgetsRecorder::isRecording())
+    SuWidgetsRecorder::record(
+          this,
+          SUWIDGETS_TRACE_HISTOGRAM_FEED_COUNTS,
+          stats.histogram.data(),
+          hlen * sizeof(unsigned int));
+
+  for (auto i = 0ul; i < hlen; ++i) {
+    if (stats.histogram[i] > 0) {
+      this->history[i] += stats.histogram[i];
+      if (this->history[i] > this->max)
+        this->max = this->history[i];
+      invalidate = true;
+    }
+  }
+
+  if (invalidate)
+    this->invalidate();
+}
+
 void
 Histogram::setSNRModel(std::vector<float> const &model)
 {
@@ -27,6 +27,7 @@
 #include <tgmath.h>
 #include "ThrottleableWidget.h"
 #include "Decider.h"
+#include "SuWidgetsRecorder.h"
 
 #define HISTOGRAM_DEFAULT_BACKGROUND_COLOR QColor(0,     0,   0)
 #define HISTOGRAM_DEFAULT_FOREGROUND_COLOR QColor(255, 255, 0)
@@ -129,6 +130,7 @@ class Histogram : public ThrottleableWidget
 
   void drawAxes(void);
   void drawHistogram(void);
+  void recordFeed(SuWidgetsTraceEvent, const void *, quint64);
 
   qreal getDataRange(void) const;
   qreal getDisplayRange(void) const;
@@ -265,6 +267,7 @@ public:
 
   void feed(const SUFLOAT *data, unsigned int length);
   void feed(const SUCOMPLEX *samples, unsigned int length);
+  void feed(DecisionStats const &stats);
   void setSNRModel(std::vector<float> const &model);
   void setDecider(Decider *decider);
   void resetDecider(void);
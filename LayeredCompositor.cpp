@@ -0,0 +1,69 @@
+//
+//    LayeredCompositor.cpp: Cached axes and data layers of plot widgets
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include "LayeredCompositor.h"
+#include "SuWidgetsMemory.h"
+
+bool
+LayeredCompositor::resize(QSize const &size)
+{
+  if (size == m_size)
+    return false;
+
+  m_size = size;
+  m_axes = QPixmap(size);
+
+  // Premultiplied ARGB is what the raster engine blends fastest
+  m_data = QImage(size, QImage::Format_ARGB32_Premultiplied);
+  m_data.fill(Qt::transparent);
+
+  m_axesValid = false;
+
+  return true;
+}
+
+QPixmap &
+LayeredCompositor::beginAxes(void)
+{
+  m_axesValid = true;
+
+  return m_axes;
+}
+
+QImage &
+LayeredCompositor::beginData(void)
+{
+  m_data.fill(Qt::transparent);
+
+  return m_data;
+}
+
+void
+LayeredCompositor::compose(QPainter &painter, int x, int y) const
+{
+  painter.drawPixmap(x, y, m_axes);
+  painter.drawImage(x, y, m_data);
+}
+
+quint64
+LayeredCompositor::memoryUsage(void) const
+{
+  return SuWidgetsMemory::pixmapBytes(m_axes)
+      + SuWidgetsMemory::imageBytes(m_data);
+}
@@ -0,0 +1,76 @@
+//
+//    LayeredCompositor.h: Cached axes and data layers of plot widgets
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef LAYEREDCOMPOSITOR_H
+#define LAYEREDCOMPOSITOR_H
+
+#include <QImage>
+#include <QPainter>
+#include <QPixmap>
+#include <QSize>
+
+//
+// Two layers of the same size, composed by paint(): an opaque axes layer
+// that is only redrawn when the axes change, and a transparent data layer
+// redrawn every frame on top of it.
+//
+// This replaces copying the axes into the content pixmap before every
+// plot. The data layer is allocated once per size and cleared in place,
+// so drawing a frame neither allocates nor touches the axes.
+//
+class LayeredCompositor {
+  QSize   m_size;
+  QPixmap m_axes;
+  QImage  m_data;
+  bool    m_axesValid = false;
+
+public:
+  // Reallocates both layers if the size changed, and returns whether it
+  // did. The axes must be drawn again afterwards.
+  bool resize(QSize const &);
+
+  inline void
+  invalidateAxes(void)
+  {
+    m_axesValid = false;
+  }
+
+  inline bool
+  axesValid(void) const
+  {
+    return m_axesValid;
+  }
+
+  inline QSize const &
+  size(void) const
+  {
+    return m_size;
+  }
+
+  // The axes layer to draw on. Axes are valid from now on.
+  QPixmap &beginAxes(void);
+
+  // The data layer to draw on, cleared to transparent
+  QImage &beginData(void);
+
+  void compose(QPainter &, int x = 0, int y = 0) const;
+
+  quint64 memoryUsage(void) const;
+};
+
+#endif // LAYEREDCOMPOSITOR_H
@@ -85,7 +85,7 @@ PhaseView::recalculateDisplayData()
 void
 PhaseView::drawAxes()
 {
-  QPainter painter(&m_axesPixmap);
+  QPainter painter(&m_layers.beginAxes());
   QPen pen(m_axes);
   QPointF center;
   qreal deltaMag, deltaAng;
@@ -197,14 +197,12 @@ PhaseView::drawAxes()
           QPoint(m_width >> 1, m_height - 1));
 
   }
-
-  m_axesDrawn = true;
 }
 
 void
 PhaseView::drawPhaseView()
 {
-  QPainter painter(&m_contentPixmap);
+  QPainter painter(&m_layers.beginData());
   QPointF center;
   SUCOMPLEX c;
   float alphaK;
@@ -253,7 +251,7 @@ PhaseView::drawPhaseView()
 void
 PhaseView::drawAoAView()
 {
-  QPainter painter(&m_contentPixmap);
+  QPainter painter(&m_layers.beginData());
   QPointF center;
   SUCOMPLEX c;
   float alphaK;
@@ -318,24 +316,16 @@ PhaseView::draw()
   if (m_geometry != size()) {
     m_geometry = size();
     m_haveGeometry = true;
-    m_contentPixmap  = QPixmap(m_geometry.width(), m_geometry.height());
-    m_axesPixmap = QPixmap(m_geometry.width(), m_geometry.height());
-    m_axesDrawn = false;
+    m_layers.resize(m_geometry);
   }
 
-  if (!m_axesDrawn) {
+  if (!m_layers.axesValid()) {
     recalculateDisplayData();
     drawAxes();
     emit axesUpdated();
   }
 
-  /* Dump to content pixmap */
-  m_contentPixmap = m_axesPixmap.copy(
-        0,
-        0,
-        m_geometry.width(),
-        m_geometry.height());
-
+  /* Axes are composed with the phases in paint() */
   if (m_aoa)
     drawAoAView();
   else
@@ -347,7 +337,7 @@ void
 PhaseView::paint()
 {
   QPainter painter(this);
-  painter.drawPixmap(0, 0, m_contentPixmap);
+  m_layers.compose(painter);
 }
 
 void
@@ -356,6 +346,40 @@ PhaseView::setPhaseScale(SUFLOAT scale)
   m_phaseScale = scale;
 }
 
+void
+PhaseView::memoryUsage(SuWidgetsMemoryUsage &usage) const
+{
+  usage[SUWIDGETS_MEMORY_HISTORIES] +=
+        m_history.capacity() * sizeof(SUCOMPLEX);
+  usage[SUWIDGETS_MEMORY_IMAGES] += m_layers.memoryUsage();
+}
+
+// The history is halved as many times as needed, and restarted
+quint64
+PhaseView::reclaimMemory(SuWidgetsMemoryCategory category, quint64 bytes)
+{
+  size_t size   = m_history.size();
+  size_t target = size;
+  quint64 before =
+        m_history.capacity() * sizeof(SUCOMPLEX);
+
+  if (category != SUWIDGETS_MEMORY_HISTORIES)
+    return 0;
+
+  while (target / 2 >= SUWIDGETS_MEMORY_MIN_HISTORY
+         && (size - target) * sizeof(SUCOMPLEX) < bytes)
+    target /= 2;
+
+  if (target < size)
+    setHistorySize(static_cast<unsigned int>(target));
+  m_history.shrink_to_fit();
+
+  invalidate();
+
+  return before - (
+        m_history.capacity() * sizeof(SUCOMPLEX));
+}
+
 void
 PhaseView::setHistorySize(unsigned int length)
 {
@@ -407,9 +431,6 @@ PhaseView::feed(const SUCOMPLEX *samples, unsigned int length)
 PhaseView::PhaseView(QWidget *parent) :
   ThrottleableWidget(parent)
 {
-  m_contentPixmap = QPixmap(0, 0);
-  m_axesPixmap = QPixmap(0, 0);
-
   m_history.resize(PhaseView_DEFAULT_HISTORY_SIZE);
 
   m_background = PhaseView_DEFAULT_BACKGROUND_COLOR;
@@ -27,6 +27,8 @@
 #include <tgmath.h>
 #include <sigutils/types.h>
 #include "ThrottleableWidget.h"
+#include "SuWidgetsMemory.h"
+#include "LayeredCompositor.h"
 
 #define PhaseView_DEFAULT_BACKGROUND_COLOR QColor(0,     0,   0)
 #define PhaseView_DEFAULT_FOREGROUND_COLOR QColor(255, 255, 255)
@@ -35,7 +37,7 @@
 
 #define PhaseView_DEFAULT_HISTORY_SIZE 256
 
-class PhaseView : public ThrottleableWidget
+class PhaseView : public ThrottleableWidget, public SuWidgetsMemoryClient
 {
   Q_OBJECT
 
@@ -66,8 +68,7 @@ class PhaseView : public ThrottleableWidget
 
 
   // Drawing area properties
-  QPixmap m_contentPixmap;
-  QPixmap m_axesPixmap;
+  LayeredCompositor m_layers;
 
   QSize m_geometry;
 
@@ -85,7 +86,6 @@ class PhaseView : public ThrottleableWidget
 
   float m_zoom = 1.;
   bool m_haveGeometry = false;
-  bool m_axesDrawn = false;
   bool m_aoa = false;
   SUFLOAT m_gain = 1.;
   SUFLOAT m_phaseScale = M_PI;
@@ -109,7 +109,7 @@ public:
   setBackgroundColor(const QColor &c)
   {
     m_background = c;
-    m_axesDrawn = false;
+    m_layers.invalidateAxes();
     invalidate();
     emit backgroundColorChanged();
   }
@@ -124,7 +124,7 @@ public:
   setAxesColor(const QColor &c)
   {
     m_axes = c;
-    m_axesDrawn = false;
+    m_layers.invalidateAxes();
     invalidate();
     emit axesColorChanged();
   }
@@ -139,7 +139,7 @@ public:
   setForegroundColor(const QColor &c)
   {
     m_foreground = c;
-    m_axesDrawn = false;
+    m_layers.invalidateAxes();
     invalidate();
     emit foregroundColorChanged();
   }
@@ -154,7 +154,7 @@ public:
   setTextColor(const QColor &c)
   {
     m_textColor = c;
-    m_axesDrawn = false;
+    m_layers.invalidateAxes();
     invalidate();
     emit textColorChanged();
   }
@@ -182,7 +182,7 @@ public:
   {
     if (m_aoa != aoa) {
       m_aoa = aoa;
-      m_axesDrawn = false;
+      m_layers.invalidateAxes();
       invalidate();
     }
   }
@@ -202,6 +202,9 @@ public:
 
   PhaseView(QWidget *parent = nullptr);
 
+  void memoryUsage(SuWidgetsMemoryUsage &) const override;
+  quint64 reclaimMemory(SuWidgetsMemoryCategory, quint64) override;
+
 signals:
   void orderHintChanged();
   void backgroundColorChanged();
@@ -83,7 +83,7 @@ PolarizationView::recalculateDisplayData()
 void
 PolarizationView::drawAxes()
 {
-  QPainter painter(&m_axesPixmap);
+  QPainter painter(&m_layers.beginAxes());
   QPen pen(m_axes);
   QPointF center;
   qreal deltaMag, deltaAng;
@@ -144,8 +144,6 @@ PolarizationView::drawAxes()
   painter.drawLine(
         QPoint(m_width >> 1, 0),
         QPoint(m_width >> 1, m_height - 1));
-
-  m_axesDrawn = true;
 }
 
 //
@@ -155,7 +153,7 @@ PolarizationView::drawAxes()
 void
 PolarizationView::drawEllipsoid()
 {
-  QPainter painter(&m_contentPixmap);
+  QPainter painter(&m_layers.beginData());
   QPointF center;
   SUCOMPLEX Jx, Jy;
   qreal alphaK;
@@ -229,24 +227,16 @@ PolarizationView::draw()
   if (m_geometry != size()) {
     m_geometry = size();
     m_haveGeometry = true;
-    m_contentPixmap  = QPixmap(m_geometry.width(), m_geometry.height());
-    m_axesPixmap = QPixmap(m_geometry.width(), m_geometry.height());
-    m_axesDrawn = false;
+    m_layers.resize(m_geometry);
   }
 
-  if (!m_axesDrawn) {
+  if (!m_layers.axesValid()) {
     recalculateDisplayData();
     drawAxes();
     emit axesUpdated();
   }
 
-  /* Dump to content pixmap */
-  m_contentPixmap = m_axesPixmap.copy(
-        0,
-        0,
-        m_geometry.width(),
-        m_geometry.height());
-
+  /* Axes are composed with the ellipse in paint() */
   drawEllipsoid();
 }
 
@@ -255,7 +245,7 @@ void
 PolarizationView::paint()
 {
   QPainter painter(this);
-  painter.drawPixmap(0, 0, m_contentPixmap);
+  m_layers.compose(painter);
 }
 
 void
@@ -278,6 +268,44 @@ PolarizationView::heightForWidth(int w) const
   return w;
 }
 
+void
+PolarizationView::memoryUsage(SuWidgetsMemoryUsage &usage) const
+{
+  usage[SUWIDGETS_MEMORY_HISTORIES] +=
+        m_vHistory.capacity() * sizeof(SUCOMPLEX)
+      + m_hHistory.capacity() * sizeof(SUCOMPLEX);
+  usage[SUWIDGETS_MEMORY_IMAGES] += m_layers.memoryUsage();
+}
+
+// The history is halved as many times as needed, and restarted
+quint64
+PolarizationView::reclaimMemory(SuWidgetsMemoryCategory category, quint64 bytes)
+{
+  size_t size   = m_vHistory.size();
+  size_t target = size;
+  quint64 before =
+        m_vHistory.capacity() * sizeof(SUCOMPLEX)
+      + m_hHistory.capacity() * sizeof(SUCOMPLEX);
+
+  if (category != SUWIDGETS_MEMORY_HISTORIES)
+    return 0;
+
+  while (target / 2 >= SUWIDGETS_MEMORY_MIN_HISTORY
+         && (size - target) * 2 * sizeof(SUCOMPLEX) < bytes)
+    target /= 2;
+
+  if (target < size)
+    setHistorySize(static_cast<unsigned int>(target));
+  m_vHistory.shrink_to_fit();
+  m_hHistory.shrink_to_fit();
+
+  invalidate();
+
+  return before - (
+        m_vHistory.capacity() * sizeof(SUCOMPLEX)
+      + m_hHistory.capacity() * sizeof(SUCOMPLEX));
+}
+
 void
 PolarizationView::setHistorySize(unsigned int length)
 {
@@ -331,9 +359,6 @@ PolarizationView::feed(
 PolarizationView::PolarizationView(QWidget *parent) :
   ThrottleableWidget(parent)
 {
-  m_contentPixmap = QPixmap(0, 0);
-  m_axesPixmap = QPixmap(0, 0);
-
   m_hHistory.resize(PolarizationView_DEFAULT_HISTORY_SIZE);
   m_vHistory.resize(PolarizationView_DEFAULT_HISTORY_SIZE);
 
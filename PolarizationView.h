@@ -27,6 +27,8 @@
 #include <tgmath.h>
 #include <sigutils/types.h>
 #include "ThrottleableWidget.h"
+#include "SuWidgetsMemory.h"
+#include "LayeredCompositor.h"
 
 #define PolarizationView_DEFAULT_BACKGROUND_COLOR QColor(0,     0,   0)
 #define PolarizationView_DEFAULT_FOREGROUND_COLOR QColor(255, 255, 255)
@@ -35,7 +37,7 @@
 
 #define PolarizationView_DEFAULT_HISTORY_SIZE 256
 
-class PolarizationView : public ThrottleableWidget
+class PolarizationView : public ThrottleableWidget, public SuWidgetsMemoryClient
 {
   Q_OBJECT
 
@@ -66,8 +68,7 @@ class PolarizationView : public ThrottleableWidget
 
 
   // Drawing area properties
-  QPixmap m_contentPixmap;
-  QPixmap m_axesPixmap;
+  LayeredCompositor m_layers;
 
   QSize m_geometry;
 
@@ -95,7 +96,6 @@ class PolarizationView : public ThrottleableWidget
   int m_height;
 
   bool m_haveGeometry = false;
-  bool m_axesDrawn    = false;
 
 
   // Private methods
@@ -111,7 +111,7 @@ public:
   setBackgroundColor(const QColor &c)
   {
     m_background = c;
-    m_axesDrawn = false;
+    m_layers.invalidateAxes();
     invalidate();
     emit backgroundColorChanged();
   }
@@ -126,7 +126,7 @@ public:
   setAxesColor(const QColor &c)
   {
     m_axes = c;
-    m_axesDrawn = false;
+    m_layers.invalidateAxes();
     invalidate();
     emit axesColorChanged();
   }
@@ -141,7 +141,7 @@ public:
   setForegroundColor(const QColor &c)
   {
     m_foreground = c;
-    m_axesDrawn = false;
+    m_layers.invalidateAxes();
     invalidate();
     emit foregroundColorChanged();
   }
@@ -156,7 +156,7 @@ public:
   setTextColor(const QColor &c)
   {
     m_textColor = c;
-    m_axesDrawn = false;
+    m_layers.invalidateAxes();
     invalidate();
     emit textColorChanged();
   }
@@ -194,6 +194,9 @@ public:
 
   PolarizationView(QWidget *parent = nullptr);
 
+  void memoryUsage(SuWidgetsMemoryUsage &) const override;
+  quint64 reclaimMemory(SuWidgetsMemoryCategory, quint64) override;
+
 signals:
   void orderHintChanged();
   void backgroundColorChanged();
@@ -35,6 +35,7 @@
 #include "ContextAwareSpinBoxPlugin.h"
 #include "PhaseViewPlugin.h"
 #include "PolarizationViewPlugin.h"
+#include "EyeDiagramPlugin.h"
 #include "SuWidgets.h"
 
 SuWidgets::SuWidgets(QObject *parent)
@@ -59,6 +60,7 @@ SuWidgets::SuWidgets(QObject *parent)
   m_widgets.append(new MultiToolBoxPlugin(this));
   m_widgets.append(new PhaseViewPlugin(this));
   m_widgets.append(new PolarizationViewPlugin(this));
+  m_widgets.append(new EyeDiagramPlugin(this));
 }
 
 QList<QDesignerCustomWidgetInterface*> SuWidgets::customWidgets() const
@@ -13,6 +13,7 @@ include(histogram.pri)
 include(constellation.pri)
 include(phaseview.pri)
 include(polarizationview.pri)
+include(eyediagram.pri)
 include(qverticallabel.pri)
 include(symview.pri)
 include(transition.pri)
@@ -26,18 +27,38 @@ include(tvdisplay.pri)
 include(timespinbox.pri)
 include(multitoolbox.pri)
 include(glwaterfall.pri)
+include(glwaveform.pri)
 include(abstractwaterfall.pri)
 
 HEADERS += ThrottleableWidget.h \
+    LayeredCompositor.h \
     Version.h \
     SuWidgetsHelpers.h \
+    SuWidgetsKernels.h \
+    SuWidgetsMemory.h \
+    SuWidgetsRecorder.h \
+    SuWidgetsReplayer.h \
     WFHelpers.h
 
 SOURCES += ThrottleableWidget.cpp \
+    LayeredCompositor.cpp \
     SuWidgetsHelpers.cpp \
+    SuWidgetsKernels.cpp \
+    SuWidgetsMemory.cpp \
+    SuWidgetsRecorder.cpp \
+    SuWidgetsReplayer.cpp \
     WFHelpers.cpp
 
-WIDGET_HEADERS += ThrottleableWidget.h SuWidgetsHelpers.h Version.h WFHelpers.h
+WIDGET_HEADERS += ThrottleableWidget.h SuWidgetsHelpers.h Version.h WFHelpers.h \
+  SuWidgetsKernels.h SuWidgetsMemory.h SuWidgetsRecorder.h SuWidgetsReplayer.h \
+  LayeredCompositor.h
 
 CONFIG += link_pkgconfig
-PKGCONFIG += sigutils fftw3 sndfile volk
+PKGCONFIG += sigutils fftw3 sndfile
+
+# Build only the portable kernels with CONFIG+=suwidgets_no_volk
+suwidgets_no_volk {
+  DEFINES += SUWIDGETS_KERNELS_NO_VOLK
+} else {
+  PKGCONFIG += volk
+}
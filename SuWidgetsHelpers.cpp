@@ -18,11 +18,13 @@
 //
 
 #include "SuWidgetsHelpers.h"
+#include "SuWidgetsKernels.h"
 
 #include <QWidget>
 #include <QFont>
 #include <iostream>
 #include <QLayout>
+#include <QMutex>
 
 #ifndef SUWIDGETS_PKGVERSION
 #  define SUWIDGETS_PKGVERSION \
@@ -397,6 +399,14 @@ SuWidgetsHelpers::findParentLayout(const QWidget *w)
   return nullptr;
 }
 
+QMutex *
+SuWidgetsHelpers::fftwPlannerMutex(void)
+{
+  static QMutex mutex;
+
+  return &mutex;
+}
+
 QLayout *
 SuWidgetsHelpers::findParentLayout(
     const QWidget *w,
@@ -474,17 +484,13 @@ SuWidgetsHelpers::calcLimits(
   SUFLOAT maxImag =
       inPlace ? SU_C_IMAG(*oMax) : maxReal;
 
-  for (SUSCOUNT i = 0; i < length; ++i) {
-    if (SU_C_REAL(data[i]) < minReal)
-      minReal = SU_C_REAL(data[i]);
-    if (SU_C_IMAG(data[i]) < minImag)
-      minImag = SU_C_IMAG(data[i]);
-
-    if (SU_C_REAL(data[i]) > maxReal)
-      maxReal = SU_C_REAL(data[i]);
-    if (SU_C_IMAG(data[i]) > maxImag)
-      maxImag = SU_C_IMAG(data[i]);
-  }
+  SuWidgetsKernels::limits(
+        &minReal,
+        &maxReal,
+        &minImag,
+        &maxImag,
+        data,
+        length);
 
   *oMin = minReal + SU_I * minImag;
   *oMax = maxReal + SU_I * maxImag;
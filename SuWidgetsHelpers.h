@@ -32,8 +32,13 @@
 
 class QWidget;
 class QLayout;
+class QMutex;
 
 #define SUWIDGETS_DEFAULT_PRECISION 3
+
+// Input idle time before redrawing at full quality
+#define SUWIDGETS_DEFAULT_INTERACTION_IDLE_MS 150
+
 #define SCAST(type, value) static_cast<type>(value)
 #define RCAST(type, value) reinterpret_cast<type>(value)
 
@@ -91,6 +96,9 @@ class SuWidgetsHelpers {
     static QLayout *findParentLayout(const QWidget *);
     static QLayout *findParentLayout(const QWidget *, const QLayout *);
 
+    // The FFTW planner is not thread safe. Hold this while planning.
+    static QMutex *fftwPlannerMutex(void);
+
     static void kahanMeanAndRms(
         SUCOMPLEX *mean,
         SUFLOAT *rms,
@@ -0,0 +1,672 @@
+//
+//    SuWidgetsKernels.cpp: Vectorized numeric kernels
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include "SuWidgetsKernels.h"
+#include "SuWidgetsHelpers.h"
+
+#include <QElapsedTimer>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <random>
+#include <vector>
+
+#ifndef SUWIDGETS_KERNELS_NO_VOLK
+#  include <volk/volk.h>
+#endif // SUWIDGETS_KERNELS_NO_VOLK
+
+// VOLK takes unsigned int lengths, and the smooth kernel needs scratch
+#define SUWIDGETS_KERNELS_VOLK_CHUNK    (1u << 30)
+#define SUWIDGETS_KERNELS_SCRATCH_SIZE  1024
+
+static SuWidgetsKernels::Backend
+initialBackend(void)
+{
+  const char *env = getenv("SUWIDGETS_KERNELS");
+
+  if (env != nullptr && strcmp(env, "portable") == 0)
+    return SuWidgetsKernels::PORTABLE;
+
+  return SuWidgetsKernels::haveVolk()
+      ? SuWidgetsKernels::VOLK
+      : SuWidgetsKernels::PORTABLE;
+}
+
+static std::atomic<int> g_backend(initialBackend());
+
+////////////////////////////// Backend selection ///////////////////////////////
+bool
+SuWidgetsKernels::haveVolk(void)
+{
+#ifdef SUWIDGETS_KERNELS_NO_VOLK
+  return false;
+#else
+  return true;
+#endif // SUWIDGETS_KERNELS_NO_VOLK
+}
+
+SuWidgetsKernels::Backend
+SuWidgetsKernels::backend(void)
+{
+  return SCAST(Backend, g_backend.load());
+}
+
+void
+SuWidgetsKernels::setBackend(Backend backend)
+{
+  if (backend == VOLK && !haveVolk())
+    backend = PORTABLE;
+
+  g_backend.store(backend);
+}
+
+QString
+SuWidgetsKernels::backendName(Backend backend)
+{
+  switch (backend) {
+    case PORTABLE:
+      return "portable";
+
+    case VOLK:
+      return "volk";
+  }
+
+  return "unknown";
+}
+
+#ifndef SUWIDGETS_KERNELS_NO_VOLK
+// Complex kernels also require single precision samples
+static inline bool
+useVolk(SuWidgetsKernels::Backend backend, bool complex = false)
+{
+  if (complex && sizeof(SUCOMPLEX) != sizeof(lv_32fc_t))
+    return false;
+
+  return backend == SuWidgetsKernels::VOLK;
+}
+
+static inline const lv_32fc_t *
+asVolk(const SUCOMPLEX *data)
+{
+  return RCAST(const lv_32fc_t *, data);
+}
+
+template <typename F>
+static inline void
+volkChunks(SUSCOUNT len, F kernel)
+{
+  SUSCOUNT chunk;
+
+  for (SUSCOUNT p = 0; p < len; p += chunk) {
+    chunk = qMin(len - p, SCAST(SUSCOUNT, SUWIDGETS_KERNELS_VOLK_CHUNK));
+    kernel(p, SCAST(unsigned int, chunk));
+  }
+}
+#endif // SUWIDGETS_KERNELS_NO_VOLK
+
+/////////////////////////////////// Kernels ////////////////////////////////////
+static void
+magnitudeWith(
+    SuWidgetsKernels::Backend backend,
+    float *out,
+    const SUCOMPLEX *in,
+    SUSCOUNT len)
+{
+  Q_UNUSED(backend);
+
+#ifndef SUWIDGETS_KERNELS_NO_VOLK
+  if (useVolk(backend, true)) {
+    volkChunks(len, [&] (SUSCOUNT p, unsigned int n) {
+      volk_32fc_magnitude_32f(out + p, asVolk(in + p), n);
+    });
+    return;
+  }
+#endif // SUWIDGETS_KERNELS_NO_VOLK
+
+  for (SUSCOUNT i = 0; i < len; ++i) {
+    float re = SCAST(float, SU_C_REAL(in[i]));
+    float im = SCAST(float, SU_C_IMAG(in[i]));
+    out[i] = std::sqrt(re * re + im * im);
+  }
+}
+
+static void
+argWith(
+    SuWidgetsKernels::Backend backend,
+    float *out,
+    const SUCOMPLEX *in,
+    SUSCOUNT len)
+{
+  Q_UNUSED(backend);
+
+#ifndef SUWIDGETS_KERNELS_NO_VOLK
+  if (useVolk(backend, true)) {
+    volkChunks(len, [&] (SUSCOUNT p, unsigned int n) {
+      volk_32fc_s32f_atan2_32f(out + p, asVolk(in + p), 1.f, n);
+    });
+    return;
+  }
+#endif // SUWIDGETS_KERNELS_NO_VOLK
+
+  for (SUSCOUNT i = 0; i < len; ++i)
+    out[i] = SCAST(float, SU_C_ARG(in[i]));
+}
+
+static void
+limitsWith(
+    SuWidgetsKernels::Backend backend,
+    SUFLOAT *pMinReal,
+    SUFLOAT *pMaxReal,
+    SUFLOAT *pMinImag,
+    SUFLOAT *pMaxImag,
+    const SUCOMPLEX *in,
+    SUSCOUNT len)
+{
+  Q_UNUSED(backend);
+
+  SUFLOAT minReal = *pMinReal;
+  SUFLOAT maxReal = *pMaxReal;
+  SUFLOAT minImag = *pMinImag;
+  SUFLOAT maxImag = *pMaxImag;
+
+#ifndef SUWIDGETS_KERNELS_NO_VOLK
+  if (useVolk(backend, true)) {
+    float re[SUWIDGETS_KERNELS_SCRATCH_SIZE];
+    float im[SUWIDGETS_KERNELS_SCRATCH_SIZE];
+    uint32_t index;
+    SUSCOUNT chunk;
+
+    for (SUSCOUNT p = 0; p < len; p += chunk) {
+      unsigned int n;
+
+      chunk = qMin(len - p, SCAST(SUSCOUNT, SUWIDGETS_KERNELS_SCRATCH_SIZE));
+      n     = SCAST(unsigned int, chunk);
+
+      volk_32fc_deinterleave_32f_x2(re, im, asVolk(in + p), n);
+
+      volk_32f_index_min_32u(&index, re, n);
+      if (re[index] < minReal)
+        minReal = re[index];
+      volk_32f_index_max_32u(&index, re, n);
+      if (re[index] > maxReal)
+        maxReal = re[index];
+
+      volk_32f_index_min_32u(&index, im, n);
+      if (im[index] < minImag)
+        minImag = im[index];
+      volk_32f_index_max_32u(&index, im, n);
+      if (im[index] > maxImag)
+        maxImag = im[index];
+    }
+
+    len = 0; // Skip the portable loop
+  }
+#endif // SUWIDGETS_KERNELS_NO_VOLK
+
+  for (SUSCOUNT i = 0; i < len; ++i) {
+    SUFLOAT re = SU_C_REAL(in[i]);
+    SUFLOAT im = SU_C_IMAG(in[i]);
+
+    minReal = re < minReal ? re : minReal;
+    maxReal = re > maxReal ? re : maxReal;
+    minImag = im < minImag ? im : minImag;
+    maxImag = im > maxImag ? im : maxImag;
+  }
+
+  *pMinReal = minReal;
+  *pMaxReal = maxReal;
+  *pMinImag = minImag;
+  *pMaxImag = maxImag;
+}
+
+static float
+sumWith(
+    SuWidgetsKernels::Backend backend,
+    const float *in,
+    SUSCOUNT len)
+{
+  Q_UNUSED(backend);
+
+  float result = 0;
+
+#ifndef SUWIDGETS_KERNELS_NO_VOLK
+  if (useVolk(backend)) {
+    volkChunks(len, [&] (SUSCOUNT p, unsigned int n) {
+      float partial;
+      volk_32f_accumulator_s32f(&partial, in + p, n);
+      result += partial;
+    });
+    return result;
+  }
+#endif // SUWIDGETS_KERNELS_NO_VOLK
+
+  for (SUSCOUNT i = 0; i < len; ++i)
+    result += in[i];
+
+  return result;
+}
+
+static float
+maximumWith(
+    SuWidgetsKernels::Backend backend,
+    const float *in,
+    SUSCOUNT len)
+{
+  Q_UNUSED(backend);
+
+  float result = -std::numeric_limits<float>::infinity();
+
+#ifndef SUWIDGETS_KERNELS_NO_VOLK
+  if (useVolk(backend)) {
+    volkChunks(len, [&] (SUSCOUNT p, unsigned int n) {
+      uint32_t index;
+      volk_32f_index_max_32u(&index, in + p, n);
+      if (in[p + index] > result)
+        result = in[p + index];
+    });
+    return result;
+  }
+#endif // SUWIDGETS_KERNELS_NO_VOLK
+
+  for (SUSCOUNT i = 0; i < len; ++i)
+    result = in[i] > result ? in[i] : result;
+
+  return result;
+}
+
+static void
+accumulateWith(
+    SuWidgetsKernels::Backend backend,
+    float *acc,
+    const float *in,
+    SUSCOUNT len)
+{
+  Q_UNUSED(backend);
+
+#ifndef SUWIDGETS_KERNELS_NO_VOLK
+  if (useVolk(backend)) {
+    volkChunks(len, [&] (SUSCOUNT p, unsigned int n) {
+      volk_32f_x2_add_32f(acc + p, acc + p, in + p, n);
+    });
+    return;
+  }
+#endif // SUWIDGETS_KERNELS_NO_VOLK
+
+  for (SUSCOUNT i = 0; i < len; ++i)
+    acc[i] += in[i];
+}
+
+static void
+smoothWith(
+    SuWidgetsKernels::Backend backend,
+    float *acc,
+    const float *in,
+    float alpha,
+    SUSCOUNT len)
+{
+  Q_UNUSED(backend);
+
+#ifndef SUWIDGETS_KERNELS_NO_VOLK
+  if (useVolk(backend)) {
+    float diff[SUWIDGETS_KERNELS_SCRATCH_SIZE];
+    SUSCOUNT chunk;
+
+    for (SUSCOUNT p = 0; p < len; p += chunk) {
+      unsigned int n;
+
+      chunk = qMin(len - p, SCAST(SUSCOUNT, SUWIDGETS_KERNELS_SCRATCH_SIZE));
+      n     = SCAST(unsigned int, chunk);
+
+      volk_32f_x2_subtract_32f(diff, in + p, acc + p, n);
+      volk_32f_s32f_multiply_32f(diff, diff, alpha, n);
+      volk_32f_x2_add_32f(acc + p, acc + p, diff, n);
+    }
+    return;
+  }
+#endif // SUWIDGETS_KERNELS_NO_VOLK
+
+  for (SUSCOUNT i = 0; i < len; ++i)
+    acc[i] += alpha * (in[i] - acc[i]);
+}
+
+static void
+scaleWith(
+    SuWidgetsKernels::Backend backend,
+    float *acc,
+    float k,
+    SUSCOUNT len)
+{
+  Q_UNUSED(backend);
+
+#ifndef SUWIDGETS_KERNELS_NO_VOLK
+  if (useVolk(backend)) {
+    volkChunks(len, [&] (SUSCOUNT p, unsigned int n) {
+      volk_32f_s32f_multiply_32f(acc + p, acc + p, k, n);
+    });
+    return;
+  }
+#endif // SUWIDGETS_KERNELS_NO_VOLK
+
+  for (SUSCOUNT i = 0; i < len; ++i)
+    acc[i] *= k;
+}
+
+static void
+toInt16With(
+    SuWidgetsKernels::Backend backend,
+    int16_t *out,
+    const float *in,
+    float k,
+    SUSCOUNT len)
+{
+  Q_UNUSED(backend);
+
+#ifndef SUWIDGETS_KERNELS_NO_VOLK
+  if (useVolk(backend)) {
+    volkChunks(len, [&] (SUSCOUNT p, unsigned int n) {
+      volk_32f_s32f_convert_16i(out + p, in + p, k, n);
+    });
+    return;
+  }
+#endif // SUWIDGETS_KERNELS_NO_VOLK
+
+  for (SUSCOUNT i = 0; i < len; ++i) {
+    float v = in[i] * k;
+
+    v = v > -32768.f ? v : -32768.f;
+    v = v <  32767.f ? v :  32767.f;
+    out[i] = SCAST(int16_t, std::lrint(v));
+  }
+}
+
+// Kernels with a VOLK flavour run on the backend selected for the process
+void
+SuWidgetsKernels::magnitude(float *out, const SUCOMPLEX *in, SUSCOUNT len)
+{
+  magnitudeWith(backend(), out, in, len);
+}
+
+void
+SuWidgetsKernels::arg(float *out, const SUCOMPLEX *in, SUSCOUNT len)
+{
+  argWith(backend(), out, in, len);
+}
+
+void
+SuWidgetsKernels::limits(
+    SUFLOAT *pMinReal,
+    SUFLOAT *pMaxReal,
+    SUFLOAT *pMinImag,
+    SUFLOAT *pMaxImag,
+    const SUCOMPLEX *in,
+    SUSCOUNT len)
+{
+  limitsWith(backend(), pMinReal, pMaxReal, pMinImag, pMaxImag, in, len);
+}
+
+float
+SuWidgetsKernels::sum(const float *in, SUSCOUNT len)
+{
+  return sumWith(backend(), in, len);
+}
+
+float
+SuWidgetsKernels::maximum(const float *in, SUSCOUNT len)
+{
+  return maximumWith(backend(), in, len);
+}
+
+void
+SuWidgetsKernels::accumulate(float *acc, const float *in, SUSCOUNT len)
+{
+  accumulateWith(backend(), acc, in, len);
+}
+
+void
+SuWidgetsKernels::smooth(float *acc, const float *in, float alpha, SUSCOUNT len)
+{
+  smoothWith(backend(), acc, in, alpha, len);
+}
+
+void
+SuWidgetsKernels::scale(float *acc, float k, SUSCOUNT len)
+{
+  scaleWith(backend(), acc, k, len);
+}
+
+void
+SuWidgetsKernels::toInt16(int16_t *out, const float *in, float k, SUSCOUNT len)
+{
+  toInt16With(backend(), out, in, k, len);
+}
+
+//
+// ln(x) from the exponent and a series on the mantissa. The mantissa is
+// reduced to [1/sqrt(2), sqrt(2)), where t = (m - 1) / (m + 1) stays below
+// 0.172 and the first omitted term (2 t^7 / 7) is under 1.3e-6 nepers,
+// i.e. 6e-6 dB. Written without branches so that it vectorizes.
+//
+static inline float
+fastDb(float x)
+{
+  const float lnToDb = 4.342944819f; // 10 / ln(10)
+  uint32_t bits;
+  float m, e, t, t2, ln;
+
+  x = x > 1e-30f ? x : 1e-30f;
+
+  memcpy(&bits, &x, sizeof(float));
+  e    = SCAST(float, SCAST(int32_t, bits >> 23) - 127);
+  bits = (bits & 0x007fffffu) | 0x3f800000u;
+  memcpy(&m, &bits, sizeof(float));
+
+  e += m > 1.414213562f ? 1.f : 0.f;
+  m  = m > 1.414213562f ? .5f * m : m;
+
+  t  = (m - 1.f) / (m + 1.f);
+  t2 = t * t;
+  ln = 2.f * t * (1.f + t2 * (1.f / 3.f + t2 * (1.f / 5.f)));
+
+  return lnToDb * (ln + e * 0.693147181f);
+}
+
+void
+SuWidgetsKernels::powerToDb(
+    float *out,
+    const float *in,
+    float offset,
+    SUSCOUNT len,
+    float *acc)
+{
+  if (acc != nullptr) {
+    for (SUSCOUNT i = 0; i < len; ++i) {
+      acc[i] += in[i];
+      out[i]  = fastDb(in[i]) + offset;
+    }
+  } else {
+    for (SUSCOUNT i = 0; i < len; ++i)
+      out[i] = fastDb(in[i]) + offset;
+  }
+}
+
+void
+SuWidgetsKernels::complexToDb(
+    float *out,
+    const SUCOMPLEX *in,
+    float offset,
+    SUSCOUNT len,
+    float *acc)
+{
+  if (acc != nullptr) {
+    for (SUSCOUNT i = 0; i < len; ++i) {
+      float re = SCAST(float, SU_C_REAL(in[i]));
+      float im = SCAST(float, SU_C_IMAG(in[i]));
+      float p  = re * re + im * im;
+
+      acc[i] += p;
+      out[i]  = fastDb(p) + offset;
+    }
+  } else {
+    for (SUSCOUNT i = 0; i < len; ++i) {
+      float re = SCAST(float, SU_C_REAL(in[i]));
+      float im = SCAST(float, SU_C_IMAG(in[i]));
+
+      out[i] = fastDb(re * re + im * im) + offset;
+    }
+  }
+}
+
+void
+SuWidgetsKernels::histogram(
+    uint32_t *counts,
+    unsigned int bins,
+    const float *in,
+    float min,
+    float binsPerUnit,
+    SUSCOUNT len)
+{
+  int32_t index[SUWIDGETS_KERNELS_SCRATCH_SIZE];
+  float   last = SCAST(float, bins - 1);
+  SUSCOUNT chunk;
+
+  if (bins == 0)
+    return;
+
+  // Bin indices are computed in a vectorizable pass, counts are scattered
+  // in a second one
+  for (SUSCOUNT p = 0; p < len; p += chunk) {
+    chunk = qMin(len - p, SCAST(SUSCOUNT, SUWIDGETS_KERNELS_SCRATCH_SIZE));
+
+    for (SUSCOUNT i = 0; i < chunk; ++i) {
+      float k = (in[p + i] - min) * binsPerUnit;
+
+      k = k > 0.f  ? k : 0.f;
+      k = k < last ? k : last;
+      index[i] = SCAST(int32_t, k);
+    }
+
+    for (SUSCOUNT i = 0; i < chunk; ++i)
+      ++counts[index[i]];
+  }
+}
+
+////////////////////////////////// Benchmark ///////////////////////////////////
+//
+// Each backend is called directly, so the one selected for the process
+// (which other threads keep using meanwhile) is left untouched.
+//
+QList<SuWidgetsKernels::BenchmarkResult>
+SuWidgetsKernels::benchmark(SUSCOUNT len, unsigned int iterations)
+{
+  QList<BenchmarkResult> results;
+  QList<Backend> backends;
+  std::vector<SUCOMPLEX> cIn(len);
+  std::vector<float> fIn(len), fOut(len);
+  std::vector<int16_t> sOut(len);
+  std::vector<uint32_t> counts(256);
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+  QElapsedTimer timer;
+
+  if (len == 0 || iterations == 0)
+    return results;
+
+  for (SUSCOUNT i = 0; i < len; ++i) {
+    cIn[i] = dist(rng) + SU_I * dist(rng);
+    fIn[i] = dist(rng);
+  }
+
+  backends.append(PORTABLE);
+  if (haveVolk())
+    backends.append(VOLK);
+
+  auto run = [&] (QString const &name, Backend b, std::function<void ()> k) {
+    BenchmarkResult result;
+
+    k(); // Warm up caches and VOLK dispatch
+
+    timer.start();
+    for (unsigned int i = 0; i < iterations; ++i)
+      k();
+
+    result.kernel      = name;
+    result.backend     = b;
+    result.nsPerSample =
+        SCAST(qreal, timer.nsecsElapsed()) / (SCAST(qreal, len) * iterations);
+    results.append(result);
+  };
+
+  for (auto b : backends) {
+    SUFLOAT minRe, maxRe, minIm, maxIm;
+
+    run("magnitude", b, [&] () {
+      magnitudeWith(b, fOut.data(), cIn.data(), len);
+    });
+    run("arg", b, [&] () { argWith(b, fOut.data(), cIn.data(), len); });
+    run("limits", b, [&] () {
+      minRe = maxRe = SU_C_REAL(cIn[0]);
+      minIm = maxIm = SU_C_IMAG(cIn[0]);
+      limitsWith(b, &minRe, &maxRe, &minIm, &maxIm, cIn.data(), len);
+    });
+    run("sum", b, [&] () { fOut[0] = sumWith(b, fIn.data(), len); });
+    run("maximum", b, [&] () { fOut[0] = maximumWith(b, fIn.data(), len); });
+    run("accumulate", b, [&] () {
+      accumulateWith(b, fOut.data(), fIn.data(), len);
+    });
+    run("smooth", b, [&] () {
+      smoothWith(b, fOut.data(), fIn.data(), .25f, len);
+    });
+    run("scale", b, [&] () { scaleWith(b, fOut.data(), .999f, len); });
+    run("toInt16", b, [&] () {
+      toInt16With(b, sOut.data(), fIn.data(), 32767.f, len);
+    });
+    run("powerToDb", b, [&] () {
+      powerToDb(fOut.data(), fIn.data(), 0, len);
+    });
+    run("complexToDb", b, [&] () {
+      complexToDb(fOut.data(), cIn.data(), 0, len);
+    });
+    run("histogram", b, [&] () {
+      histogram(counts.data(), 256, fIn.data(), -1.f, 128.f, len);
+    });
+  }
+
+  return results;
+}
+
+QString
+SuWidgetsKernels::benchmarkReport(SUSCOUNT len, unsigned int iterations)
+{
+  QString report;
+
+  report += QString("Kernel benchmark (%1 samples, %2 iterations)\n")
+      .arg(len)
+      .arg(iterations);
+
+  for (auto const &r : benchmark(len, iterations))
+    report += QString("  %1 %2 %3 ns/sample\n")
+        .arg(r.kernel, -12)
+        .arg(backendName(r.backend), -10)
+        .arg(r.nsPerSample, 0, 'f', 3);
+
+  return report;
+}
@@ -0,0 +1,136 @@
+//
+//    SuWidgetsKernels.h: Vectorized numeric kernels
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SUWIDGETSKERNELS_H
+#define SUWIDGETSKERNELS_H
+
+#include <QList>
+#include <QString>
+#include <sigutils/types.h>
+#include <cstdint>
+
+#ifdef I
+#  undef I
+#endif // I
+
+//
+// Numeric hot loops of the library. Every kernel has a portable
+// implementation (plain loops written so that the compiler can vectorize
+// them) and, unless built with CONFIG+=suwidgets_no_volk, a VOLK one that
+// picks the best SIMD flavour for the running CPU.
+//
+// The backend defaults to VOLK when available. It can be changed at run
+// time with setBackend(), or through the SUWIDGETS_KERNELS environment
+// variable ("portable" or "volk").
+//
+class SuWidgetsKernels {
+public:
+  enum Backend {
+    PORTABLE,
+    VOLK
+  };
+
+  struct BenchmarkResult {
+    QString kernel;
+    Backend backend;
+    qreal   nsPerSample;
+  };
+
+  static bool    haveVolk(void);
+  static Backend backend(void);
+  static void    setBackend(Backend);
+  static QString backendName(Backend);
+
+  // out[i] = |in[i]|
+  static void magnitude(float *out, const SUCOMPLEX *in, SUSCOUNT len);
+
+  // out[i] = arg(in[i])
+  static void arg(float *out, const SUCOMPLEX *in, SUSCOUNT len);
+
+  // Extends the real and imaginary ranges with in[]
+  static void limits(
+      SUFLOAT *minReal,
+      SUFLOAT *maxReal,
+      SUFLOAT *minImag,
+      SUFLOAT *maxImag,
+      const SUCOMPLEX *in,
+      SUSCOUNT len);
+
+  // Sum of in[]
+  static float sum(const float *in, SUSCOUNT len);
+
+  // Largest value of in[], -inf if empty
+  static float maximum(const float *in, SUSCOUNT len);
+
+  // acc[i] += in[i]
+  static void accumulate(float *acc, const float *in, SUSCOUNT len);
+
+  // acc[i] += alpha * (in[i] - acc[i])
+  static void smooth(float *acc, const float *in, float alpha, SUSCOUNT len);
+
+  // acc[i] *= k
+  static void scale(float *acc, float k, SUSCOUNT len);
+
+  // out[i] = in[i] * k, rounded and saturated to 16 bits
+  static void toInt16(int16_t *out, const float *in, float k, SUSCOUNT len);
+
+  //
+  // out[i] = 10 * log10(in[i]) + offset, through a fast logarithm whose
+  // error is below 1e-4 dB. Powers below 1e-30 are clamped to -300 dB.
+  // If acc is given, in[] is also added to it in the same pass (averaging
+  // is done in linear power). Both backends share the same code.
+  //
+  static void powerToDb(
+      float *out,
+      const float *in,
+      float offset,
+      SUSCOUNT len,
+      float *acc = nullptr);
+
+  // Same as powerToDb(), taking |in[i]|^2 as the power
+  static void complexToDb(
+      float *out,
+      const SUCOMPLEX *in,
+      float offset,
+      SUSCOUNT len,
+      float *acc = nullptr);
+
+  //
+  // Adds in[] to a histogram of `bins` bins, where bin k counts the values
+  // in [min + k / binsPerUnit, min + (k + 1) / binsPerUnit). Values out
+  // of range (and NaNs) are counted in the first or the last bin.
+  //
+  static void histogram(
+      uint32_t *counts,
+      unsigned int bins,
+      const float *in,
+      float min,
+      float binsPerUnit,
+      SUSCOUNT len);
+
+  // Times every kernel in every available backend on this machine,
+  // without changing the selected one
+  static QList<BenchmarkResult> benchmark(
+      SUSCOUNT len = 1 << 16,
+      unsigned int iterations = 100);
+  static QString benchmarkReport(
+      SUSCOUNT len = 1 << 16,
+      unsigned int iterations = 100);
+};
+
+#endif // SUWIDGETSKERNELS_H
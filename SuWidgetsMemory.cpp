@@ -0,0 +1,290 @@
+//
+//    SuWidgetsMemory.cpp: Memory accounting and budgets
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include "SuWidgetsMemory.h"
+#include "SuWidgetsHelpers.h"
+#include <algorithm>
+
+// When over the total budget, lossless reclaims go first
+static const SuWidgetsMemoryCategory g_reclaimOrder[] = {
+  SUWIDGETS_MEMORY_WAVE_TREES,
+  SUWIDGETS_MEMORY_HISTORIES,
+  SUWIDGETS_MEMORY_ACCUMULATORS,
+  SUWIDGETS_MEMORY_TEXTURES
+};
+
+////////////////////////////// SuWidgetsMemoryClient ///////////////////////////
+SuWidgetsMemoryClient::SuWidgetsMemoryClient()
+{
+  SuWidgetsMemory::instance()->registerClient(this);
+}
+
+SuWidgetsMemoryClient::~SuWidgetsMemoryClient()
+{
+  SuWidgetsMemory::instance()->unregisterClient(this);
+}
+
+quint64
+SuWidgetsMemoryClient::reclaimMemory(SuWidgetsMemoryCategory, quint64)
+{
+  return 0;
+}
+
+////////////////////////////// SuWidgetsMemoryReport ///////////////////////////
+quint64
+SuWidgetsMemoryReport::total(void) const
+{
+  quint64 total = 0;
+
+  for (int i = 0; i < SUWIDGETS_MEMORY_CATEGORY_COUNT; ++i)
+    total += bytes[i];
+
+  return total;
+}
+
+////////////////////////////////// SuWidgetsMemory /////////////////////////////
+SuWidgetsMemory::SuWidgetsMemory()
+{
+  m_enforceTimer.setInterval(SUWIDGETS_MEMORY_DEFAULT_ENFORCE_INTERVAL_MS);
+
+  connect(
+        &m_enforceTimer,
+        SIGNAL(timeout()),
+        this,
+        SLOT(enforce()));
+}
+
+SuWidgetsMemory *
+SuWidgetsMemory::instance(void)
+{
+  // Never destroyed: clients may outlive static destructors
+  static SuWidgetsMemory *instance = new SuWidgetsMemory();
+
+  return instance;
+}
+
+QString
+SuWidgetsMemory::categoryName(SuWidgetsMemoryCategory category)
+{
+  switch (category) {
+    case SUWIDGETS_MEMORY_WAVE_TREES:
+      return "Wave trees";
+
+    case SUWIDGETS_MEMORY_SAMPLES:
+      return "Sample buffers";
+
+    case SUWIDGETS_MEMORY_HISTORIES:
+      return "Histories";
+
+    case SUWIDGETS_MEMORY_ACCUMULATORS:
+      return "Accumulators";
+
+    case SUWIDGETS_MEMORY_TEXTURES:
+      return "Textures";
+
+    case SUWIDGETS_MEMORY_IMAGES:
+      return "Images";
+
+    default:
+      break;
+  }
+
+  return "Unknown";
+}
+
+void
+SuWidgetsMemory::registerClient(SuWidgetsMemoryClient *client)
+{
+  m_clients.append(client);
+}
+
+void
+SuWidgetsMemory::unregisterClient(SuWidgetsMemoryClient *client)
+{
+  m_clients.removeAll(client);
+}
+
+QList<SuWidgetsMemoryReport>
+SuWidgetsMemory::report(void) const
+{
+  QList<SuWidgetsMemoryReport> list;
+
+  for (auto client : m_clients) {
+    SuWidgetsMemoryReport report;
+    auto obj = dynamic_cast<const QObject *>(client);
+
+    report.client = client;
+    if (obj != nullptr) {
+      report.name = obj->metaObject()->className();
+      if (!obj->objectName().isEmpty())
+        report.name += " (" + obj->objectName() + ")";
+    }
+
+    client->memoryUsage(report.bytes);
+    list.append(report);
+  }
+
+  return list;
+}
+
+quint64
+SuWidgetsMemory::usage(SuWidgetsMemoryCategory category) const
+{
+  quint64 total = 0;
+
+  for (auto client : m_clients) {
+    SuWidgetsMemoryUsage usage = {0};
+
+    client->memoryUsage(usage);
+    total += usage[category];
+  }
+
+  return total;
+}
+
+quint64
+SuWidgetsMemory::usage(void) const
+{
+  quint64 total = 0;
+
+  for (auto const &report : report())
+    total += report.total();
+
+  return total;
+}
+
+void
+SuWidgetsMemory::setBudget(SuWidgetsMemoryCategory category, quint64 bytes)
+{
+  bool haveBudgets = false;
+
+  m_budgets[category] = bytes;
+
+  for (int i = 0; i < SUWIDGETS_MEMORY_CATEGORY_COUNT; ++i)
+    if (m_budgets[i] > 0)
+      haveBudgets = true;
+
+  if (haveBudgets || m_totalBudget > 0)
+    m_enforceTimer.start();
+  else
+    m_enforceTimer.stop();
+}
+
+quint64
+SuWidgetsMemory::budget(SuWidgetsMemoryCategory category) const
+{
+  return m_budgets[category];
+}
+
+void
+SuWidgetsMemory::setTotalBudget(quint64 bytes)
+{
+  m_totalBudget = bytes;
+
+  // Re-evaluates whether the timer must run
+  setBudget(SUWIDGETS_MEMORY_WAVE_TREES, m_budgets[SUWIDGETS_MEMORY_WAVE_TREES]);
+}
+
+quint64
+SuWidgetsMemory::totalBudget(void) const
+{
+  return m_totalBudget;
+}
+
+void
+SuWidgetsMemory::setEnforceInterval(int ms)
+{
+  m_enforceTimer.setInterval(ms);
+}
+
+quint64
+SuWidgetsMemory::reclaim(SuWidgetsMemoryCategory category, quint64 bytes)
+{
+  QList<QPair<quint64, SuWidgetsMemoryClient *>> candidates;
+  quint64 freed = 0;
+
+  for (auto client : m_clients) {
+    SuWidgetsMemoryUsage usage = {0};
+
+    client->memoryUsage(usage);
+    if (usage[category] > 0)
+      candidates.append(qMakePair(usage[category], client));
+  }
+
+  // Largest consumers first
+  std::sort(
+        candidates.begin(),
+        candidates.end(),
+        [] (
+          QPair<quint64, SuWidgetsMemoryClient *> const &a,
+          QPair<quint64, SuWidgetsMemoryClient *> const &b) {
+    return a.first > b.first;
+  });
+
+  for (auto const &c : candidates) {
+    if (freed >= bytes)
+      break;
+
+    freed += c.second->reclaimMemory(category, bytes - freed);
+  }
+
+  if (freed > 0)
+    emit memoryReclaimed(category, freed);
+
+  return freed;
+}
+
+void
+SuWidgetsMemory::enforce(void)
+{
+  quint64 total;
+
+  for (int i = 0; i < SUWIDGETS_MEMORY_CATEGORY_COUNT; ++i) {
+    auto category = SCAST(SuWidgetsMemoryCategory, i);
+    quint64 used;
+
+    if (m_budgets[i] == 0)
+      continue;
+
+    used = usage(category);
+    if (used > m_budgets[i]) {
+      emit budgetExceeded(i, used, m_budgets[i]);
+      reclaim(category, used - m_budgets[i]);
+    }
+  }
+
+  if (m_totalBudget == 0)
+    return;
+
+  total = usage();
+  if (total > m_totalBudget) {
+    quint64 excess = total - m_totalBudget;
+
+    emit budgetExceeded(-1, total, m_totalBudget);
+
+    for (auto category : g_reclaimOrder) {
+      quint64 freed = reclaim(category, excess);
+
+      if (freed >= excess)
+        break;
+
+      excess -= freed;
+    }
+  }
+}
@@ -0,0 +1,127 @@
+//
+//    SuWidgetsMemory.h: Memory accounting and budgets
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SUWIDGETSMEMORY_H
+#define SUWIDGETSMEMORY_H
+
+#include <QObject>
+#include <QImage>
+#include <QList>
+#include <QPixmap>
+#include <QString>
+#include <QTimer>
+#include "SuWidgetsHelpers.h"
+
+#define SUWIDGETS_MEMORY_DEFAULT_ENFORCE_INTERVAL_MS 1000
+
+// Histories are never shrunk below this number of entries
+#define SUWIDGETS_MEMORY_MIN_HISTORY 64
+
+enum SuWidgetsMemoryCategory {
+  SUWIDGETS_MEMORY_WAVE_TREES,   // WaveViewTree levels
+  SUWIDGETS_MEMORY_SAMPLES,      // Sample buffers owned by widgets
+  SUWIDGETS_MEMORY_HISTORIES,    // Symbol, sample and line histories
+  SUWIDGETS_MEMORY_ACCUMULATORS, // Averaging buffers
+  SUWIDGETS_MEMORY_TEXTURES,     // GPU textures
+  SUWIDGETS_MEMORY_IMAGES,       // Off-screen images and pixmaps
+  SUWIDGETS_MEMORY_CATEGORY_COUNT
+};
+
+typedef quint64 SuWidgetsMemoryUsage[SUWIDGETS_MEMORY_CATEGORY_COUNT];
+
+//
+// Widgets holding significant amounts of memory implement this interface.
+// They are registered on construction and unregistered on destruction, and
+// are only queried from the GUI thread.
+//
+// reclaimMemory() is asked to release at least the given number of bytes
+// of a category, and returns how many it actually released. What is lost
+// in exchange (older history, accumulated averages, waterfall height...)
+// is documented by each widget.
+//
+class SuWidgetsMemoryClient {
+public:
+  SuWidgetsMemoryClient();
+  virtual ~SuWidgetsMemoryClient();
+
+  virtual void memoryUsage(SuWidgetsMemoryUsage &usage) const = 0;
+  virtual quint64 reclaimMemory(SuWidgetsMemoryCategory, quint64 bytes);
+};
+
+struct SuWidgetsMemoryReport {
+  const SuWidgetsMemoryClient *client = nullptr;
+  QString              name;
+  SuWidgetsMemoryUsage bytes = {0};
+
+  quint64 total(void) const;
+};
+
+class SuWidgetsMemory : public QObject {
+  Q_OBJECT
+
+  QList<SuWidgetsMemoryClient *> m_clients;
+  SuWidgetsMemoryUsage m_budgets = {0};
+  quint64 m_totalBudget = 0;
+  QTimer  m_enforceTimer;
+
+  SuWidgetsMemory();
+
+  quint64 reclaim(SuWidgetsMemoryCategory, quint64 bytes);
+
+public:
+  static SuWidgetsMemory *instance(void);
+  static QString categoryName(SuWidgetsMemoryCategory);
+
+  static inline quint64
+  imageBytes(QImage const &image)
+  {
+    return SCAST(quint64, image.bytesPerLine()) * SCAST(quint64, image.height());
+  }
+
+  static inline quint64
+  pixmapBytes(QPixmap const &pixmap)
+  {
+    return SCAST(quint64, pixmap.width())
+        * SCAST(quint64, pixmap.height())
+        * SCAST(quint64, pixmap.depth()) / 8;
+  }
+
+  void registerClient(SuWidgetsMemoryClient *);
+  void unregisterClient(SuWidgetsMemoryClient *);
+
+  QList<SuWidgetsMemoryReport> report(void) const;
+  quint64 usage(SuWidgetsMemoryCategory) const;
+  quint64 usage(void) const;
+
+  // Budgets of 0 bytes are unlimited
+  void setBudget(SuWidgetsMemoryCategory, quint64 bytes);
+  quint64 budget(SuWidgetsMemoryCategory) const;
+  void setTotalBudget(quint64 bytes);
+  quint64 totalBudget(void) const;
+
+  void setEnforceInterval(int ms);
+
+public slots:
+  void enforce(void);
+
+signals:
+  void budgetExceeded(int category, quint64 usage, quint64 budget);
+  void memoryReclaimed(int category, quint64 bytes);
+};
+
+#endif // SUWIDGETSMEMORY_H
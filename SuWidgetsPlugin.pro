@@ -15,6 +15,7 @@ HEADERS     = WFHelpers.h ConstellationPlugin.h TransitionPlugin.h HistogramPlug
     LEDPlugin.h \
     PhaseViewPlugin.h \
     PolarizationViewPlugin.h \
+    EyeDiagramPlugin.h \
     QVerticalLabelPlugin.h \
     SciSpinBoxPlugin.h \
     TVDisplayPlugin.h \
@@ -28,6 +29,7 @@ SOURCES     = ConstellationPlugin.cpp TransitionPlugin.cpp HistogramPlugin.cpp L
     LEDPlugin.cpp \
     PhaseViewPlugin.cpp \
     PolarizationViewPlugin.cpp \
+    EyeDiagramPlugin.cpp \
     QVerticalLabelPlugin.cpp \
     SciSpinBoxPlugin.cpp \
     TVDisplayPlugin.cpp \
@@ -0,0 +1,192 @@
+//
+//    SuWidgetsRecorder.cpp: Record widget ingest calls to a trace file
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include "SuWidgetsRecorder.h"
+
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWidget>
+
+std::atomic<bool> SuWidgetsRecorder::s_recording(false);
+quint32           SuWidgetsRecorder::s_session = 0;
+
+struct SuWidgetsRecorderState {
+  QMutex                          mutex;
+  QFile                           file;
+  QDataStream                     stream;
+  QElapsedTimer                   timer;
+  QHash<const QObject *, quint32> ids;
+  QHash<const QObject *, QMetaObject::Connection> destroyed;
+  quint32                         lastId = 0;
+};
+
+static SuWidgetsRecorderState *
+recorderState(void)
+{
+  static SuWidgetsRecorderState state;
+
+  return &state;
+}
+
+static void
+writeRecord(
+    SuWidgetsRecorderState *state,
+    quint32 id,
+    SuWidgetsTraceEvent type,
+    const void *payload,
+    quint64 size,
+    const qint64 *args,
+    int nargs)
+{
+  state->stream << SCAST(quint8, type);
+  state->stream << id;
+  state->stream << SCAST(quint64, state->timer.nsecsElapsed());
+  state->stream << SCAST(quint8, nargs);
+
+  for (int i = 0; i < nargs; ++i)
+    state->stream << args[i];
+
+  state->stream << size;
+
+  // Sizes are checked by record()
+  if (size > 0)
+    state->stream.writeRawData(
+          SCAST(const char *, payload),
+          SCAST(int, size));
+}
+
+bool
+SuWidgetsRecorder::start(QString const &path)
+{
+  SuWidgetsRecorderState *state = recorderState();
+  QMutexLocker locker(&state->mutex);
+
+  if (s_recording.load())
+    return false;
+
+  state->file.setFileName(path);
+  if (!state->file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    return false;
+
+  state->stream.setDevice(&state->file);
+  state->stream.setByteOrder(QDataStream::LittleEndian);
+  state->stream.writeRawData(SUWIDGETS_TRACE_MAGIC, 8);
+  state->stream << SCAST(quint32, SUWIDGETS_TRACE_VERSION);
+
+  state->ids.clear();
+  state->lastId = 0;
+  state->timer.start();
+
+  ++s_session;
+  s_recording.store(true);
+
+  return true;
+}
+
+void
+SuWidgetsRecorder::stop(void)
+{
+  SuWidgetsRecorderState *state = recorderState();
+  QMutexLocker locker(&state->mutex);
+
+  if (!s_recording.load())
+    return;
+
+  s_recording.store(false);
+
+  state->stream.setDevice(nullptr);
+  state->file.close();
+  state->ids.clear();
+
+  // Sessions would otherwise pile up handlers on the same widgets
+  for (auto &connection : state->destroyed)
+    QObject::disconnect(connection);
+  state->destroyed.clear();
+}
+
+void
+SuWidgetsRecorder::record(
+    const QObject *widget,
+    SuWidgetsTraceEvent type,
+    const void *payload,
+    quint64 size,
+    const qint64 *args,
+    int nargs)
+{
+  SuWidgetsRecorderState *state = recorderState();
+  QMutexLocker locker(&state->mutex);
+  quint32 id;
+
+  if (!s_recording.load())
+    return;
+
+  if (size > SUWIDGETS_TRACE_MAX_PAYLOAD)
+    return;
+
+  if (nargs > SUWIDGETS_TRACE_MAX_ARGS)
+    nargs = SUWIDGETS_TRACE_MAX_ARGS;
+
+  auto it = state->ids.find(widget);
+
+  if (it == state->ids.end()) {
+    auto asWidget = qobject_cast<const QWidget *>(widget);
+    QByteArray name = widget->metaObject()->className();
+    qint64 geometry[2] = {0, 0};
+
+    id = ++state->lastId;
+    state->ids.insert(widget, id);
+
+    // Addresses may be reused by later widgets
+    QMetaObject::Connection connection = QObject::connect(
+          widget,
+          &QObject::destroyed,
+          [state, widget] () {
+      QMutexLocker locker(&state->mutex);
+      state->ids.remove(widget);
+      state->destroyed.remove(widget);
+    });
+
+    state->destroyed.insert(widget, connection);
+
+    if (asWidget != nullptr) {
+      geometry[0] = asWidget->width();
+      geometry[1] = asWidget->height();
+    }
+
+    name += '\0';
+    name += widget->objectName().toUtf8();
+
+    writeRecord(
+          state,
+          id,
+          SUWIDGETS_TRACE_DECLARE,
+          name.constData(),
+          SCAST(quint64, name.size()),
+          geometry,
+          2);
+  } else {
+    id = it.value();
+  }
+
+  writeRecord(state, id, type, payload, size, args, nargs);
+}
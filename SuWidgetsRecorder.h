@@ -0,0 +1,127 @@
+//
+//    SuWidgetsRecorder.h: Record widget ingest calls to a trace file
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SUWIDGETSRECORDER_H
+#define SUWIDGETSRECORDER_H
+
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include "SuWidgetsHelpers.h"
+
+class QObject;
+
+#define SUWIDGETS_TRACE_MAGIC    "SUWTRACE"
+#define SUWIDGETS_TRACE_VERSION  1
+#define SUWIDGETS_TRACE_MAX_ARGS 8
+
+// Larger payloads are not recorded: replay reads them into a QByteArray
+#define SUWIDGETS_TRACE_MAX_PAYLOAD SCAST(quint64, INT_MAX)
+
+//
+// Trace file layout (little endian):
+//
+//   char    magic[8]   SUWIDGETS_TRACE_MAGIC
+//   quint32 version
+//
+// followed by records:
+//
+//   quint8  type       SuWidgetsTraceEvent
+//   quint32 widget     Widget id, declared by a TRACE_DECLARE record
+//   quint64 time       Nanoseconds since the recording started
+//   quint8  nargs      Up to SUWIDGETS_TRACE_MAX_ARGS
+//   qint64  args[nargs]
+//   quint64 size       Payload size in bytes
+//   quint8  payload[size]
+//
+// TRACE_DECLARE carries the class name and the object name of the widget
+// (separated by a NUL) as payload, and its width and height as arguments.
+// It is written before the first event of every widget.
+//
+enum SuWidgetsTraceEvent {
+  SUWIDGETS_TRACE_DECLARE,
+  SUWIDGETS_TRACE_WATERFALL_FFT,         // size, msecs, looped, separate wf
+  SUWIDGETS_TRACE_WATERFALL_PARTIAL_FFT, // size, start, end, msecs, looped,
+                                         // center freq, sample rate
+  SUWIDGETS_TRACE_WAVEFORM_SET_DATA,     // from, length, keepView, flush
+  SUWIDGETS_TRACE_WAVEFORM_REFRESH,      // from, length
+  SUWIDGETS_TRACE_CONSTELLATION_FEED,
+  SUWIDGETS_TRACE_HISTOGRAM_FEED_REAL,   // mode, bps, min, max (float bits)
+  SUWIDGETS_TRACE_HISTOGRAM_FEED_COMPLEX,// mode, bps, min, max (float bits)
+  SUWIDGETS_TRACE_HISTOGRAM_FEED_COUNTS,
+  SUWIDGETS_TRACE_SYMVIEW_FEED,
+  SUWIDGETS_TRACE_TV_FRAME,              // width, height
+  SUWIDGETS_TRACE_TV_LINE                // line, picture width, height
+};
+
+//
+// Opt-in recorder of ingest calls. While stopped, the cost in the widgets
+// is a relaxed atomic load per call. Recording is meant to be done from
+// the GUI thread, which is where widgets are fed.
+//
+class SuWidgetsRecorder {
+  static std::atomic<bool> s_recording;
+  static quint32           s_session;
+
+public:
+  static inline bool
+  isRecording(void)
+  {
+    return s_recording.load(std::memory_order_relaxed);
+  }
+
+  static bool start(QString const &path);
+  static void stop(void);
+
+  // Changes on every start(). Widgets that record deltas against what they
+  // recorded before use it to know when to record everything again.
+  static inline quint32
+  session(void)
+  {
+    return s_session;
+  }
+
+  static void record(
+      const QObject *widget,
+      SuWidgetsTraceEvent type,
+      const void *payload,
+      quint64 size,
+      const qint64 *args = nullptr,
+      int nargs = 0);
+
+  static inline qint64
+  floatArg(float value)
+  {
+    quint32 bits;
+    memcpy(&bits, &value, sizeof(float));
+    return SCAST(qint64, bits);
+  }
+
+  static inline float
+  argFloat(qint64 arg)
+  {
+    quint32 bits = SCAST(quint32, arg);
+    float value;
+    memcpy(&value, &bits, sizeof(float));
+    return value;
+  }
+};
+
+#endif // SUWIDGETSRECORDER_H
@@ -0,0 +1,566 @@
+//
+//    SuWidgetsReplayer.cpp: Replay recorded ingest traces offscreen
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include "SuWidgetsReplayer.h"
+#include "Waterfall.h"
+#include "Waveform.h"
+#include "Constellation.h"
+#include "Histogram.h"
+#include "SymView.h"
+#include "TVDisplay.h"
+#include "Decider.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QThread>
+#include <sigutils/tvproc.h>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#define SUWIDGETS_REPLAY_DEFAULT_WIDTH  640
+#define SUWIDGETS_REPLAY_DEFAULT_HEIGHT 480
+
+struct SuWidgetsReplayer::Target {
+  SuWidgetsReplayStats stats;
+  QWidget             *widget = nullptr;
+  quint64              lastFrame = 0;
+  bool                 framed = false;
+  std::vector<qreal>   frameMs;
+
+  // Waveform: samples as seen by the recorded widget
+  std::vector<SUCOMPLEX> samples;
+  bool                   loaned = false;
+
+  // Histogram: decider settings of the recorded calls
+  Decider *decider = nullptr;
+  int      deciderBps = -1;
+
+  // TVDisplay: last frame geometry
+  std::vector<SUFLOAT> frame;
+
+  ~Target()
+  {
+    delete widget;
+    delete decider;
+  }
+};
+
+SuWidgetsReplayer::SuWidgetsReplayer(QObject *parent) : QObject(parent)
+{
+}
+
+SuWidgetsReplayer::~SuWidgetsReplayer()
+{
+  clear();
+}
+
+void
+SuWidgetsReplayer::clear(void)
+{
+  for (auto target : m_targets)
+    delete target;
+
+  m_targets.clear();
+}
+
+bool
+SuWidgetsReplayer::open(QString const &path)
+{
+  char magic[8];
+  quint32 version;
+
+  clear();
+
+  if (m_file.isOpen())
+    m_file.close();
+
+  m_file.setFileName(path);
+  if (!m_file.open(QIODevice::ReadOnly)) {
+    m_lastError = "Cannot open " + path + ": " + m_file.errorString();
+    return false;
+  }
+
+  m_stream.setDevice(&m_file);
+  m_stream.setByteOrder(QDataStream::LittleEndian);
+
+  if (m_stream.readRawData(magic, 8) != 8
+      || memcmp(magic, SUWIDGETS_TRACE_MAGIC, 8) != 0) {
+    m_lastError = path + " is not a SuWidgets trace";
+    m_file.close();
+    return false;
+  }
+
+  m_stream >> version;
+  if (version != SUWIDGETS_TRACE_VERSION) {
+    m_lastError = QString("Unsupported trace version %1").arg(version);
+    m_file.close();
+    return false;
+  }
+
+  return true;
+}
+
+void
+SuWidgetsReplayer::setSpeed(Speed speed)
+{
+  m_speed = speed;
+}
+
+void
+SuWidgetsReplayer::setFrameInterval(quint64 ns)
+{
+  m_frameInterval = ns;
+}
+
+QString
+SuWidgetsReplayer::lastError(void) const
+{
+  return m_lastError;
+}
+
+bool
+SuWidgetsReplayer::readRecord(
+    quint8 &type,
+    quint32 &id,
+    quint64 &time,
+    std::vector<qint64> &args,
+    QByteArray &payload)
+{
+  quint8 nargs;
+  quint64 size;
+
+  m_stream >> type >> id >> time >> nargs;
+  if (m_stream.status() != QDataStream::Ok)
+    return false;
+
+  if (nargs > SUWIDGETS_TRACE_MAX_ARGS) {
+    m_lastError = "Corrupt trace: too many arguments";
+    return false;
+  }
+
+  args.resize(nargs);
+  for (auto &arg : args)
+    m_stream >> arg;
+
+  m_stream >> size;
+  if (m_stream.status() != QDataStream::Ok) {
+    m_lastError = "Truncated trace";
+    return false;
+  }
+
+  if (size > SUWIDGETS_TRACE_MAX_PAYLOAD) {
+    m_lastError = "Corrupt trace: payload too big";
+    return false;
+  }
+
+  payload.resize(SCAST(int, size));
+  if (size > 0
+      && m_stream.readRawData(payload.data(), SCAST(int, size))
+        != SCAST(int, size)) {
+    m_lastError = "Truncated trace";
+    return false;
+  }
+
+  return true;
+}
+
+bool
+SuWidgetsReplayer::declare(
+    quint32 id,
+    QByteArray const &payload,
+    std::vector<qint64> const &args)
+{
+  int sep = payload.indexOf('\0');
+  QByteArray className = sep < 0 ? payload : payload.left(sep);
+  QString name = sep < 0 ? QString() : QString::fromUtf8(payload.mid(sep + 1));
+  Target *target;
+  QWidget *widget = nullptr;
+  int width  = SUWIDGETS_REPLAY_DEFAULT_WIDTH;
+  int height = SUWIDGETS_REPLAY_DEFAULT_HEIGHT;
+
+  if (className == "Waterfall" || className == "GLWaterfall")
+    widget = new Waterfall();
+  else if (className == "Waveform")
+    widget = new Waveform();
+  else if (className == "Constellation")
+    widget = new Constellation();
+  else if (className == "Histogram")
+    widget = new Histogram();
+  else if (className == "SymView")
+    widget = new SymView();
+  else if (className == "TVDisplay")
+    widget = new TVDisplay();
+
+  if (widget == nullptr) {
+    m_lastError = "Cannot replay widgets of class " + QString(className);
+    return false;
+  }
+
+  if (args.size() >= 2 && args[0] > 0 && args[1] > 0) {
+    width  = SCAST(int, args[0]);
+    height = SCAST(int, args[1]);
+  }
+
+  widget->setObjectName(name);
+  widget->setAttribute(Qt::WA_DontShowOnScreen);
+  widget->resize(width, height);
+  widget->show();
+
+  target = new Target;
+  target->widget = widget;
+  target->stats.className = className;
+  target->stats.name = name;
+
+  delete m_targets.value(id, nullptr);
+  m_targets[id] = target;
+
+  return true;
+}
+
+void
+SuWidgetsReplayer::ingest(
+    Target *target,
+    quint8 type,
+    std::vector<qint64> const &args,
+    QByteArray const &payload)
+{
+  const float *floats = RCAST(const float *, payload.constData());
+  const SUCOMPLEX *complex = RCAST(const SUCOMPLEX *, payload.constData());
+  qint64 arg[SUWIDGETS_TRACE_MAX_ARGS] = {0};
+
+  std::copy(args.begin(), args.end(), arg);
+
+  switch (type) {
+    case SUWIDGETS_TRACE_WATERFALL_FFT: {
+      auto wf = qobject_cast<Waterfall *>(target->widget);
+      int size = SCAST(int, arg[0]);
+
+      if (wf != nullptr
+          && SCAST(size_t, payload.size())
+            >= (arg[3] ? 2u : 1u) * size * sizeof(float))
+        wf->setNewFftData(
+              floats,
+              arg[3] ? floats + size : floats,
+              size,
+              QDateTime::fromMSecsSinceEpoch(arg[1]),
+              arg[2] != 0);
+      break;
+    }
+
+    case SUWIDGETS_TRACE_WATERFALL_PARTIAL_FFT: {
+      auto wf = qobject_cast<Waterfall *>(target->widget);
+      int size = SCAST(int, arg[0]);
+
+      if (wf != nullptr
+          && SCAST(size_t, payload.size()) >= size * sizeof(float)) {
+        if (wf->getCenterFreq() != arg[5])
+          wf->setCenterFreq(arg[5]);
+        if (SCAST(qint64, wf->getSampleRate()) != arg[6])
+          wf->setSampleRate(arg[6]);
+
+        wf->setNewPartialFftData(
+              floats,
+              size,
+              arg[1],
+              arg[2],
+              QDateTime::fromMSecsSinceEpoch(arg[3]),
+              arg[4] != 0);
+      }
+      break;
+    }
+
+    case SUWIDGETS_TRACE_WAVEFORM_SET_DATA:
+    case SUWIDGETS_TRACE_WAVEFORM_REFRESH: {
+      auto wf = qobject_cast<Waveform *>(target->widget);
+      size_t from   = SCAST(size_t, arg[0]);
+      size_t length = SCAST(size_t, arg[1]);
+      size_t count  = payload.size() / sizeof(SUCOMPLEX);
+
+      if (wf == nullptr || from > length || from + count > length)
+        break;
+
+      // A recording from the start replaces the data
+      if (from == 0 && target->loaned) {
+        wf->setData(nullptr);
+        target->loaned = false;
+      }
+
+      target->samples.resize(length);
+      std::copy(complex, complex + count, target->samples.begin() + from);
+
+      if (type == SUWIDGETS_TRACE_WAVEFORM_SET_DATA || !target->loaned) {
+        wf->setData(
+              &target->samples,
+              type == SUWIDGETS_TRACE_WAVEFORM_SET_DATA && arg[2] != 0,
+              type == SUWIDGETS_TRACE_WAVEFORM_SET_DATA && arg[3] != 0);
+        target->loaned = true;
+      } else {
+        wf->refreshData();
+      }
+      break;
+    }
+
+    case SUWIDGETS_TRACE_CONSTELLATION_FEED: {
+      auto constellation = qobject_cast<Constellation *>(target->widget);
+
+      if (constellation != nullptr)
+        constellation->feed(
+              complex,
+              SCAST(unsigned int, payload.size() / sizeof(SUCOMPLEX)));
+      break;
+    }
+
+    case SUWIDGETS_TRACE_HISTOGRAM_FEED_REAL:
+    case SUWIDGETS_TRACE_HISTOGRAM_FEED_COMPLEX: {
+      auto histogram = qobject_cast<Histogram *>(target->widget);
+
+      if (histogram == nullptr)
+        break;
+
+      if (target->decider == nullptr)
+        target->decider = new Decider();
+
+      target->decider->setDecisionMode(
+            SCAST(Decider::DecisionMode, arg[0]));
+      target->decider->setMinimum(SuWidgetsRecorder::argFloat(arg[2]));
+      target->decider->setMaximum(SuWidgetsRecorder::argFloat(arg[3]));
+
+      if (target->deciderBps != arg[1]) {
+        target->deciderBps = SCAST(int, arg[1]);
+        target->decider->setBps(SCAST(unsigned int, arg[1]));
+        histogram->setDecider(target->decider);
+      }
+
+      if (type == SUWIDGETS_TRACE_HISTOGRAM_FEED_REAL)
+        histogram->feed(
+              floats,
+              SCAST(unsigned int, payload.size() / sizeof(SUFLOAT)));
+      else
+        histogram->feed(
+              complex,
+              SCAST(unsigned int, payload.size() / sizeof(SUCOMPLEX)));
+      break;
+    }
+
+    case SUWIDGETS_TRACE_HISTOGRAM_FEED_COUNTS: {
+      auto histogram = qobject_cast<Histogram *>(target->widget);
+      DecisionStats stats;
+      auto counts = RCAST(const unsigned int *, payload.constData());
+
+      if (histogram == nullptr)
+        break;
+
+      stats.histogram.assign(
+            counts,
+            counts + payload.size() / sizeof(unsigned int));
+      histogram->feed(stats);
+      break;
+    }
+
+    case SUWIDGETS_TRACE_SYMVIEW_FEED: {
+      auto symView = qobject_cast<SymView *>(target->widget);
+
+      if (symView != nullptr)
+        symView->feed(
+              RCAST(const Symbol *, payload.constData()),
+              SCAST(unsigned int, payload.size() / sizeof(Symbol)));
+      break;
+    }
+
+    case SUWIDGETS_TRACE_TV_FRAME: {
+      auto tv = qobject_cast<TVDisplay *>(target->widget);
+      struct sigutils_tv_frame_buffer buffer;
+      size_t size = SCAST(size_t, arg[0] * arg[1]);
+
+      if (tv == nullptr
+          || arg[0] <= 0
+          || arg[1] <= 0
+          || SCAST(size_t, payload.size()) < size * sizeof(SUFLOAT))
+        break;
+
+      target->frame.assign(floats, floats + size);
+
+      memset(&buffer, 0, sizeof(buffer));
+      buffer.width  = SCAST(int, arg[0]);
+      buffer.height = SCAST(int, arg[1]);
+      buffer.buffer = target->frame.data();
+
+      tv->putFrame(&buffer);
+      break;
+    }
+
+    case SUWIDGETS_TRACE_TV_LINE: {
+      auto tv = qobject_cast<TVDisplay *>(target->widget);
+
+      if (tv == nullptr || arg[1] <= 0 || arg[2] <= 0)
+        break;
+
+      if (!tv->havePicGeometry())
+        tv->setPicGeometry(SCAST(int, arg[1]), SCAST(int, arg[2]));
+
+      tv->putLine(
+            SCAST(int, arg[0]),
+            floats,
+            SCAST(int, payload.size() / sizeof(SUFLOAT)));
+      break;
+    }
+
+    default:
+      break;
+  }
+}
+
+bool
+SuWidgetsReplayer::run(void)
+{
+  quint8 type;
+  quint32 id;
+  quint64 time;
+  quint64 events = 0;
+  std::vector<qint64> args;
+  QByteArray payload;
+  QElapsedTimer clock;
+  QElapsedTimer timer;
+
+  if (!m_file.isOpen()) {
+    m_lastError = "No trace open";
+    return false;
+  }
+
+  m_lastError.clear();
+  clock.start();
+
+  while (!m_stream.atEnd()) {
+    Target *target;
+
+    if (!readRecord(type, id, time, args, payload))
+      return false;
+
+    if (type == SUWIDGETS_TRACE_DECLARE) {
+      if (!declare(id, payload, args))
+        return false;
+      continue;
+    }
+
+    target = m_targets.value(id, nullptr);
+    if (target == nullptr) {
+      m_lastError = QString("Event for undeclared widget %1").arg(id);
+      return false;
+    }
+
+    if (m_speed == REAL_TIME) {
+      qint64 ahead = SCAST(qint64, time) - clock.nsecsElapsed();
+
+      while (ahead > 0) {
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 1);
+        ahead = SCAST(qint64, time) - clock.nsecsElapsed();
+        if (ahead > 1000000)
+          QThread::usleep(SCAST(unsigned long, qMin<qint64>(ahead / 1000, 1000)));
+      }
+    }
+
+    timer.start();
+    ingest(target, type, args, payload);
+    target->stats.ingestMs += timer.nsecsElapsed() * 1e-6;
+    target->stats.bytes += SCAST(quint64, payload.size());
+    ++target->stats.events;
+
+    if (!target->framed || time - target->lastFrame >= m_frameInterval) {
+      timer.start();
+      (void) target->widget->grab();
+      target->frameMs.push_back(timer.nsecsElapsed() * 1e-6);
+      target->lastFrame = time;
+      target->framed = true;
+    }
+
+    QCoreApplication::processEvents();
+
+    if ((++events & 0xff) == 0)
+      emit progress(events);
+  }
+
+  emit progress(events);
+
+  for (auto target : m_targets) {
+    std::vector<qreal> sorted = target->frameMs;
+    qreal total = 0;
+
+    target->stats.frames = sorted.size();
+    if (sorted.empty())
+      continue;
+
+    std::sort(sorted.begin(), sorted.end());
+    for (auto ms : sorted)
+      total += ms;
+
+    target->stats.meanFrameMs = total / SCAST(qreal, sorted.size());
+    target->stats.maxFrameMs  = sorted.back();
+    target->stats.p99FrameMs  = sorted[(sorted.size() - 1) * 99 / 100];
+  }
+
+  return true;
+}
+
+QList<SuWidgetsReplayStats>
+SuWidgetsReplayer::stats(void) const
+{
+  QList<SuWidgetsReplayStats> list;
+
+  for (auto target : m_targets)
+    list.append(target->stats);
+
+  return list;
+}
+
+QString
+SuWidgetsReplayer::report(void) const
+{
+  QString text;
+
+  text += QString("%1 %2 %3 %4 %5 %6 %7 %8\n")
+      .arg("Widget", -32)
+      .arg("Events", 8)
+      .arg("MiB", 9)
+      .arg("Ingest ms", 11)
+      .arg("Frames", 8)
+      .arg("Mean ms", 9)
+      .arg("Max ms", 9)
+      .arg("p99 ms", 9);
+
+  for (auto const &stats : this->stats()) {
+    QString name = stats.className;
+
+    if (!stats.name.isEmpty())
+      name += " (" + stats.name + ")";
+
+    text += QString("%1 %2 %3 %4 %5 %6 %7 %8\n")
+        .arg(name, -32)
+        .arg(stats.events, 8)
+        .arg(stats.bytes / 1048576., 9, 'f', 2)
+        .arg(stats.ingestMs, 11, 'f', 2)
+        .arg(stats.frames, 8)
+        .arg(stats.meanFrameMs, 9, 'f', 3)
+        .arg(stats.maxFrameMs, 9, 'f', 3)
+        .arg(stats.p99FrameMs, 9, 'f', 3);
+  }
+
+  return text;
+}
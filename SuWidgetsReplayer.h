@@ -0,0 +1,105 @@
+//
+//    SuWidgetsReplayer.h: Replay recorded ingest traces offscreen
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SUWIDGETSREPLAYER_H
+#define SUWIDGETSREPLAYER_H
+
+#include <QObject>
+#include <QFile>
+#include <QDataStream>
+#include <QMap>
+#include <QString>
+#include <vector>
+
+#include "SuWidgetsRecorder.h"
+
+class QWidget;
+
+struct SuWidgetsReplayStats {
+  QString className;
+  QString name;
+  quint64 events   = 0;
+  quint64 bytes    = 0;
+  qreal   ingestMs = 0;
+  quint64 frames   = 0;
+  qreal   meanFrameMs = 0;
+  qreal   maxFrameMs  = 0;
+  qreal   p99FrameMs  = 0;
+};
+
+//
+// Drives the widgets of a trace written by SuWidgetsRecorder with the same
+// ingest calls. Widgets are created by class name, never shown on screen,
+// and rendered through QWidget::grab() so that draw() and paint() are
+// timed as a frame. Intended to run with QT_QPA_PLATFORM=offscreen (the
+// GL waterfall is replayed with the raster one, as the offscreen platform
+// may lack a GL context).
+//
+// Frames are rendered whenever at least frameInterval nanoseconds of trace
+// time have passed since the last frame of the widget (0: after every
+// event). Waveform work done in its worker threads is not part of the
+// frame time.
+//
+class SuWidgetsReplayer : public QObject {
+  Q_OBJECT
+
+public:
+  enum Speed {
+    REAL_TIME,
+    AS_FAST_AS_POSSIBLE
+  };
+
+private:
+  struct Target;
+
+  QFile       m_file;
+  QDataStream m_stream;
+  QString     m_lastError;
+  Speed       m_speed = AS_FAST_AS_POSSIBLE;
+  quint64     m_frameInterval = 0;
+  QMap<quint32, Target *> m_targets;
+
+  bool readRecord(
+      quint8 &type,
+      quint32 &id,
+      quint64 &time,
+      std::vector<qint64> &args,
+      QByteArray &payload);
+  bool declare(quint32 id, QByteArray const &, std::vector<qint64> const &);
+  void ingest(Target *, quint8, std::vector<qint64> const &, QByteArray const &);
+  void clear(void);
+
+public:
+  SuWidgetsReplayer(QObject *parent = nullptr);
+  ~SuWidgetsReplayer() override;
+
+  bool open(QString const &path);
+  void setSpeed(Speed);
+  void setFrameInterval(quint64 ns);
+
+  bool run(void);
+
+  QString lastError(void) const;
+  QList<SuWidgetsReplayStats> stats(void) const;
+  QString report(void) const;
+
+signals:
+  void progress(quint64 events);
+};
+
+#endif // SUWIDGETSREPLAYER_H
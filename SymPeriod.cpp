@@ -0,0 +1,415 @@
+//
+//    SymPeriod.cpp: Frame period detection of symbol streams
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include "SymPeriod.h"
+#include "SuWidgetsHelpers.h"
+#include <QMutexLocker>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+static unsigned int
+blockSizeFor(unsigned int maxPeriod)
+{
+  unsigned int size = SYM_PERIOD_MIN_BLOCK_SIZE;
+
+  while (size < maxPeriod)
+    size <<= 1;
+
+  return size;
+}
+
+/////////////////////////////// SymPeriodWorker ////////////////////////////////
+SymPeriodWorker::SymPeriodWorker(
+    const std::atomic<quint64> *generation,
+    QMutex *dataMutex,
+    QObject *parent) : QObject(parent)
+{
+  m_generation = generation;
+  m_dataMutex  = dataMutex;
+}
+
+SymPeriodWorker::~SymPeriodWorker()
+{
+  destroyPlans();
+}
+
+void
+SymPeriodWorker::destroyPlans()
+{
+  QMutexLocker locker(SuWidgetsHelpers::fftwPlannerMutex());
+
+  if (m_forwardX != nullptr)
+    SU_FFTW(_destroy_plan)(m_forwardX);
+  if (m_forwardY != nullptr)
+    SU_FFTW(_destroy_plan)(m_forwardY);
+  if (m_backward != nullptr)
+    SU_FFTW(_destroy_plan)(m_backward);
+  if (m_x != nullptr)
+    SU_FFTW(_free)(m_x);
+  if (m_y != nullptr)
+    SU_FFTW(_free)(m_y);
+
+  m_forwardX = m_forwardY = m_backward = nullptr;
+  m_x = m_y = nullptr;
+  m_blockSize = 0;
+}
+
+bool
+SymPeriodWorker::configure(unsigned int maxPeriod)
+{
+  unsigned int blockSize = blockSizeFor(maxPeriod);
+  int size = SCAST(int, 2 * blockSize);
+
+  m_maxPeriod = maxPeriod;
+  m_acc.assign(maxPeriod + 1, 0);
+  m_symbols   = 0;
+  m_started   = false;
+
+  if (blockSize == m_blockSize)
+    return true;
+
+  destroyPlans();
+
+  {
+    QMutexLocker locker(SuWidgetsHelpers::fftwPlannerMutex());
+
+    m_x = SU_FFTW(_alloc_complex)(SCAST(size_t, size));
+    m_y = SU_FFTW(_alloc_complex)(SCAST(size_t, size));
+
+    if (m_x != nullptr && m_y != nullptr) {
+      m_forwardX = SU_FFTW(_plan_dft_1d)(
+            size, m_x, m_x, FFTW_FORWARD, FFTW_ESTIMATE);
+      m_forwardY = SU_FFTW(_plan_dft_1d)(
+            size, m_y, m_y, FFTW_FORWARD, FFTW_ESTIMATE);
+      m_backward = SU_FFTW(_plan_dft_1d)(
+            size, m_x, m_x, FFTW_BACKWARD, FFTW_ESTIMATE);
+    }
+  }
+
+  if (m_forwardX == nullptr || m_forwardY == nullptr || m_backward == nullptr) {
+    destroyPlans();
+    return false;
+  }
+
+  m_blockSize = blockSize;
+
+  return true;
+}
+
+//
+// data holds N + maxPeriod symbols. x is the first N of them and y all of
+// them, both zero-padded to 2N, so the circular correlation of x and y
+// has no wrapped terms for lags up to maxPeriod. Every lag gets exactly N
+// products per block: adding blocks gives the linear autocorrelation.
+//
+void
+SymPeriodWorker::correlateBlock(const Symbol *data)
+{
+  unsigned int n = m_blockSize;
+  unsigned int length = n + m_maxPeriod;
+  unsigned int size = 2 * n;
+  SUFLOAT mean = 0;
+  SUFLOAT norm = 1.f / SCAST(SUFLOAT, size);
+
+  for (unsigned int i = 0; i < length; ++i)
+    mean += data[i];
+  mean /= SCAST(SUFLOAT, length);
+
+  for (unsigned int i = 0; i < size; ++i) {
+    SUFLOAT v = i < length ? SCAST(SUFLOAT, data[i]) - mean : 0;
+
+    m_x[i][0] = i < n ? v : 0;
+    m_x[i][1] = 0;
+    m_y[i][0] = v;
+    m_y[i][1] = 0;
+  }
+
+  SU_FFTW(_execute)(m_forwardX);
+  SU_FFTW(_execute)(m_forwardY);
+
+  // conj(X) * Y
+  for (unsigned int i = 0; i < size; ++i) {
+    SUFLOAT xr = m_x[i][0], xi = m_x[i][1];
+    SUFLOAT yr = m_y[i][0], yi = m_y[i][1];
+
+    m_x[i][0] = xr * yr + xi * yi;
+    m_x[i][1] = xr * yi - xi * yr;
+  }
+
+  SU_FFTW(_execute)(m_backward);
+
+  for (unsigned int lag = 0; lag <= m_maxPeriod; ++lag)
+    m_acc[lag] += SCAST(qreal, m_x[lag][0] * norm);
+}
+
+//
+// Candidates are the significant local maxima of the normalized
+// autocorrelation. A frame of P symbols also peaks at 2P, 3P... with
+// about the same score, so the best period is the shortest one scoring
+// close to the top.
+//
+void
+SymPeriodWorker::findCandidates(std::vector<SymPeriodCandidate> &out) const
+{
+  std::vector<SymPeriodCandidate> peaks;
+  qreal threshold, top = 0;
+  size_t best = 0;
+
+  out.clear();
+
+  if (m_symbols == 0 || m_acc[0] <= 0)
+    return;
+
+  threshold = SYM_PERIOD_MIN_SIGNIFICANCE / sqrt(SCAST(qreal, m_symbols));
+
+  for (unsigned int lag = 2; lag < m_maxPeriod; ++lag) {
+    qreal rho = m_acc[lag] / m_acc[0];
+
+    if (rho >= threshold
+        && rho > m_acc[lag - 1] / m_acc[0]
+        && rho >= m_acc[lag + 1] / m_acc[0]) {
+      SymPeriodCandidate c;
+      c.period = lag;
+      c.score  = rho;
+      peaks.push_back(c);
+      top = qMax(top, rho);
+    }
+  }
+
+  if (peaks.empty())
+    return;
+
+  // Peaks are sorted by period
+  while (peaks[best].score < SYM_PERIOD_EQUIVALENT_SCORE * top)
+    ++best;
+
+  out.push_back(peaks[best]);
+  peaks.erase(peaks.begin() + SCAST(long, best));
+
+  std::sort(
+        peaks.begin(),
+        peaks.end(),
+        [] (SymPeriodCandidate const &a, SymPeriodCandidate const &b) {
+          return a.score > b.score;
+        });
+
+  for (auto &c : peaks) {
+    if (out.size() >= SYM_PERIOD_MAX_CANDIDATES)
+      break;
+    out.push_back(c);
+  }
+}
+
+void
+SymPeriodWorker::run(SymPeriodRequest req)
+{
+  SymPeriodResult result;
+  std::vector<Symbol> block;
+
+  if (cancelled(req.generation))
+    return;
+
+  if (req.reset || req.maxPeriod != m_maxPeriod) {
+    if (!configure(req.maxPeriod)) {
+      // No more requests until the detector is reset
+      result.generation = req.generation;
+      result.next       = std::numeric_limits<quint64>::max();
+      emit resultReady(result);
+      return;
+    }
+  }
+
+  block.resize(m_blockSize + m_maxPeriod);
+
+  for (;;) {
+    bool ready = false;
+
+    if (cancelled(req.generation))
+      return;
+
+    // Copy the block and release the buffer as soon as possible
+    {
+      QMutexLocker locker(m_dataMutex);
+      quint64 base = *req.base;
+      quint64 end  = base + req.buffer->size();
+
+      if (!m_started) {
+        m_position = base;
+        m_started  = true;
+      }
+
+      // Symbols dropped before being correlated
+      if (m_position < base)
+        m_position = base;
+
+      if (m_position + block.size() <= end) {
+        const Symbol *data = req.buffer->data() + (m_position - base);
+        std::copy(data, data + block.size(), block.begin());
+        ready = true;
+      }
+    }
+
+    if (!ready)
+      break;
+
+    correlateBlock(block.data());
+
+    m_position += m_blockSize;
+    m_symbols  += m_blockSize;
+  }
+
+  result.generation = req.generation;
+  result.symbols    = m_symbols;
+  result.next       = m_position + block.size();
+  findCandidates(result.candidates);
+
+  emit resultReady(result);
+}
+
+////////////////////////////////// SymPeriod ///////////////////////////////////
+SymPeriod::SymPeriod(QMutex *dataMutex, QObject *parent) : QObject(parent)
+{
+  m_dataMutex = dataMutex;
+
+  qRegisterMetaType<SymPeriodRequest>("SymPeriodRequest");
+  qRegisterMetaType<SymPeriodResult>("SymPeriodResult");
+
+  m_generation.store(0);
+
+  m_workerThread = new QThread(this);
+  m_worker       = new SymPeriodWorker(&m_generation, m_dataMutex);
+
+  m_worker->moveToThread(m_workerThread);
+
+  connect(
+        this,
+        SIGNAL(triggerRun(SymPeriodRequest)),
+        m_worker,
+        SLOT(run(SymPeriodRequest)));
+
+  connect(
+        m_worker,
+        SIGNAL(resultReady(SymPeriodResult)),
+        this,
+        SLOT(onResultReady(SymPeriodResult)));
+
+  m_workerThread->start();
+}
+
+SymPeriod::~SymPeriod()
+{
+  reset();
+
+  m_workerThread->quit();
+  m_workerThread->wait();
+
+  delete m_worker;
+}
+
+unsigned int
+SymPeriod::bestPeriod(SymPeriodResult const &result)
+{
+  return result.candidates.empty() ? 0 : result.candidates[0].period;
+}
+
+void
+SymPeriod::setMaxPeriod(unsigned int period)
+{
+  period = qMax(period, 3u);
+
+  if (period != m_maxPeriod) {
+    m_maxPeriod = period;
+    reset();
+  }
+}
+
+void
+SymPeriod::trigger()
+{
+  SymPeriodRequest req;
+
+  req.generation = m_generation.load();
+  req.buffer     = m_buffer;
+  req.base       = m_base;
+  req.maxPeriod  = m_maxPeriod;
+  req.reset      = m_reset;
+
+  m_reset   = false;
+  m_busy    = true;
+  m_pending = false;
+
+  emit triggerRun(req);
+}
+
+void
+SymPeriod::update(
+    const std::vector<Symbol> *buffer,
+    const quint64 *base,
+    quint64 end)
+{
+  m_buffer = buffer;
+  m_base   = base;
+
+  // Not enough symbols for another block yet
+  if (end < m_next)
+    return;
+
+  if (m_busy)
+    m_pending = true;
+  else
+    trigger();
+}
+
+quint64
+SymPeriod::memoryUsage() const
+{
+  quint64 blockSize = blockSizeFor(m_maxPeriod);
+
+  return (m_maxPeriod + 1) * sizeof(qreal)
+      + 4 * blockSize * sizeof(SU_FFTW(_complex))
+      + (blockSize + m_maxPeriod) * sizeof(Symbol);
+}
+
+void
+SymPeriod::reset()
+{
+  ++m_generation;
+
+  m_busy    = false;
+  m_pending = false;
+  m_reset   = true;
+  m_next    = 0;
+}
+
+void
+SymPeriod::onResultReady(SymPeriodResult result)
+{
+  if (result.generation != m_generation.load())
+    return;
+
+  m_busy = false;
+  m_next = result.next;
+
+  emit resultReady(result);
+
+  // Symbols arrived while the worker was busy
+  if (m_pending)
+    trigger();
+}
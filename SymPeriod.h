@@ -0,0 +1,188 @@
+//
+//    SymPeriod.h: Frame period detection of symbol streams
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SYMPERIOD_H
+#define SYMPERIOD_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QMetaType>
+#include <atomic>
+#include <vector>
+
+#include <fftw3.h>
+#include "Decider.h"
+
+#define SYM_PERIOD_DEFAULT_MAX_PERIOD 4096
+#define SYM_PERIOD_MIN_BLOCK_SIZE     4096
+#define SYM_PERIOD_MAX_CANDIDATES     8
+
+// Periods scoring at least this fraction of the best one are equivalent
+#define SYM_PERIOD_EQUIVALENT_SCORE   .9
+
+// Minimum ratio between a correlation peak and its standard deviation in
+// a random stream (1 / sqrt(symbols))
+#define SYM_PERIOD_MIN_SIGNIFICANCE   8.
+
+struct SymPeriodCandidate {
+  unsigned int period = 0;
+  qreal        score  = 0; // Normalized autocorrelation
+};
+
+struct SymPeriodResult {
+  quint64                         generation = 0;
+  quint64                         symbols = 0; // Symbols correlated so far
+  quint64                         next    = 0; // Needed for the next block
+  std::vector<SymPeriodCandidate> candidates;  // Best first
+};
+
+struct SymPeriodRequest {
+  quint64                    generation = 0;
+  const std::vector<Symbol> *buffer = nullptr;
+  const quint64             *base   = nullptr; // Position of buffer[0]
+  unsigned int               maxPeriod = SYM_PERIOD_DEFAULT_MAX_PERIOD;
+  bool                       reset = false;
+};
+
+Q_DECLARE_METATYPE(SymPeriodResult)
+Q_DECLARE_METATYPE(SymPeriodRequest)
+
+class SymPeriodWorker : public QObject {
+  Q_OBJECT
+
+  const std::atomic<quint64> *m_generation;
+  QMutex                     *m_dataMutex;
+
+  // Correlation state, in stream positions
+  std::vector<qreal> m_acc;
+  unsigned int       m_maxPeriod = 0;
+  unsigned int       m_blockSize = 0;
+  quint64            m_position  = 0;
+  quint64            m_symbols   = 0;
+  bool               m_started   = false;
+
+  SU_FFTW(_plan)     m_forwardX = nullptr;
+  SU_FFTW(_plan)     m_forwardY = nullptr;
+  SU_FFTW(_plan)     m_backward = nullptr;
+  SU_FFTW(_complex) *m_x = nullptr;
+  SU_FFTW(_complex) *m_y = nullptr;
+
+  inline bool
+  cancelled(quint64 generation) const
+  {
+    return m_generation->load() != generation;
+  }
+
+  void destroyPlans();
+  bool configure(unsigned int maxPeriod);
+  void correlateBlock(const Symbol *data);
+  void findCandidates(std::vector<SymPeriodCandidate> &) const;
+
+public:
+  SymPeriodWorker(
+      const std::atomic<quint64> *generation,
+      QMutex *dataMutex,
+      QObject *parent = nullptr);
+  ~SymPeriodWorker() override;
+
+public slots:
+  void run(SymPeriodRequest);
+
+signals:
+  void resultReady(SymPeriodResult);
+};
+
+//
+// SymPeriod looks for the frame length of a symbol stream, as the lags
+// at which its autocorrelation peaks. Periodic structures (sync words,
+// headers, pilots) correlate with their copies one frame away, while the
+// payload averages out.
+//
+// The stream is processed in blocks of N symbols in a worker thread. Every
+// block is correlated against itself followed by the next maxPeriod
+// symbols, using FFTs of 2N points, and the result is added to a running
+// sum. This yields the exact autocorrelation of the whole stream seen so
+// far, and feeding more symbols only processes the new blocks.
+//
+// Positions are absolute: *base tells the position of the first symbol
+// of the buffer, so the owner may drop old symbols. The worker only reads
+// the buffer and *base while holding the mutex given to the constructor,
+// which the owner must hold too while modifying them.
+//
+class SymPeriod : public QObject {
+  Q_OBJECT
+
+  QThread             *m_workerThread = nullptr;
+  SymPeriodWorker     *m_worker = nullptr;
+  std::atomic<quint64> m_generation;
+  QMutex              *m_dataMutex;
+
+  unsigned int m_maxPeriod = SYM_PERIOD_DEFAULT_MAX_PERIOD;
+  quint64      m_next      = 0;
+  bool         m_busy      = false;
+  bool         m_pending   = false;
+  bool         m_reset     = true;
+
+  const std::vector<Symbol> *m_buffer = nullptr;
+  const quint64             *m_base   = nullptr;
+
+  void trigger();
+
+public:
+  SymPeriod(QMutex *dataMutex, QObject *parent = nullptr);
+  ~SymPeriod() override;
+
+  // The period detected from a result, or 0 if there is none
+  static unsigned int bestPeriod(SymPeriodResult const &);
+
+  void setMaxPeriod(unsigned int);
+
+  inline unsigned int
+  maxPeriod() const
+  {
+    return m_maxPeriod;
+  }
+
+  inline bool
+  isBusy() const
+  {
+    return m_busy;
+  }
+
+  // Tells that the stream now ends at position `end`
+  void update(
+      const std::vector<Symbol> *buffer,
+      const quint64 *base,
+      quint64 end);
+
+  quint64 memoryUsage() const;
+
+public slots:
+  // Forgets the correlation, e.g. when the stream changes
+  void reset();
+
+  // Private slots
+  void onResultReady(SymPeriodResult);
+
+signals:
+  void triggerRun(SymPeriodRequest);
+  void resultReady(SymPeriodResult);
+};
+
+#endif // SYMPERIOD_H
@@ -0,0 +1,301 @@
+//
+//    SymSearch.cpp: Symbol pattern search
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include "SymSearch.h"
+#include "SuWidgetsHelpers.h"
+#include <QMutexLocker>
+
+/////////////////////////////// SymSearchWorker ////////////////////////////////
+SymSearchWorker::SymSearchWorker(
+    const std::atomic<quint64> *generation,
+    QMutex *dataMutex,
+    QObject *parent) : QObject(parent)
+{
+  m_generation = generation;
+  m_dataMutex  = dataMutex;
+}
+
+SymSearchWorker::~SymSearchWorker()
+{
+}
+
+//
+// Shift-And with k mismatches: bit i of state[j] is set if the last i + 1
+// symbols match the first i + 1 symbols of the pattern with at most j
+// errors. A symbol either extends a state with a match, or extends the
+// state of one error less with a mismatch.
+//
+void
+SymSearchWorker::run(SymSearchRequest req)
+{
+  uint64_t masks[256] = {0};
+  uint64_t invMasks[256] = {0};
+  uint64_t state[SYM_SEARCH_MAX_PATTERN + 1];
+  uint64_t invState[SYM_SEARCH_MAX_PATTERN + 1];
+  unsigned int len = SCAST(unsigned int, req.pattern.size());
+  unsigned int maxSym = (1u << req.bps) - 1;
+  unsigned int errors = qMin(req.errors, len - 1);
+  uint64_t top = SCAST(uint64_t, 1) << (len - 1);
+  quint64 total = req.end - req.start;
+  quint64 count = 0;
+  quint64 p = req.start;
+  bool truncated = false;
+
+  for (unsigned int i = 0; i < len; ++i) {
+    masks[req.pattern[i]] |= SCAST(uint64_t, 1) << i;
+    invMasks[maxSym - req.pattern[i]] |= SCAST(uint64_t, 1) << i;
+  }
+
+  for (unsigned int j = 0; j <= errors; ++j)
+    state[j] = invState[j] = 0;
+
+  while (p < req.end && !truncated) {
+    QVector<qint64> hits;
+    quint64 end = qMin(req.end, p + SYM_SEARCH_CHUNK_SIZE);
+
+    if (cancelled(req.generation))
+      return;
+
+    {
+      QMutexLocker locker(m_dataMutex);
+      const Symbol *data = req.buffer->data();
+
+      // The buffer may have been cleared or trimmed since the last chunk
+      if (cancelled(req.generation))
+        return;
+
+      end = qMin(end, SCAST(quint64, req.buffer->size()));
+      if (p >= end)
+        break;
+
+      for (; p < end; ++p) {
+        Symbol c = data[p];
+        uint64_t match;
+
+        if (errors == 0) {
+          state[0] = ((state[0] << 1) | 1) & masks[c];
+          if (req.inverted)
+            invState[0] = ((invState[0] << 1) | 1) & invMasks[c];
+        } else {
+          uint64_t prev = state[0], curr;
+
+          state[0] = ((prev << 1) | 1) & masks[c];
+          for (unsigned int j = 1; j <= errors; ++j) {
+            curr     = state[j];
+            state[j] = (((curr << 1) | 1) & masks[c]) | ((prev << 1) | 1);
+            prev     = curr;
+          }
+
+          if (req.inverted) {
+            prev = invState[0];
+            invState[0] = ((prev << 1) | 1) & invMasks[c];
+            for (unsigned int j = 1; j <= errors; ++j) {
+              curr        = invState[j];
+              invState[j] = (((curr << 1) | 1) & invMasks[c]) | ((prev << 1) | 1);
+              prev        = curr;
+            }
+          }
+        }
+
+        match = state[errors] | (req.inverted ? invState[errors] : 0);
+
+        if (match & top) {
+          hits.append(SCAST(qint64, p + 1 - len));
+          if (++count >= SYM_SEARCH_MAX_MATCHES) {
+            truncated = true;
+            ++p;
+            break;
+          }
+        }
+      }
+    }
+
+    if (!hits.isEmpty())
+      emit found(req.generation, hits);
+
+    emit progress(req.generation, p - req.start, total);
+  }
+
+  emit finished(req.generation, truncated);
+}
+
+////////////////////////////////// SymSearch ///////////////////////////////////
+SymSearch::SymSearch(QMutex *dataMutex, QObject *parent) : QObject(parent)
+{
+  m_dataMutex = dataMutex;
+
+  qRegisterMetaType<SymSearchRequest>("SymSearchRequest");
+  qRegisterMetaType<QVector<qint64>>("QVector<qint64>");
+
+  m_generation.store(0);
+
+  m_workerThread = new QThread(this);
+  m_worker       = new SymSearchWorker(&m_generation, m_dataMutex);
+
+  m_worker->moveToThread(m_workerThread);
+
+  connect(
+        this,
+        SIGNAL(triggerSearch(SymSearchRequest)),
+        m_worker,
+        SLOT(run(SymSearchRequest)));
+
+  connect(
+        m_worker,
+        SIGNAL(found(quint64, QVector<qint64>)),
+        this,
+        SLOT(onFound(quint64, QVector<qint64>)));
+
+  connect(
+        m_worker,
+        SIGNAL(progress(quint64, quint64, quint64)),
+        this,
+        SLOT(onProgress(quint64, quint64, quint64)));
+
+  connect(
+        m_worker,
+        SIGNAL(finished(quint64, bool)),
+        this,
+        SLOT(onFinished(quint64, bool)));
+
+  m_workerThread->start();
+}
+
+SymSearch::~SymSearch()
+{
+  cancel();
+
+  m_workerThread->quit();
+  m_workerThread->wait();
+
+  delete m_worker;
+}
+
+bool
+SymSearch::parsePattern(
+    QString const &text,
+    unsigned int bps,
+    std::vector<Symbol> &pattern)
+{
+  unsigned int base = 1u << bps;
+
+  if (bps == 0 || bps > 4)
+    return false;
+
+  pattern.clear();
+
+  for (auto c : text) {
+    ushort u = c.toLower().unicode();
+    unsigned int digit;
+
+    if (c.isSpace())
+      continue;
+
+    if (u >= '0' && u <= '9')
+      digit = u - '0';
+    else if (u >= 'a' && u <= 'f')
+      digit = u - 'a' + 10;
+    else
+      return false;
+
+    if (digit >= base)
+      return false;
+
+    pattern.push_back(SCAST(Symbol, digit));
+  }
+
+  return !pattern.empty() && pattern.size() <= SYM_SEARCH_MAX_PATTERN;
+}
+
+bool
+SymSearch::search(
+    const std::vector<Symbol> *buffer,
+    std::vector<Symbol> const &pattern,
+    unsigned int bps,
+    unsigned int errors,
+    bool inverted,
+    quint64 start)
+{
+  SymSearchRequest req;
+  unsigned int maxSym;
+
+  cancel();
+
+  if (buffer == nullptr || bps == 0 || bps > 8)
+    return false;
+
+  if (pattern.empty() || pattern.size() > SYM_SEARCH_MAX_PATTERN)
+    return false;
+
+  maxSym = (1u << bps) - 1;
+  for (auto s : pattern)
+    if (s > maxSym)
+      return false;
+
+  req.generation = m_generation.load();
+  req.buffer     = buffer;
+  req.pattern    = pattern;
+  req.bps        = bps;
+  req.errors     = errors;
+  req.inverted   = inverted;
+  req.start      = start;
+
+  {
+    QMutexLocker locker(m_dataMutex);
+    req.end = buffer->size();
+  }
+
+  if (req.start >= req.end)
+    return false;
+
+  m_busy = true;
+  emit triggerSearch(req);
+
+  return true;
+}
+
+void
+SymSearch::cancel()
+{
+  ++m_generation;
+  m_busy = false;
+}
+
+void
+SymSearch::onFound(quint64 generation, QVector<qint64> offsets)
+{
+  if (generation == m_generation.load())
+    emit found(offsets);
+}
+
+void
+SymSearch::onProgress(quint64 generation, quint64 done, quint64 total)
+{
+  if (generation == m_generation.load())
+    emit progress(done, total);
+}
+
+void
+SymSearch::onFinished(quint64 generation, bool truncated)
+{
+  if (generation == m_generation.load()) {
+    m_busy = false;
+    emit finished(truncated);
+  }
+}
@@ -0,0 +1,144 @@
+//
+//    SymSearch.h: Symbol pattern search
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SYMSEARCH_H
+#define SYMSEARCH_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QMetaType>
+#include <QVector>
+#include <atomic>
+#include <vector>
+
+#include "Decider.h"
+
+// Patterns are matched in a single machine word
+#define SYM_SEARCH_MAX_PATTERN 64
+
+// Symbols searched per lock of the buffer
+#define SYM_SEARCH_CHUNK_SIZE  (1 << 20)
+
+// The search stops after this many matches
+#define SYM_SEARCH_MAX_MATCHES (1 << 22)
+
+struct SymSearchRequest {
+  quint64                    generation = 0;
+  const std::vector<Symbol> *buffer = nullptr;
+  std::vector<Symbol>        pattern;
+  unsigned int               bps      = 1;
+  unsigned int               errors   = 0;
+  bool                       inverted = false;
+  quint64                    start    = 0;
+  quint64                    end      = 0;
+};
+
+Q_DECLARE_METATYPE(SymSearchRequest)
+
+class SymSearchWorker : public QObject {
+  Q_OBJECT
+
+  const std::atomic<quint64> *m_generation;
+  QMutex                     *m_dataMutex;
+
+  inline bool
+  cancelled(quint64 generation) const
+  {
+    return m_generation->load() != generation;
+  }
+
+public:
+  SymSearchWorker(
+      const std::atomic<quint64> *generation,
+      QMutex *dataMutex,
+      QObject *parent = nullptr);
+  ~SymSearchWorker() override;
+
+public slots:
+  void run(SymSearchRequest);
+
+signals:
+  void found(quint64 generation, QVector<qint64> offsets);
+  void progress(quint64 generation, quint64 done, quint64 total);
+  void finished(quint64 generation, bool truncated);
+};
+
+//
+// SymSearch looks for a pattern of symbols in a symbol buffer, allowing up
+// to `errors` mismatching symbols, and optionally for its inverse (every
+// symbol s replaced by 2^bps - 1 - s) too. Matching is bit-parallel
+// (Shift-And, extended with one state word per tolerated error), so the
+// cost per symbol does not depend on the pattern length.
+//
+// The search runs in a worker thread and reports the offsets of the
+// matches (in increasing order) as they are found. The worker only reads
+// the buffer while holding the mutex given to the constructor: the owner
+// must hold it too while appending to the buffer, and must cancel the
+// search before removing symbols from it.
+//
+class SymSearch : public QObject {
+  Q_OBJECT
+
+  QThread             *m_workerThread = nullptr;
+  SymSearchWorker     *m_worker = nullptr;
+  std::atomic<quint64> m_generation;
+  QMutex              *m_dataMutex;
+  bool                 m_busy = false;
+
+public:
+  SymSearch(QMutex *dataMutex, QObject *parent = nullptr);
+  ~SymSearch() override;
+
+  // Digits of base 2^bps (bps <= 4). Blanks are ignored.
+  static bool parsePattern(
+      QString const &text,
+      unsigned int bps,
+      std::vector<Symbol> &pattern);
+
+  inline bool
+  isBusy() const
+  {
+    return m_busy;
+  }
+
+  bool search(
+      const std::vector<Symbol> *buffer,
+      std::vector<Symbol> const &pattern,
+      unsigned int bps,
+      unsigned int errors = 0,
+      bool inverted = false,
+      quint64 start = 0);
+
+public slots:
+  void cancel();
+
+  // Private slots
+  void onFound(quint64, QVector<qint64>);
+  void onProgress(quint64, quint64, quint64);
+  void onFinished(quint64, bool);
+
+signals:
+  void triggerSearch(SymSearchRequest);
+
+  void found(QVector<qint64> offsets);
+  void progress(quint64 done, quint64 total);
+  void finished(bool truncated);
+};
+
+#endif // SYMSEARCH_H
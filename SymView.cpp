@@ -22,8 +22,11 @@
 #include <fstream>
 #include <iomanip>
 #include <SuWidgetsHelpers.h>
+#include "SuWidgetsRecorder.h"
 #include <QApplication>
 #include <QClipboard>
+#include <QMutexLocker>
+#include <algorithm>
 
 SymView::SymView(QWidget *parent) :
   ThrottleableWidget(parent)
@@ -36,6 +39,84 @@ SymView::SymView(QWidget *parent) :
   this->invalidate();
 }
 
+void
+SymView::memoryUsage(SuWidgetsMemoryUsage &usage) const
+{
+  usage[SUWIDGETS_MEMORY_HISTORIES] += this->buffer.capacity() * sizeof(Symbol)
+      + this->matches.capacity() * sizeof(qint64)
+      + this->matchMask.capacity();
+  if (this->periodDetector != nullptr)
+    usage[SUWIDGETS_MEMORY_ACCUMULATORS] += this->periodDetector->memoryUsage();
+  usage[SUWIDGETS_MEMORY_IMAGES]    += SuWidgetsMemory::imageBytes(this->viewPort);
+}
+
+//
+// Drops the oldest symbols, a whole number of rows at a time so that the
+// columns of the view stay aligned. Offset and selection are moved back
+// accordingly.
+//
+quint64
+SymView::reclaimMemory(SuWidgetsMemoryCategory category, quint64 bytes)
+{
+  quint64 before = this->buffer.capacity() * sizeof(Symbol);
+  size_t size = this->buffer.size();
+  size_t drop = 0, row;
+
+  if (category != SUWIDGETS_MEMORY_HISTORIES)
+    return 0;
+
+  {
+    QMutexLocker locker(&this->bufferMutex);
+
+    // Workers only read the buffer with the mutex held. Cancel them before
+    // it moves: offsets of a running search would be off too.
+    this->cancelSearch();
+    if (this->periodDetector != nullptr)
+      this->periodDetector->reset();
+
+    if (size > SUWIDGETS_MEMORY_MIN_HISTORY) {
+      row  = static_cast<size_t>(this->stride > 0 ? this->stride : 1);
+      drop = static_cast<size_t>(bytes / sizeof(Symbol));
+      drop = std::min(drop, size - SUWIDGETS_MEMORY_MIN_HISTORY);
+      drop = ((drop + row - 1) / row) * row;
+      if (drop > size)
+        drop = size;
+
+      this->buffer.erase(this->buffer.begin(), this->buffer.begin() + drop);
+      this->dropped += drop;
+    }
+
+    this->buffer.shrink_to_fit();
+  }
+
+  if (drop > 0) {
+    // Keep the matches that are still in the buffer
+    auto first = std::lower_bound(
+          this->matches.begin(),
+          this->matches.end(),
+          static_cast<qint64>(drop));
+    this->matches.erase(this->matches.begin(), first);
+    for (auto &m : this->matches)
+      m -= static_cast<qint64>(drop);
+    this->currentMatch = -1;
+
+    this->selStart = std::max<qint64>(this->selStart - static_cast<qint64>(drop), 0);
+    this->selEnd   = std::max<qint64>(this->selEnd - static_cast<qint64>(drop), 0);
+
+    if (this->offset >= drop) {
+      this->offset -= static_cast<unsigned int>(drop);
+    } else {
+      this->offset = 0;
+    }
+
+    emit offsetChanged(this->offset);
+  }
+
+  this->invalidate();
+
+  return before - this->buffer.capacity() * sizeof(Symbol);
+}
+
 void
 SymView::assertImage(void)
 {
@@ -87,10 +168,18 @@ SymView::drawToImage(
       selEnd   = this->selEnd;
     }
   }
+  bool haveMatches = showSelection && !this->matches.empty();
+  bool inMatch = false;
+
+  if (haveMatches)
+    this->markMatches(start, end);
+
   if (this->zoom == 1) {
     bool inSel;
     while (p < end) {
       inSel = showSelection && selStart <= p && p < selEnd;
+      if (haveMatches)
+        inMatch = this->matchMask[p - start] != 0;
 
       asInt = (static_cast<int>(this->buffer[p++]) * 255) / convD;
       if (this->reverse)
@@ -100,6 +189,8 @@ SymView::drawToImage(
       if (x++ >= lineStart) {
         if (inSel)
           color = qRgb(255 - asInt, 255 - asInt, 255);
+        else if (inMatch)
+          color = qRgb(255, 255 - asInt, 0);
         else
           color = qRgb(
                 (this->lowSym.red()   * (255 - asInt) + this->highSym.red()   * asInt) / 255,
@@ -152,8 +243,13 @@ SymView::drawToImage(
           if (this->reverse)
             asInt = ~asInt;
 
+          if (haveMatches)
+            inMatch = this->matchMask[p - start] != 0;
+
           if (inSel)
             color = qRgb(255 - asInt, 255 - asInt, 255);
+          else if (inMatch)
+            color = qRgb(255, 255 - asInt, 0);
           else
             color = qRgb(
                   (this->lowSym.red()   * (255 - asInt) + this->highSym.red()   * asInt) / 255,
@@ -272,12 +368,264 @@ SymView::draw(void)
 void
 SymView::clear(void)
 {
-  this->buffer.clear();
+  this->cancelSearch();
+  this->clearSearch();
+
+  {
+    QMutexLocker locker(&this->bufferMutex);
+    this->dropped += this->buffer.size();
+    this->buffer.clear();
+  }
+
+  // A new stream begins
+  if (this->periodDetector != nullptr)
+    this->periodDetector->reset();
+  this->frameCandidates.clear();
+  this->frameLength = 0;
+
   this->offset = 0;
   this->selStart = this->selEnd = 0;
   this->invalidate();
 }
 
+//
+// Marks which symbols in [start, end) belong to a match, so that drawing
+// does not look them up one by one.
+//
+void
+SymView::markMatches(unsigned int start, unsigned int end)
+{
+  auto it = std::lower_bound(
+        this->matches.begin(),
+        this->matches.end(),
+        static_cast<qint64>(start) - static_cast<qint64>(this->matchLength) + 1);
+
+  this->matchMask.assign(end - start, 0);
+
+  for (; it != this->matches.end() && *it < static_cast<qint64>(end); ++it) {
+    qint64 from = std::max<qint64>(*it, start);
+    qint64 to   = std::min<qint64>(*it + this->matchLength, end);
+
+    std::fill(
+          this->matchMask.begin() + (from - start),
+          this->matchMask.begin() + (to - start),
+          1);
+  }
+}
+
+bool
+SymView::search(
+    std::vector<Symbol> const &pattern,
+    unsigned int errors,
+    bool inverted)
+{
+  if (this->searcher == nullptr) {
+    this->searcher = new SymSearch(&this->bufferMutex, this);
+
+    this->connect(
+          this->searcher,
+          SIGNAL(found(QVector<qint64>)),
+          this,
+          SLOT(onSearchFound(QVector<qint64>)));
+
+    this->connect(
+          this->searcher,
+          SIGNAL(progress(quint64, quint64)),
+          this,
+          SLOT(onSearchProgress(quint64, quint64)));
+
+    this->connect(
+          this->searcher,
+          SIGNAL(finished(bool)),
+          this,
+          SLOT(onSearchFinished(bool)));
+  }
+
+  this->clearSearch();
+  this->matchLength = static_cast<unsigned int>(pattern.size());
+
+  return this->searcher->search(
+        &this->buffer,
+        pattern,
+        this->bps,
+        errors,
+        inverted);
+}
+
+bool
+SymView::search(QString const &pattern, unsigned int errors, bool inverted)
+{
+  std::vector<Symbol> symbols;
+
+  if (!SymSearch::parsePattern(pattern, this->bps, symbols))
+    return false;
+
+  return this->search(symbols, errors, inverted);
+}
+
+void
+SymView::cancelSearch(void)
+{
+  if (this->searcher != nullptr)
+    this->searcher->cancel();
+}
+
+void
+SymView::clearSearch(void)
+{
+  this->cancelSearch();
+
+  if (!this->matches.empty()) {
+    this->matches.clear();
+    this->invalidate();
+  }
+
+  this->currentMatch = -1;
+}
+
+void
+SymView::selectMatch(unsigned long index)
+{
+  qint64 match, align, stride;
+
+  if (index >= this->matches.size())
+    return;
+
+  this->currentMatch = static_cast<long>(index);
+
+  match  = this->matches[index];
+  stride = this->stride > 0 ? this->stride : 1;
+  align  = this->offset % stride;
+
+  this->selStart = match;
+  this->selEnd   = match + this->matchLength;
+
+  // Scroll to the row of the match, keeping the column alignment
+  this->setAutoScroll(false);
+  this->setOffset(
+        static_cast<unsigned int>(
+          match < align ? 0 : match - (match - align) % stride));
+  this->invalidate();
+}
+
+void
+SymView::nextMatch(void)
+{
+  if (!this->matches.empty())
+    this->selectMatch(
+          static_cast<unsigned long>(this->currentMatch + 1)
+          % this->matches.size());
+}
+
+void
+SymView::previousMatch(void)
+{
+  if (!this->matches.empty())
+    this->selectMatch(
+          this->currentMatch <= 0
+          ? this->matches.size() - 1
+          : static_cast<unsigned long>(this->currentMatch - 1));
+}
+
+void
+SymView::onSearchFound(QVector<qint64> offsets)
+{
+  this->matches.insert(this->matches.end(), offsets.begin(), offsets.end());
+  this->invalidate();
+
+  emit searchMatchesFound(this->matches.size());
+}
+
+void
+SymView::onSearchProgress(quint64 done, quint64 total)
+{
+  emit searchProgress(done, total);
+}
+
+void
+SymView::onSearchFinished(bool truncated)
+{
+  emit searchFinished(this->matches.size(), truncated);
+}
+
+void
+SymView::setFrameDetection(bool enabled)
+{
+  if (enabled == this->getFrameDetection())
+    return;
+
+  if (enabled) {
+    this->periodDetector = new SymPeriod(&this->bufferMutex, this);
+    this->periodDetector->setMaxPeriod(this->maxFrameLength);
+
+    this->connect(
+          this->periodDetector,
+          SIGNAL(resultReady(SymPeriodResult)),
+          this,
+          SLOT(onPeriodResult(SymPeriodResult)));
+
+    this->periodDetector->update(
+          &this->buffer,
+          &this->dropped,
+          this->dropped + this->buffer.size());
+  } else {
+    delete this->periodDetector;
+    this->periodDetector = nullptr;
+    this->frameCandidates.clear();
+    this->frameLength = 0;
+    this->autoFrameLength = false;
+  }
+}
+
+void
+SymView::setAutoFrameLength(bool enabled)
+{
+  this->autoFrameLength = enabled;
+
+  if (enabled) {
+    this->setFrameDetection(true);
+
+    if (this->frameLength > 0) {
+      this->setAutoStride(false);
+      this->setStride(this->frameLength);
+    }
+  }
+}
+
+void
+SymView::setMaxFrameLength(unsigned int length)
+{
+  this->maxFrameLength = length;
+
+  if (this->periodDetector != nullptr) {
+    this->periodDetector->setMaxPeriod(length);
+    this->periodDetector->update(
+          &this->buffer,
+          &this->dropped,
+          this->dropped + this->buffer.size());
+  }
+}
+
+void
+SymView::onPeriodResult(SymPeriodResult result)
+{
+  unsigned int best = SymPeriod::bestPeriod(result);
+
+  this->frameCandidates = result.candidates;
+
+  if (best == 0 || best == this->frameLength)
+    return;
+
+  this->frameLength = best;
+
+  if (this->autoFrameLength) {
+    this->setAutoStride(false);
+    this->setStride(best);
+  }
+
+  emit frameLengthDetected(best, result.candidates[0].score);
+}
+
 // Can you belive that some people out there code like this for a living?
 void
 SymView::save(QString const &dest, FileFormat format)
@@ -384,12 +732,28 @@ SymView::scrollToBottom(void)
 void
 SymView::feed(const Symbol *data, unsigned int length)
 {
-  this->buffer.insert(
-        this->buffer.end(),
-        data,
-        data + length);
+  if (SuWidgetsRecorder::isRecording())
+    SuWidgetsRecorder::record(
+          this,
+          SUWIDGETS_TRACE_SYMVIEW_FEED,
+          data,
+          length * sizeof(Symbol));
+
+  {
+    QMutexLocker locker(&this->bufferMutex);
+    this->buffer.insert(
+          this->buffer.end(),
+          data,
+          data + length);
+  }
 
   if (length > 0) {
+    if (this->periodDetector != nullptr)
+      this->periodDetector->update(
+            &this->buffer,
+            &this->dropped,
+            this->dropped + this->buffer.size());
+
     if (this->autoScroll)
       this->scrollToBottom();
 
@@ -590,6 +954,13 @@ SymView::keyPressEvent(QKeyEvent *event)
         this->copyToClipboard();
       break;
 
+    case Qt::Key_F3:
+      if (event->modifiers() & Qt::ShiftModifier)
+        this->previousMatch();
+      else
+        this->nextMatch();
+      break;
+
     case Qt::Key_A:
       if (event->modifiers() & Qt::Modifier::CTRL) {
         this->selStart = 0;
@@ -22,15 +22,18 @@
 
 #include <QFrame>
 #include "Decider.h"
+#include "SuWidgetsMemory.h"
 #include <QResizeEvent>
 #include "ThrottleableWidget.h"
+#include "SymSearch.h"
+#include "SymPeriod.h"
 
 #define SYMVIEW_MAX_ZOOM 50
 #define SYMVIEW_DEFAULT_BG_COLOR QColor(0, 0, 0)
 #define SYMVIEW_DEFAULT_LO_COLOR QColor(0, 0, 0)
 #define SYMVIEW_DEFAULT_HI_COLOR QColor(0xff, 0xff, 0xff)
 
-class SymView : public ThrottleableWidget
+class SymView : public ThrottleableWidget, public SuWidgetsMemoryClient
 {
   Q_OBJECT
 
@@ -52,8 +55,10 @@ class SymView : public ThrottleableWidget
         WRITE setHiColor
         NOTIFY hiColorChanged)
 
-  // Symbol buffer
+  // Symbol buffer. Workers read it while holding bufferMutex.
   std::vector<Symbol> buffer; // TODO: Allow loans
+  QMutex bufferMutex;
+  quint64 dropped = 0;      // Symbols removed from the front of buffer
   // Behavior
   bool autoScroll = true;
   bool autoStride = true;
@@ -79,8 +84,23 @@ class SymView : public ThrottleableWidget
   QColor lowSym;
   QColor highSym;
 
+  // Pattern search. Matches are sorted offsets.
+  SymSearch *searcher = nullptr;
+  std::vector<qint64> matches;
+  std::vector<uint8_t> matchMask; // Per visible symbol, see markMatches
+  unsigned int matchLength = 0;
+  long currentMatch = -1;
+
+  // Frame length detection
+  SymPeriod *periodDetector = nullptr;
+  std::vector<SymPeriodCandidate> frameCandidates;
+  unsigned int frameLength = 0;
+  unsigned int maxFrameLength = SYM_PERIOD_DEFAULT_MAX_PERIOD;
+  bool autoFrameLength = false;
+
   // Private methods
   void assertImage(void);
+  void markMatches(unsigned int start, unsigned int end);
   void drawToImage(
       QImage &image,
       unsigned int start,
@@ -294,7 +314,87 @@ public:
 
   SymView(QWidget *parent = nullptr);
 
+  void memoryUsage(SuWidgetsMemoryUsage &) const override;
+  quint64 reclaimMemory(SuWidgetsMemoryCategory, quint64) override;
+
   void scrollToBottom(void);
+
+  //
+  // Looks for a pattern (and for its inverse, if asked to) allowing up to
+  // `errors` wrong symbols. Matches arrive through searchMatchesFound()
+  // and are highlighted as they do. F3 and Shift+F3 select the next and
+  // the previous match.
+  //
+  bool search(
+      std::vector<Symbol> const &pattern,
+      unsigned int errors = 0,
+      bool inverted = false);
+  bool search(QString const &pattern, unsigned int errors = 0, bool inverted = false);
+  void cancelSearch(void);
+  void clearSearch(void);
+  void selectMatch(unsigned long index);
+  void nextMatch(void);
+  void previousMatch(void);
+
+  bool
+  isSearching(void) const
+  {
+    return this->searcher != nullptr && this->searcher->isBusy();
+  }
+
+  unsigned long
+  getMatchCount(void) const
+  {
+    return this->matches.size();
+  }
+
+  qint64
+  getMatch(unsigned long index) const
+  {
+    return index < this->matches.size() ? this->matches[index] : -1;
+  }
+
+  //
+  // Looks for the frame length of the stream (see SymPeriod) as symbols
+  // are fed. Candidates are reported through frameLengthDetected(). If
+  // autoFrameLength is set, the best one is applied to the stride (and
+  // autoStride is disabled).
+  //
+  void setFrameDetection(bool);
+  void setAutoFrameLength(bool);
+  void setMaxFrameLength(unsigned int);
+
+  bool
+  getFrameDetection(void) const
+  {
+    return this->periodDetector != nullptr;
+  }
+
+  bool
+  getAutoFrameLength(void) const
+  {
+    return this->autoFrameLength;
+  }
+
+  unsigned int
+  getMaxFrameLength(void) const
+  {
+    return this->maxFrameLength;
+  }
+
+  // Best first, 0 if none was found
+  unsigned int
+  getFrameLength(void) const
+  {
+    return this->frameLength;
+  }
+
+  std::vector<SymPeriodCandidate> const &
+  getFrameLengthCandidates(void) const
+  {
+    return this->frameCandidates;
+  }
+
   void feed(std::vector<Symbol> const &x);
   void feed(const Symbol *data, unsigned int length);
   void copyToClipboard(void);
@@ -317,6 +417,17 @@ signals:
   void backgroundColorChanged();
   void loColorChanged();
   void hiColorChanged();
+  void searchProgress(quint64 done, quint64 total);
+  void searchMatchesFound(unsigned long count);
+  void searchFinished(unsigned long count, bool truncated);
+  void frameLengthDetected(unsigned int period, qreal score);
+
+public slots:
+  // Private slots
+  void onSearchFound(QVector<qint64>);
+  void onSearchProgress(quint64, quint64);
+  void onSearchFinished(bool);
+  void onPeriodResult(SymPeriodResult);
 };
 
 #endif
@@ -28,6 +28,54 @@
 #include <QResizeEvent>
 #include <QFile>
 #include "TVDisplay.h"
+#include "SuWidgetsKernels.h"
+#include "SuWidgetsRecorder.h"
+#include <climits>
+
+void
+TVDisplayResampler::configure(int from, int to)
+{
+  float scale   = static_cast<float>(to) / static_cast<float>(from);
+  float support = scale < 1 ? 1 / scale : 1;
+
+  this->taps = static_cast<int>(std::ceil(2 * support)) + 1;
+  this->first.resize(static_cast<size_t>(to));
+  this->weights.assign(static_cast<size_t>(to * this->taps), 0);
+  this->outFirst.assign(static_cast<size_t>(from), INT_MAX);
+  this->outLast.assign(static_cast<size_t>(from), -1);
+
+  for (int i = 0; i < to; ++i) {
+    float center = (i + .5f) / scale;
+    int   lo     = qMax(static_cast<int>(std::floor(center - support)), 0);
+    float *w     = this->weights.data() + i * this->taps;
+    float sum    = 0;
+
+    lo = qMin(lo, qMax(from - this->taps, 0));
+    this->first[static_cast<size_t>(i)] = lo;
+
+    for (int k = 0; k < this->taps && lo + k < from; ++k) {
+      float d = std::fabs(lo + k + .5f - center) / support;
+      w[k] = d < 1 ? 1 - d : 0;
+      sum += w[k];
+    }
+
+    // Edges and very small sources: fall back to the nearest sample
+    if (sum <= 0) {
+      int nearest = qBound(0, static_cast<int>(center), from - 1) - lo;
+      w[nearest] = sum = 1;
+    }
+
+    for (int k = 0; k < this->taps; ++k) {
+      w[k] /= sum;
+
+      if (w[k] > 0) {
+        size_t j = static_cast<size_t>(lo + k);
+        this->outFirst[j] = qMin(this->outFirst[j], i);
+        this->outLast[j]  = qMax(this->outLast[j], i);
+      }
+    }
+  }
+}
 
 void
 TVDisplay::setPicGeometry(int width, int height)
@@ -35,6 +83,8 @@ TVDisplay::setPicGeometry(int width, int height)
   if (width != this->picture.width() || height != this->picture.height()) {
     this->picture = QImage(width, height, QImage::Format_ARGB32);
     this->picture.fill(this->background);
+    this->dirty = true;
+    this->dirtyFirst = this->dirtyLast = -1;
 
     if (this->mAcummulate) {
       this->mAccumBuffer.resize(width * height);
@@ -52,6 +102,18 @@ TVDisplay::putFrame(const struct sigutils_tv_frame_buffer *buffer)
   const SUFLOAT *picBuf = buffer->buffer;
   SUFLOAT k = 1;
 
+  if (SuWidgetsRecorder::isRecording()) {
+    qint64 args[] = {buffer->width, buffer->height};
+
+    SuWidgetsRecorder::record(
+          this,
+          SUWIDGETS_TRACE_TV_FRAME,
+          picBuf,
+          static_cast<quint64>(buffer->width * buffer->height) * sizeof(SUFLOAT),
+          args,
+          2);
+  }
+
   if (this->picture.width() != buffer->width
       || this->picture.height() != buffer->height)
     this->setPicGeometry(buffer->width, buffer->height);
@@ -67,13 +129,17 @@ TVDisplay::putFrame(const struct sigutils_tv_frame_buffer *buffer)
     } else {
       if (this->mAccumSPLPF) {
         // SPLPF-based accumulation
-        for (int i = 0; i < size; ++i)
-          this->mAccumBuffer[i] +=
-            this->mAccumAlpha * (picBuf[i] - this->mAccumBuffer[i]);
+        SuWidgetsKernels::smooth(
+              this->mAccumBuffer.data(),
+              picBuf,
+              this->mAccumAlpha,
+              static_cast<SUSCOUNT>(size));
       } else {
         // Regular average accumulation
-        for (int i = 0; i < size; ++i)
-          this->mAccumBuffer[i] += picBuf[i];
+        SuWidgetsKernels::accumulate(
+              this->mAccumBuffer.data(),
+              picBuf,
+              static_cast<SUSCOUNT>(size));
         k = 1.f / this->mAcumCount;
       }
     }
@@ -93,20 +159,26 @@ TVDisplay::putFrame(const struct sigutils_tv_frame_buffer *buffer)
     }
   }
 
-  this->dirty = true;
+  this->markLines(0, buffer->height - 1);
 }
 
 void
-TVDisplay::putLine(int line, const SUFLOAT *data, int size)
+TVDisplay::convertLine(int line, const SUFLOAT *data, int size)
 {
   int i;
   QRgb *scanLine;
 
-  if (!this->havePicGeometry())
-    return;
+  if (SuWidgetsRecorder::isRecording()) {
+    qint64 args[] = {line, this->picture.width(), this->picture.height()};
 
-  if (line < 0 || line >= this->picture.height())
-    return;
+    SuWidgetsRecorder::record(
+          this,
+          SUWIDGETS_TRACE_TV_LINE,
+          data,
+          static_cast<quint64>(size) * sizeof(SUFLOAT),
+          args,
+          3);
+  }
 
   if (size > this->picture.width())
     size = this->picture.width();
@@ -118,8 +190,51 @@ TVDisplay::putLine(int line, const SUFLOAT *data, int size)
 
   for (i = size; i < this->picture.width(); ++i)
     scanLine[i] = this->colors[0];
+}
+
+void
+TVDisplay::markLines(int first, int last)
+{
+  if (this->dirtyFirst < 0) {
+    this->dirtyFirst = first;
+    this->dirtyLast  = last;
+  } else {
+    this->dirtyFirst = qMin(this->dirtyFirst, first);
+    this->dirtyLast  = qMax(this->dirtyLast, last);
+  }
+}
+
+void
+TVDisplay::putLine(int line, const SUFLOAT *data, int size)
+{
+  this->putLines(line, data, size, 1);
+}
+
+void
+TVDisplay::putLines(int line, const SUFLOAT *data, int size, int count)
+{
+  int i;
+
+  if (!this->havePicGeometry() || size < 0)
+    return;
+
+  // Skip the lines above the picture
+  if (line < 0) {
+    data  -= static_cast<qint64>(line) * size;
+    count += line;
+    line   = 0;
+  }
 
-  this->dirty = true;
+  if (count > this->picture.height() - line)
+    count = this->picture.height() - line;
+
+  if (count <= 0)
+    return;
+
+  for (i = 0; i < count; ++i)
+    this->convertLine(line + i, data + static_cast<qint64>(i) * size, size);
+
+  this->markLines(line, line + count - 1);
 }
 
 void
@@ -134,6 +249,108 @@ TVDisplay::computeGammaLookupTable(void)
               SU_ASFLOAT(this->gammaExp));
 }
 
+void
+TVDisplay::configureScaling(void)
+{
+  int width  = this->geometry.width();
+  int height = this->geometry.height();
+
+  this->hResampler.configure(this->picture.width(), width);
+  this->vResampler.configure(this->picture.height(), height);
+
+  this->hScaled = QImage(width, this->picture.height(), QImage::Format_ARGB32);
+
+  if (this->contentPixmap.size() != this->geometry)
+    this->contentPixmap = QPixmap(this->geometry);
+}
+
+//
+// Picture rows [first, last] are resampled horizontally into hScaled,
+// and the display rows depending on them are resampled vertically from
+// hScaled (including the unchanged rows under the filter at the edges of
+// the band). Only that band of the pixmap is replaced.
+//
+void
+TVDisplay::rescaleLines(int first, int last)
+{
+  int width = this->geometry.width();
+  int taps  = this->hResampler.taps;
+  int top, bottom;
+  std::vector<float> acc(4 * static_cast<size_t>(width));
+  QImage band;
+
+  for (int j = first; j <= last; ++j) {
+    const QRgb *src = reinterpret_cast<const QRgb *>(this->picture.constScanLine(j));
+    QRgb *dst = reinterpret_cast<QRgb *>(this->hScaled.scanLine(j));
+
+    for (int i = 0; i < width; ++i) {
+      const QRgb  *p = src + this->hResampler.first[static_cast<size_t>(i)];
+      const float *w = this->hResampler.weights.data() + i * taps;
+      float r = 0, g = 0, b = 0, a = 0;
+
+      for (int k = 0; k < taps; ++k) {
+        if (w[k] > 0) {
+          r += w[k] * qRed(p[k]);
+          g += w[k] * qGreen(p[k]);
+          b += w[k] * qBlue(p[k]);
+          a += w[k] * qAlpha(p[k]);
+        }
+      }
+
+      dst[i] = qRgba(
+            static_cast<int>(r + .5f),
+            static_cast<int>(g + .5f),
+            static_cast<int>(b + .5f),
+            static_cast<int>(a + .5f));
+    }
+  }
+
+  top    = this->vResampler.outFirst[static_cast<size_t>(first)];
+  bottom = this->vResampler.outLast[static_cast<size_t>(last)];
+
+  if (top > bottom)
+    return;
+
+  band = QImage(width, bottom - top + 1, QImage::Format_ARGB32);
+  taps = this->vResampler.taps;
+
+  for (int j = top; j <= bottom; ++j) {
+    int row = this->vResampler.first[static_cast<size_t>(j)];
+    const float *w = this->vResampler.weights.data() + j * taps;
+    QRgb *dst = reinterpret_cast<QRgb *>(band.scanLine(j - top));
+
+    std::fill(acc.begin(), acc.end(), 0.f);
+
+    // Row by row, so that the inner loop runs along contiguous pixels
+    for (int k = 0; k < taps; ++k) {
+      const QRgb *src;
+
+      if (w[k] <= 0)
+        continue;
+
+      src = reinterpret_cast<const QRgb *>(this->hScaled.constScanLine(row + k));
+
+      for (int i = 0; i < width; ++i) {
+        acc[4 * i]     += w[k] * qRed(src[i]);
+        acc[4 * i + 1] += w[k] * qGreen(src[i]);
+        acc[4 * i + 2] += w[k] * qBlue(src[i]);
+        acc[4 * i + 3] += w[k] * qAlpha(src[i]);
+      }
+    }
+
+    for (int i = 0; i < width; ++i)
+      dst[i] = qRgba(
+            static_cast<int>(acc[4 * i] + .5f),
+            static_cast<int>(acc[4 * i + 1] + .5f),
+            static_cast<int>(acc[4 * i + 2] + .5f),
+            static_cast<int>(acc[4 * i + 3] + .5f));
+  }
+
+  QPainter painter(&this->contentPixmap);
+  painter.setCompositionMode(QPainter::CompositionMode_Source);
+  painter.drawImage(0, top, band);
+}
+
 void
 TVDisplay::draw(void)
 {
@@ -150,15 +367,18 @@ TVDisplay::draw(void)
       if (this->contentPixmap.size() != this->geometry)
         this->contentPixmap = QPixmap(this->geometry);
       this->contentPixmap.fill(this->background);
+      this->dirtyFirst = this->dirtyLast = -1;
     } else {
-      this->contentPixmap =
-        QPixmap::fromImage(this->picture).scaled(
-          this->width(),
-            this->height(),
-            Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+      this->configureScaling();
+      this->markLines(0, this->picture.height() - 1);
     }
     this->dirty = false;
   }
+
+  if (this->dirtyFirst >= 0) {
+    this->rescaleLines(this->dirtyFirst, this->dirtyLast);
+    this->dirtyFirst = this->dirtyLast = -1;
+  }
 }
 
 QSize
@@ -246,6 +466,34 @@ TVDisplay::setAccumulate(bool accum)
   this->mAcummulate = accum;
 }
 
+void
+TVDisplay::memoryUsage(SuWidgetsMemoryUsage &usage) const
+{
+  usage[SUWIDGETS_MEMORY_ACCUMULATORS] +=
+      static_cast<quint64>(this->mAccumBuffer.capacity()) * sizeof(SUFLOAT);
+  usage[SUWIDGETS_MEMORY_IMAGES] +=
+        SuWidgetsMemory::imageBytes(this->picture)
+      + SuWidgetsMemory::imageBytes(this->hScaled)
+      + SuWidgetsMemory::pixmapBytes(this->contentPixmap);
+}
+
+// Accumulation is turned off and its buffer released
+quint64
+TVDisplay::reclaimMemory(SuWidgetsMemoryCategory category, quint64)
+{
+  quint64 before =
+      static_cast<quint64>(this->mAccumBuffer.capacity()) * sizeof(SUFLOAT);
+
+  if (category != SUWIDGETS_MEMORY_ACCUMULATORS)
+    return 0;
+
+  this->setAccumulate(false);
+  this->mAccumBuffer.clear();
+  this->mAccumBuffer.squeeze();
+
+  return before;
+}
+
 void
 TVDisplay::setEnableSPLPF(bool value)
 {
@@ -27,6 +27,7 @@
 #include <tgmath.h>
 #include <sigutils/types.h>
 #include "ThrottleableWidget.h"
+#include "SuWidgetsMemory.h"
 
 #define TVDISPLAY_DEFAULT_BACKGROUND_COLOR QColor(0,     0,   0)
 #define TVDISPLAY_DEFAULT_FOREGROUND_COLOR QColor(255, 255, 255)
@@ -34,7 +35,25 @@
 
 struct sigutils_tv_frame_buffer;
 
-class TVDisplay : public ThrottleableWidget
+//
+// 1-D resampling with a tent filter, whose radius is one source sample
+// when upscaling (linear interpolation) and one output sample when
+// downscaling (so that every source sample contributes). Every output
+// sample has `taps` weights starting at source sample first[i]. The
+// output samples depending on source sample j are outFirst[j] to
+// outLast[j].
+//
+struct TVDisplayResampler {
+  int taps = 0;
+  std::vector<int>   first;
+  std::vector<float> weights;
+  std::vector<int>   outFirst;
+  std::vector<int>   outLast;
+
+  void configure(int from, int to);
+};
+
+class TVDisplay : public ThrottleableWidget, public SuWidgetsMemoryClient
 {
   Q_OBJECT
 
@@ -55,6 +74,15 @@ class TVDisplay : public ThrottleableWidget
   QPixmap contentPixmap;
   QImage  picture;
 
+  // Picture rows resampled to the display width, and the resamplers that
+  // map the picture to the display. Only the display rows depending on
+  // the picture rows in [dirtyFirst, dirtyLast] are redrawn.
+  QImage  hScaled;
+  TVDisplayResampler hResampler;
+  TVDisplayResampler vResampler;
+  int dirtyFirst = -1;
+  int dirtyLast  = -1;
+
   QVector<SUFLOAT> mAccumBuffer;
   qint64 mAcumCount = 0;
   SUFLOAT mAccumAlpha = 0;
@@ -88,6 +116,10 @@ class TVDisplay : public ThrottleableWidget
 
   void computeGammaLookupTable(void);
   void paintPicture(QPainter &, QPixmap const &);
+  void convertLine(int line, const SUFLOAT *data, int size);
+  void markLines(int first, int last);
+  void configureScaling(void);
+  void rescaleLines(int first, int last);
 
 public:
   void
@@ -257,6 +289,9 @@ public:
   void setAccumAlpha(SUFLOAT);
   void setPicGeometry(int width, int height);
   void putLine(int line, const SUFLOAT *data, int size);
+
+  // Puts `count` lines of `size` samples each, starting at `line`
+  void putLines(int line, const SUFLOAT *data, int size, int count);
   void putFrame(const sigutils_tv_frame_buffer *);
   void draw(void);
   void paint(void);
@@ -265,6 +300,9 @@ public:
 
   TVDisplay(QWidget *parent = nullptr);
 
+  void memoryUsage(SuWidgetsMemoryUsage &) const override;
+  quint64 reclaimMemory(SuWidgetsMemoryCategory, quint64) override;
+
 signals:
   void backgroundColorChanged();
   void foregroundColorChanged();
@@ -19,6 +19,7 @@
 
 
 #include "ThrottleableWidget.h"
+#include "SuWidgetsHelpers.h"
 #include <cmath>
 
 ThrottleControl::ThrottleControl(unsigned int rate)
@@ -62,7 +63,14 @@ ThrottleControl::onTimerTimeout(void)
 
 ThrottleableWidget::ThrottleableWidget(QWidget *parent) : QFrame(parent)
 {
+  this->interactionTimer.setSingleShot(true);
+  this->interactionTimer.setInterval(SUWIDGETS_DEFAULT_INTERACTION_IDLE_MS);
 
+  this->connect(
+        &this->interactionTimer,
+        SIGNAL(timeout()),
+        this,
+        SLOT(onInteractionTimeout()));
 }
 
 void
@@ -103,11 +111,31 @@ ThrottleableWidget::setThrottleControl(ThrottleControl *control)
     this->update();
 }
 
+void
+ThrottleableWidget::beginInteraction(void)
+{
+  this->interacting = true;
+  this->interactionTimer.start();
+}
+
+void
+ThrottleableWidget::setInteractionIdleTime(int ms)
+{
+  this->interactionTimer.setInterval(ms);
+}
+
+void
+ThrottleableWidget::interactionFinished(void)
+{
+  // Nothing degraded by default
+}
+
 void
 ThrottleableWidget::paintEvent(QPaintEvent *)
 {
-  // Throttle disabled. Leverage paintEvent to draw pending stuff
-  if (!this->throttle && this->dirty) {
+  // Throttle disabled (or the user is waiting for us). Leverage
+  // paintEvent to draw pending stuff
+  if ((!this->throttle || this->interacting) && this->dirty) {
     this->draw();
     this->dirty = false;
   }
@@ -118,8 +146,9 @@ ThrottleableWidget::paintEvent(QPaintEvent *)
 void
 ThrottleableWidget::resizeEvent(QResizeEvent *)
 {
+  // Resize events coalesce into the next paintEvent, which draws once
   this->dirty = true;
-  this->draw();
+  this->beginInteraction();
   this->update();
 }
 
@@ -147,3 +176,10 @@ ThrottleableWidget::onCpuBurnSet(bool state)
   this->throttle = !state;
 }
 
+void
+ThrottleableWidget::onInteractionTimeout(void)
+{
+  this->interacting = false;
+  this->interactionFinished();
+}
+
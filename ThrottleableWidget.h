@@ -80,9 +80,11 @@ class ThrottleableWidget : public QFrame
     Q_OBJECT
 
     ThrottleControl *control = nullptr; // Weak
+    QTimer interactionTimer;
     bool throttle = false;
     bool dirty = false;
-    bool pad[6];
+    bool interacting = false;
+    bool pad[5];
 
   public:
     explicit ThrottleableWidget(QWidget *parent = nullptr);
@@ -92,6 +94,23 @@ class ThrottleableWidget : public QFrame
     virtual void draw(void) = 0;
     virtual void paint(void) = 0;
 
+    //
+    // Interaction mode. While the user resizes, pans or zooms the widget,
+    // draw() may check isInteracting() and trade quality for speed. Once
+    // input has been idle for the idle time, interactionFinished() is
+    // called. Widgets that drew a degraded frame override it to redraw at
+    // full quality; the default does nothing.
+    //
+    void beginInteraction(void);
+    void setInteractionIdleTime(int ms);
+    virtual void interactionFinished(void);
+
+    bool
+    isInteracting(void) const
+    {
+      return this->interacting;
+    }
+
     void paintEvent(QPaintEvent *ev);
     void resizeEvent(QResizeEvent *ev);
 
@@ -100,6 +119,7 @@ class ThrottleableWidget : public QFrame
   public slots:
     void onCpuBurnSet(bool);
     void onTick(void);
+    void onInteractionTimeout(void);
 };
 
 #endif // THROTTLEABLEWIDGET_H
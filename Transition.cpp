@@ -20,7 +20,6 @@
 #include "Transition.h"
 
 #include <QPainter>
-#include <assert.h>
 
 #define CROSS_MARK_REL_DIM .1f
 
@@ -74,7 +73,7 @@ Transition::recalculateDisplayData(void)
 void
 Transition::drawAxes(void)
 {
-  QPainter painter(&this->axesPixmap);
+  QPainter painter(&this->layers.beginAxes());
   QPen pen(this->axes);
 
   painter.fillRect(0, 0, this->width, this->height, this->background);
@@ -106,74 +105,76 @@ Transition::drawAxes(void)
     }
 
   }
-
-  this->axesDrawn = true;
 }
 
 void
-Transition::drawTransition(void)
+Transition::recalculateStatePoints(void)
 {
-  if (this->amount > 1) {
-    QPainter painter(&this->contentPixmap);
-    QColor fg = this->foreground;
-    Symbol old, current;
-    unsigned int p = 0;
-    unsigned int q;
-    unsigned int states = 1 << this->bits;
-    unsigned int transMtxLen = states * states;
-    unsigned int max = 0;
-    unsigned long size = this->history.size();
-    unsigned int times;
-    SUCOMPLEX c1, c2, step, omega;
-    float alphaK;
+  unsigned int bits = this->bits < 8 ? this->bits : 8;
+  unsigned int states = 1 << bits;
+  SUCOMPLEX c, step, omega;
 
-    // Yay more Cobol
-    step = SU_I * static_cast<SUCOMPLEX>(M_PI) / static_cast<SUFLOAT>(states);
-    omega = 2.f * step;
+  // Yay more Cobol
+  step = SU_I * static_cast<SUCOMPLEX>(M_PI) / static_cast<SUFLOAT>(states);
+  omega = 2.f * step;
 
-    if (transMtxLen != this->transMtx.size())
-      this->transMtx.resize(transMtxLen);
+  this->statePoints.resize(states);
 
-    std::fill(this->transMtx.begin(), this->transMtx.end(), 0);
-
-    q = this->ptr;
+  for (unsigned int i = 0; i < states; ++i) {
+    c = SU_C_EXP(static_cast<SUFLOAT>(i) * omega + step);
+    this->statePoints[i] = this->floatToScreenPoint(SU_C_REAL(c), SU_C_IMAG(c));
+  }
+}
 
-    assert(this->amount <= size);
+void
+Transition::drawTransition(void)
+{
+  QImage &data = this->layers.beginData();
 
-    // Compose transition matrix
-    assert(q < size);
-    old = this->history[q++];
-    while (++p < this->amount) {
-      if (q == size)
-        q = 0;
+  if (this->amount > 1) {
+    QPainter painter(&data);
+    QColor fg = this->foreground;
+    unsigned int states = static_cast<unsigned int>(this->statePoints.size());
+    unsigned int max = 0;
+    unsigned int times, bucket;
 
-      assert(q < size);
-      current = this->history[q++];
+    for (unsigned int j = 0; j < states; ++j)
+      for (unsigned int i = 0; i < states; ++i) {
+        times = this->transMtx[TRANSITION_MTX_INDEX(j, i)];
+        if (times > max)
+          max = times;
+      }
 
-      times = ++this->transMtx[current + old * states];
-      if (times > max)
-        max = times;
+    if (max == 0)
+      return;
 
-      old = current;
-    }
+    // Group edges by alpha, so every bucket is a single drawLines call
+    for (auto &lines : this->edgeBuckets)
+      lines.clear();
 
-    // Draw transitions
-    painter.setPen(Qt::RoundCap);
     for (unsigned int j = 0; j < states; ++j) {
-      c2 = SU_C_EXP(static_cast<SUFLOAT>(j) * omega + step);
       for (unsigned int i = 0; i < states; ++i) {
-        times = this->transMtx[i + j * states];
-        alphaK = 255.f * times / static_cast<float>(max);
-        c1 = SU_C_EXP(static_cast<SUFLOAT>(i) * omega + step);
-
-        fg.setAlpha(static_cast<int>(alphaK));
-        painter.setPen(fg);
-        painter.drawLine(
-              this->floatToScreenPoint(SU_C_REAL(c1), SU_C_IMAG(c1)),
-              this->floatToScreenPoint(SU_C_REAL(c2), SU_C_IMAG(c2)));
+        times  = this->transMtx[TRANSITION_MTX_INDEX(j, i)];
+        bucket = static_cast<unsigned int>(
+              static_cast<quint64>(times) * (TRANSITION_ALPHA_BUCKETS - 1) / max);
+
+        if (bucket > 0)
+          this->edgeBuckets[bucket].push_back(
+                QLine(this->statePoints[i], this->statePoints[j]));
       }
     }
 
+    // Draw transitions
+    for (unsigned int b = 1; b < TRANSITION_ALPHA_BUCKETS; ++b) {
+      auto const &lines = this->edgeBuckets[b];
+
+      if (lines.empty())
+        continue;
+
+      fg.setAlpha(static_cast<int>(255 * b / (TRANSITION_ALPHA_BUCKETS - 1)));
+      painter.setPen(fg);
+      painter.drawLines(lines.data(), static_cast<int>(lines.size()));
+    }
   }
 }
 
@@ -187,24 +188,17 @@ Transition::draw(void)
   if (this->geometry != this->size()) {
     this->geometry = this->size();
     this->haveGeometry = true;
-    this->contentPixmap  = QPixmap(this->geometry.width(), this->geometry.height());
-    this->axesPixmap = QPixmap(this->geometry.width(), this->geometry.height());
-    this->axesDrawn = false;
+    this->layers.resize(this->geometry);
   }
 
-  if (!this->axesDrawn) {
+  if (!this->layers.axesValid()) {
     this->recalculateDisplayData();
+    this->recalculateStatePoints();
     this->drawAxes();
     emit this->axesUpdated();
   }
 
-  /* Dump to content pixmap */
-  this->contentPixmap = this->axesPixmap.copy(
-        0,
-        0,
-        this->geometry.width(),
-        this->geometry.height());
-
+  /* Axes are composed with the transitions in paint() */
   this->drawTransition();
 }
 
@@ -213,7 +207,7 @@ void
 Transition::paint(void)
 {
   QPainter painter(this);
-  painter.drawPixmap(0, 0, this->contentPixmap);
+  this->layers.compose(painter);
 }
 
 void
@@ -222,55 +216,61 @@ Transition::setHistorySize(unsigned int length)
   this->history.resize(length);
   this->amount = 0;
   this->ptr = 0;
+
+  std::fill(this->transMtx.begin(), this->transMtx.end(), 0);
 }
 
 void
 Transition::feed(const Symbol *samples, unsigned int length)
 {
-  unsigned int p = 0;
   unsigned int size = static_cast<unsigned int>(this->history.size());
-  unsigned int chunk;
+  unsigned int prev, next;
 
-  if (length > size) {
-    p = length - size;
-    length = size;
-  }
+  if (size == 0)
+    return;
 
-  while (length > 0) {
-    chunk = size - this->ptr;
-    if (chunk > length)
-      chunk = length;
+  // Everything in history would be evicted by this call. Start over.
+  if (length >= size) {
+    samples += length - size;
+    length   = size;
 
-    memcpy(
-          &this->history[this->ptr],
-        &samples[p],
-        chunk * sizeof(Symbol));
+    this->amount = 0;
+    this->ptr    = 0;
+    std::fill(this->transMtx.begin(), this->transMtx.end(), 0);
+  }
 
-    p         += chunk;
-    length    -= chunk;
-    this->ptr += chunk;
+  for (unsigned int p = 0; p < length; ++p) {
+    if (this->amount == size) {
+      // The oldest transition leaves the window
+      if (size > 1) {
+        next = this->ptr + 1 == size ? 0 : this->ptr + 1;
+        --this->transMtx[
+            TRANSITION_MTX_INDEX(this->history[this->ptr], this->history[next])];
+      }
+    } else {
+      ++this->amount;
+    }
 
-    if (this->amount < size) {
-      this->amount += chunk;
-      if (this->amount > size)
-        this->amount = size;
+    if (this->amount > 1) {
+      prev = this->ptr == 0 ? size - 1 : this->ptr - 1;
+      ++this->transMtx[
+          TRANSITION_MTX_INDEX(this->history[prev], samples[p])];
     }
 
-    if (this->ptr == size)
+    this->history[this->ptr] = samples[p];
+
+    if (++this->ptr == size)
       this->ptr = 0;
   }
 
-  assert(this->ptr < size);
   this->invalidate();
 }
 
 Transition::Transition(QWidget *parent) :
   ThrottleableWidget(parent)
 {
-  this->contentPixmap = QPixmap(0, 0);
-  this->axesPixmap = QPixmap(0, 0);
-
   this->history.resize(TRANSITION_DEFAULT_HISTORY_SIZE);
+  this->transMtx.resize(TRANSITION_MAX_STATES * TRANSITION_MAX_STATES);
 
   this->background = TRANSITION_DEFAULT_BACKGROUND_COLOR;
   this->foreground = TRANSITION_DEFAULT_FOREGROUND_COLOR;
@@ -27,12 +27,18 @@
 #include <tgmath.h>
 #include "ThrottleableWidget.h"
 #include "Decider.h"
+#include "LayeredCompositor.h"
 
 #define TRANSITION_DEFAULT_BACKGROUND_COLOR QColor(0,     0,   0)
 #define TRANSITION_DEFAULT_FOREGROUND_COLOR QColor(255, 255, 255)
 #define TRANSITION_DEFAULT_AXES_COLOR       QColor(128, 128, 128)
 
 #define TRANSITION_DEFAULT_HISTORY_SIZE 256
+#define TRANSITION_MAX_STATES           256 // Symbols are 8 bits wide
+#define TRANSITION_ALPHA_BUCKETS        64
+
+#define TRANSITION_MTX_INDEX(prev, curr) \
+  ((static_cast<unsigned int>(prev) << 8) | static_cast<unsigned int>(curr))
 
 class Transition : public ThrottleableWidget
 {
@@ -65,14 +71,16 @@ class Transition : public ThrottleableWidget
 
 
   // Drawing area properties
-  QPixmap contentPixmap;
-  QPixmap axesPixmap;
+  LayeredCompositor layers;
 
   QSize geometry;
 
 
   // Data
   std::vector<Symbol> history;
+
+  // Transition counts of the symbols in history, updated as they are fed.
+  // Indexed by TRANSITION_MTX_INDEX(prev, curr).
   std::vector<unsigned int> transMtx;
 
   unsigned int amount = 0;
@@ -85,18 +93,20 @@ class Transition : public ThrottleableWidget
   float zoom = .5f;
   unsigned int bits = 2;
   bool haveGeometry = false;
-  bool axesDrawn = false;
 
   // Cached data
   int ox;
   int oy;
   int width;
   int height;
+  std::vector<QPoint> statePoints;
+  std::vector<QLine>  edgeBuckets[TRANSITION_ALPHA_BUCKETS];
 
   // Private methods
   QPoint floatToScreenPoint(float x, float y);
 
   void recalculateDisplayData(void);
+  void recalculateStatePoints(void);
 
   void drawMarkerAt(QPainter &curr, float x, float y);
   void drawAxes(void);
@@ -107,7 +117,7 @@ public:
   setBackgroundColor(const QColor &c)
   {
     this->background = c;
-    this->axesDrawn = false;
+    this->layers.invalidateAxes();
     this->invalidate();
     emit backgroundColorChanged();
   }
@@ -122,7 +132,7 @@ public:
   setAxesColor(const QColor &c)
   {
     this->axes = c;
-    this->axesDrawn = false;
+    this->layers.invalidateAxes();
     this->invalidate();
     emit axesColorChanged();
   }
@@ -137,7 +147,7 @@ public:
   setForegroundColor(const QColor &c)
   {
     this->foreground = c;
-    this->axesDrawn = false;
+    this->layers.invalidateAxes();
     this->invalidate();
     emit foregroundColorChanged();
   }
@@ -153,7 +163,7 @@ public:
   {
     if (this->bits != bits) {
       this->bits = bits;
-      this->axesDrawn = false;
+      this->layers.invalidateAxes();
       this->invalidate();
       emit orderHintChanged();
     }
@@ -18,8 +18,14 @@
 //
 
 #include "WFHelpers.h"
+#include <QFile>
+#include <QtEndian>
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
 
 #ifdef _MSC_VER
 #include <Windows.h>
@@ -300,10 +306,35 @@ FrequencyAllocationTable::FrequencyAllocationTable(std::string const &name)
   this->name = name;
 }
 
+// The index refers to the bands of the table it was built for. Copies
+// must build their own.
+FrequencyAllocationTable::FrequencyAllocationTable(
+    FrequencyAllocationTable const &other)
+  : name(other.name),
+    allocation(other.allocation),
+    mapped(other.mapped)
+{
+}
+
+FrequencyAllocationTable &
+FrequencyAllocationTable::operator=(FrequencyAllocationTable const &other)
+{
+  if (this != &other) {
+    this->name       = other.name;
+    this->allocation = other.allocation;
+    this->mapped     = other.mapped;
+    this->index.clear();
+    this->indexValid = false;
+  }
+
+  return *this;
+}
+
 void
 FrequencyAllocationTable::pushBand(FrequencyBand const &band)
 {
   this->allocation[band.min] = band;
+  this->indexValid = false;
 }
 
 void
@@ -353,6 +384,288 @@ FrequencyAllocationTable::find(qint64 freq) const
   return lower;
 }
 
+size_t
+FrequencyAllocationTable::size() const
+{
+  if (!this->indexValid)
+    this->rebuildIndex();
+
+  return this->index.size();
+}
+
+static_assert(sizeof(FATBinaryHeader) == 24, "Unexpected FAT header size");
+static_assert(sizeof(FATBinaryRecord) == 32, "Unexpected FAT record size");
+
+struct FATMappedFile {
+  QFile                  file;
+  const uchar           *data = nullptr;
+  const FATBinaryRecord *records = nullptr;
+  const char            *strings = nullptr;
+  quint32                bandCount = 0;
+  quint32                stringTableSize = 0;
+
+  const char *
+  string(quint32 offset) const
+  {
+    return offset < stringTableSize ? strings + offset : "";
+  }
+
+  ~FATMappedFile()
+  {
+    if (data != nullptr)
+      file.unmap(const_cast<uchar *>(data));
+  }
+};
+
+qint64
+FrequencyAllocationTable::buildIndexNode(size_t lo, size_t hi) const
+{
+  if (lo >= hi)
+    return std::numeric_limits<qint64>::min();
+
+  size_t mid = (lo + hi) / 2;
+  qint64 max = this->index[mid].max;
+
+  max = std::max(max, this->buildIndexNode(lo, mid));
+  max = std::max(max, this->buildIndexNode(mid + 1, hi));
+
+  this->index[mid].subtreeMax = max;
+
+  return max;
+}
+
+void
+FrequencyAllocationTable::rebuildIndex() const
+{
+  FrequencyBandIndexEntry entry;
+  bool sorted = true;
+
+  this->index.clear();
+
+  if (this->mapped) {
+    this->index.reserve(this->mapped->bandCount + this->allocation.size());
+
+    for (quint32 i = 0; i < this->mapped->bandCount; ++i) {
+      const FATBinaryRecord *record = this->mapped->records + i;
+      entry.min    = qFromLittleEndian(record->min);
+      entry.max    = qFromLittleEndian(record->max);
+      entry.band   = nullptr;
+      entry.record = record;
+      this->index.push_back(entry);
+    }
+  }
+
+  for (auto &p : this->allocation) {
+    entry.min    = p.second.min;
+    entry.max    = p.second.max;
+    entry.band   = &p.second;
+    entry.record = nullptr;
+    this->index.push_back(entry);
+  }
+
+  for (size_t i = 1; i < this->index.size() && sorted; ++i)
+    sorted = this->index[i - 1].min <= this->index[i].min;
+
+  // Mapped files are sorted already. Only mixed tables need this.
+  if (!sorted)
+    std::stable_sort(
+          this->index.begin(),
+          this->index.end(),
+          [] (FrequencyBandIndexEntry const &a, FrequencyBandIndexEntry const &b) {
+      return a.min < b.min;
+    });
+
+  this->buildIndexNode(0, this->index.size());
+  this->indexValid = true;
+}
+
+void
+FrequencyAllocationTable::materialize(
+    FrequencyBandIndexEntry const &entry,
+    FrequencyBand &band) const
+{
+  if (entry.band != nullptr) {
+    band = *entry.band;
+  } else {
+    const FATBinaryRecord *record = entry.record;
+
+    band.min       = entry.min;
+    band.max       = entry.max;
+    band.primary   = this->mapped->string(qFromLittleEndian(record->primary));
+    band.secondary = this->mapped->string(qFromLittleEndian(record->secondary));
+    band.footnotes = this->mapped->string(qFromLittleEndian(record->footnotes));
+    band.color     = QColor::fromRgba(qFromLittleEndian(record->color));
+  }
+}
+
+void
+FrequencyAllocationTable::queryIndex(
+    size_t lo,
+    size_t hi,
+    qint64 from,
+    qint64 to,
+    std::vector<FrequencyBand> &out) const
+{
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    FrequencyBandIndexEntry const &entry = this->index[mid];
+
+    // Nothing in this subtree reaches the requested range
+    if (entry.subtreeMax <= from)
+      return;
+
+    this->queryIndex(lo, mid, from, to, out);
+
+    // This band and everything to its right starts after the range
+    if (entry.min >= to)
+      return;
+
+    if (entry.max > from) {
+      out.resize(out.size() + 1);
+      this->materialize(entry, out.back());
+    }
+
+    lo = mid + 1;
+  }
+}
+
+// Find all bands overlapping [from, to), sorted by their lower frequency.
+// Strings and colors are only materialized for the bands that are found.
+void
+FrequencyAllocationTable::findBands(
+    qint64 from,
+    qint64 to,
+    std::vector<FrequencyBand> &out) const
+{
+  out.clear();
+
+  if (!this->indexValid)
+    this->rebuildIndex();
+
+  this->queryIndex(0, this->index.size(), from, to, out);
+}
+
+bool
+FrequencyAllocationTable::loadBinary(std::string const &path)
+{
+  auto mapped = std::make_shared<FATMappedFile>();
+  const FATBinaryHeader *header;
+  qint64 size;
+  qint64 expected;
+
+  mapped->file.setFileName(QString::fromStdString(path));
+
+  if (!mapped->file.open(QIODevice::ReadOnly))
+    return false;
+
+  size = mapped->file.size();
+  if (size < static_cast<qint64>(sizeof(FATBinaryHeader)))
+    return false;
+
+  mapped->data = mapped->file.map(0, size);
+  if (mapped->data == nullptr)
+    return false;
+
+  header = reinterpret_cast<const FATBinaryHeader *>(mapped->data);
+
+  if (memcmp(header->magic, FAT_BINARY_MAGIC, sizeof(header->magic)) != 0
+      || qFromLittleEndian(header->version) != FAT_BINARY_VERSION)
+    return false;
+
+  mapped->bandCount       = qFromLittleEndian(header->bandCount);
+  mapped->stringTableSize = qFromLittleEndian(header->stringTableSize);
+
+  expected = static_cast<qint64>(sizeof(FATBinaryHeader))
+      + static_cast<qint64>(mapped->bandCount) * sizeof(FATBinaryRecord)
+      + mapped->stringTableSize;
+
+  if (size < expected)
+    return false;
+
+  mapped->records = reinterpret_cast<const FATBinaryRecord *>(
+        mapped->data + sizeof(FATBinaryHeader));
+  mapped->strings = reinterpret_cast<const char *>(
+        mapped->records + mapped->bandCount);
+
+  // The string table must be terminated, or string() may run past it
+  if (mapped->stringTableSize > 0
+      && mapped->strings[mapped->stringTableSize - 1] != '\0')
+    return false;
+
+  this->mapped = mapped;
+  this->name   = mapped->string(qFromLittleEndian(header->name));
+  this->indexValid = false;
+
+  return true;
+}
+
+bool
+FrequencyAllocationTable::saveBinary(std::string const &path) const
+{
+  std::unordered_map<std::string, quint32> interned;
+  std::string strings;
+  std::vector<FATBinaryRecord> records;
+  std::vector<FrequencyBand> bands;
+  FATBinaryHeader header;
+  QFile file(QString::fromStdString(path));
+
+  auto intern = [&] (std::string const &str) -> quint32 {
+    auto it = interned.find(str);
+    if (it != interned.end())
+      return it->second;
+
+    quint32 offset = static_cast<quint32>(strings.size());
+    strings.append(str);
+    strings.push_back('\0');
+    interned[str] = offset;
+    return offset;
+  };
+
+  this->findBands(
+        std::numeric_limits<qint64>::min(),
+        std::numeric_limits<qint64>::max(),
+        bands);
+
+  memcpy(header.magic, FAT_BINARY_MAGIC, sizeof(header.magic));
+  header.version   = qToLittleEndian<quint32>(FAT_BINARY_VERSION);
+  header.bandCount = qToLittleEndian<quint32>(static_cast<quint32>(bands.size()));
+  header.name      = qToLittleEndian(intern(this->name));
+
+  records.resize(bands.size());
+  for (size_t i = 0; i < bands.size(); ++i) {
+    records[i].min       = qToLittleEndian(bands[i].min);
+    records[i].max       = qToLittleEndian(bands[i].max);
+    records[i].primary   = qToLittleEndian(intern(bands[i].primary));
+    records[i].secondary = qToLittleEndian(intern(bands[i].secondary));
+    records[i].footnotes = qToLittleEndian(intern(bands[i].footnotes));
+    records[i].color     = qToLittleEndian<quint32>(bands[i].color.rgba());
+  }
+
+  header.stringTableSize =
+      qToLittleEndian<quint32>(static_cast<quint32>(strings.size()));
+
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    return false;
+
+  if (file.write(reinterpret_cast<const char *>(&header), sizeof(header))
+      != sizeof(header))
+    return false;
+
+  if (!records.empty()) {
+    qint64 len = static_cast<qint64>(records.size() * sizeof(FATBinaryRecord));
+    if (file.write(reinterpret_cast<const char *>(records.data()), len) != len)
+      return false;
+  }
+
+  if (!strings.empty()) {
+    qint64 len = static_cast<qint64>(strings.size());
+    if (file.write(strings.data(), len) != len)
+      return false;
+  }
+
+  return true;
+}
+
 //////////////////////////// NamedChannelSet ///////////////////////////////////
 NamedChannelSetIterator
 NamedChannelSet::addChannel(
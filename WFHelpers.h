@@ -26,6 +26,8 @@
 #include <QString>
 #include <QColor>
 #include <map>
+#include <memory>
+#include <vector>
 #include <QPainter>
 
 #define CUR_CUT_DELTA 5		//cursor capture delta in pixels
@@ -33,6 +35,11 @@
 #define FFT_MIN_DB     -160.f
 #define FFT_MAX_DB      40.f
 
+// Auto-range: margins around the estimated levels, and minimum change
+#define WF_AUTO_RANGE_FLOOR_MARGIN_DB   10.f
+#define WF_AUTO_RANGE_PEAK_MARGIN_DB    10.f
+#define WF_AUTO_RANGE_HYSTERESIS_DB     3.f
+
 // Colors of type QRgb in 0xAARRGGBB format (unsigned int)
 #define PLOTTER_BGD_COLOR           0xFF1F1D1D
 #define PLOTTER_GRID_COLOR          0xFF444242
@@ -97,13 +104,76 @@ struct TimeStamp {
 
 typedef std::map<qint64, FrequencyBand>::const_iterator FrequencyBandIterator;
 
+//
+// Compact on-disk FAT format. All integers are little endian. The file
+// starts with a header, followed by the band records (sorted by their
+// lower frequency) and a table of NUL-terminated UTF-8 strings. Strings
+// are interned: records refer to them by their offset in the table.
+//
+#define FAT_BINARY_MAGIC   "SUFATBIN"
+#define FAT_BINARY_VERSION 1
+
+struct FATBinaryHeader {
+  char    magic[8];
+  quint32 version;
+  quint32 bandCount;
+  quint32 stringTableSize;
+  quint32 name;           // Offset of the table name
+};
+
+struct FATBinaryRecord {
+  qint64  min;
+  qint64  max;
+  quint32 primary;        // Offsets in the string table
+  quint32 secondary;
+  quint32 footnotes;
+  quint32 color;          // 0xAARRGGBB
+};
+
+struct FATMappedFile;
+
+//
+// Bands are indexed by an implicit interval tree built over the bands
+// sorted by their lower frequency. Every node keeps the maximum upper
+// frequency of its subtree, which lets findBands() skip the subtrees
+// that end before the requested range.
+//
+struct FrequencyBandIndexEntry {
+  qint64                 min;
+  qint64                 max;
+  qint64                 subtreeMax;
+  const FrequencyBand   *band;    // In-memory band, or
+  const FATBinaryRecord *record;  // record in a mapped file
+};
+
 class FrequencyAllocationTable {
   std::string name;
   std::map<qint64, FrequencyBand> allocation;
 
+  // Mapped binary table (shared between copies)
+  std::shared_ptr<FATMappedFile> mapped;
+
+  // Interval index, rebuilt lazily after modifications
+  mutable std::vector<FrequencyBandIndexEntry> index;
+  mutable bool indexValid = false;
+
+  void rebuildIndex() const;
+  qint64 buildIndexNode(size_t lo, size_t hi) const;
+  void queryIndex(
+      size_t lo,
+      size_t hi,
+      qint64 from,
+      qint64 to,
+      std::vector<FrequencyBand> &out) const;
+  void materialize(
+      FrequencyBandIndexEntry const &,
+      FrequencyBand &) const;
+
 public:
   FrequencyAllocationTable();
   FrequencyAllocationTable(std::string const &name);
+  FrequencyAllocationTable(FrequencyAllocationTable const &);
+  FrequencyAllocationTable &operator=(FrequencyAllocationTable const &);
 
   void
   setName(std::string const &name)
@@ -123,6 +193,14 @@ public:
   FrequencyBandIterator cend(void) const;
 
   FrequencyBandIterator find(qint64 freq) const;
+
+  size_t size() const;
+  void findBands(qint64 from, qint64 to, std::vector<FrequencyBand> &out) const;
+
+  // Bands loaded from a binary file are kept in the mapped file and are
+  // only reachable through findBands().
+  bool loadBinary(std::string const &path);
+  bool saveBinary(std::string const &path) const;
 };
 
 struct NamedChannel {
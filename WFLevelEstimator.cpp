@@ -0,0 +1,153 @@
+//
+//    WFLevelEstimator.cpp: Streaming noise floor and peak level estimator
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include "WFLevelEstimator.h"
+#include "SuWidgetsHelpers.h"
+#include "SuWidgetsKernels.h"
+#include <algorithm>
+
+#define WF_LEVEL_ESTIMATOR_BINS                               \
+  SCAST(size_t,                                               \
+    (WF_LEVEL_ESTIMATOR_MAX_DB - WF_LEVEL_ESTIMATOR_MIN_DB)   \
+    * WF_LEVEL_ESTIMATOR_BINS_PER_DB)
+
+WFLevelEstimator::WFLevelEstimator()
+{
+  m_frame.resize(WF_LEVEL_ESTIMATOR_BINS);
+  m_hist.resize(WF_LEVEL_ESTIMATOR_BINS);
+
+  setFrames(WF_LEVEL_ESTIMATOR_DEFAULT_FRAMES);
+}
+
+void
+WFLevelEstimator::setFrames(int frames)
+{
+  m_alpha = 1.f / SCAST(float, qMax(frames, 1));
+}
+
+void
+WFLevelEstimator::setQuantiles(float floor, float peak)
+{
+  m_floorQuantile = qBound(0.f, floor, 1.f);
+  m_peakQuantile  = qBound(0.f, peak, 1.f);
+  m_dirty         = m_count > 0;
+}
+
+void
+WFLevelEstimator::reset()
+{
+  std::fill(m_hist.begin(), m_hist.end(), 0.f);
+
+  m_floor = m_peak = WF_LEVEL_ESTIMATOR_MIN_DB;
+  m_count = 0;
+  m_dirty = false;
+}
+
+void
+WFLevelEstimator::feed(const float *data, int size)
+{
+  size_t bins = m_hist.size();
+  float alpha, k;
+
+  if (size <= 0)
+    return;
+
+  std::fill(m_frame.begin(), m_frame.end(), 0);
+
+  SuWidgetsKernels::histogram(
+        m_frame.data(),
+        SCAST(unsigned int, bins),
+        data,
+        WF_LEVEL_ESTIMATOR_MIN_DB,
+        WF_LEVEL_ESTIMATOR_BINS_PER_DB,
+        SCAST(SUSCOUNT, size));
+
+  // Until the memory fills up, all frames weigh the same. Frames are
+  // normalized, so that their size does not matter either.
+  alpha = qMax(m_alpha, 1.f / SCAST(float, m_count + 1));
+  k     = alpha / SCAST(float, size);
+
+  for (size_t i = 0; i < bins; ++i)
+    m_hist[i] += k * SCAST(float, m_frame[i]) - alpha * m_hist[i];
+
+  ++m_count;
+  m_dirty = true;
+}
+
+float
+WFLevelEstimator::quantile(float q, float total) const
+{
+  float target = q * total;
+  float acc = 0;
+  size_t bins = m_hist.size();
+
+  for (size_t i = 0; i < bins; ++i) {
+    float next = acc + m_hist[i];
+
+    if (next >= target && m_hist[i] > 0) {
+      float frac = (target - acc) / m_hist[i];
+      return WF_LEVEL_ESTIMATOR_MIN_DB
+          + (SCAST(float, i) + frac) / WF_LEVEL_ESTIMATOR_BINS_PER_DB;
+    }
+
+    acc = next;
+  }
+
+  return WF_LEVEL_ESTIMATOR_MAX_DB;
+}
+
+void
+WFLevelEstimator::update()
+{
+  float total = 0;
+
+  if (!m_dirty)
+    return;
+
+  for (auto p : m_hist)
+    total += p;
+
+  if (total > 0) {
+    m_floor = quantile(m_floorQuantile, total);
+    m_peak  = quantile(m_peakQuantile, total);
+  }
+
+  m_dirty = false;
+}
+
+float
+WFLevelEstimator::noiseFloor()
+{
+  update();
+  return m_floor;
+}
+
+float
+WFLevelEstimator::peakLevel()
+{
+  update();
+  return m_peak;
+}
+
+quint64
+WFLevelEstimator::memoryUsage() const
+{
+  return m_frame.capacity() * sizeof(uint32_t)
+      + m_hist.capacity() * sizeof(float);
+}
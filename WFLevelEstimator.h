@@ -0,0 +1,78 @@
+//
+//    WFLevelEstimator.h: Streaming noise floor and peak level estimator
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef WFLEVELESTIMATOR_H
+#define WFLEVELESTIMATOR_H
+
+#include <QtGlobal>
+#include <vector>
+#include <cstdint>
+
+#define WF_LEVEL_ESTIMATOR_MIN_DB          -200.f
+#define WF_LEVEL_ESTIMATOR_MAX_DB            60.f
+#define WF_LEVEL_ESTIMATOR_BINS_PER_DB        4.f
+#define WF_LEVEL_ESTIMATOR_DEFAULT_FRAMES    32
+#define WF_LEVEL_ESTIMATOR_FLOOR_QUANTILE    .5f
+#define WF_LEVEL_ESTIMATOR_PEAK_QUANTILE     .999f
+
+//
+// Estimates the noise floor and the peak level of a stream of FFT frames
+// (in dB) without sorting them. Every frame is binned in a fixed dB
+// histogram (1/4 dB bins), which is merged into an exponentially decaying
+// histogram of the last `frames` frames. Levels are quantiles of the
+// latter: the median for the noise floor and the 99.9th percentile for
+// the peak, interpolated inside the bin.
+//
+// Feeding a frame costs one pass over its bins plus one over the
+// histogram. All memory is allocated in the constructor.
+//
+class WFLevelEstimator {
+  std::vector<uint32_t> m_frame;
+  std::vector<float>    m_hist;
+  float   m_alpha;
+  float   m_floorQuantile = WF_LEVEL_ESTIMATOR_FLOOR_QUANTILE;
+  float   m_peakQuantile  = WF_LEVEL_ESTIMATOR_PEAK_QUANTILE;
+  float   m_floor = WF_LEVEL_ESTIMATOR_MIN_DB;
+  float   m_peak  = WF_LEVEL_ESTIMATOR_MIN_DB;
+  quint64 m_count = 0;
+  bool    m_dirty = false;
+
+  float quantile(float q, float total) const;
+  void  update();
+
+public:
+  WFLevelEstimator();
+
+  void setFrames(int frames);
+  void setQuantiles(float floor, float peak);
+  void reset();
+  void feed(const float *data, int size);
+
+  float noiseFloor();
+  float peakLevel();
+
+  inline quint64
+  frames() const
+  {
+    return m_count;
+  }
+
+  quint64 memoryUsage() const;
+};
+
+#endif // WFLEVELESTIMATOR_H
@@ -0,0 +1,225 @@
+//
+//    WFTextureLayer.cpp: Persistent textures for waterfall images
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include "WFTextureLayer.h"
+#include "SuWidgetsHelpers.h"
+
+#include <QOpenGLFunctions>
+#include <QOpenGLTexture>
+#include <QOpenGLTextureBlitter>
+
+WFTextureLayer::WFTextureLayer(bool scrolling) : m_scrolling(scrolling)
+{
+}
+
+WFTextureLayer::~WFTextureLayer()
+{
+  // The owner is expected to call release() with its context current
+  delete m_texture;
+}
+
+bool
+WFTextureLayer::canUpload(QImage const &image)
+{
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+  switch (image.format()) {
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+      // Rows must be contiguous to upload several at once
+      return !image.isNull() && image.bytesPerLine() == image.width() * 4;
+
+    default:
+      break;
+  }
+#else
+  (void) image;
+#endif // Q_BYTE_ORDER
+
+  return false;
+}
+
+void
+WFTextureLayer::invalidate()
+{
+  m_dirty = true;
+}
+
+void
+WFTextureLayer::scrolled(int rows)
+{
+  if (!m_scrolling)
+    m_dirty = true;
+  else
+    m_pending += rows;
+}
+
+void
+WFTextureLayer::uploadRows(
+    QOpenGLFunctions *f,
+    QImage const &image,
+    int first,
+    int count,
+    int row)
+{
+  // BGRA bytes, uploaded as RGBA and swizzled back when rendering
+  f->glTexSubImage2D(
+        GL_TEXTURE_2D,
+        0,
+        0,
+        row,
+        image.width(),
+        count,
+        GL_RGBA,
+        GL_UNSIGNED_BYTE,
+        image.constScanLine(first));
+}
+
+bool
+WFTextureLayer::upload(QOpenGLFunctions *f, QImage const &image)
+{
+  int h = image.height();
+
+  // Nothing changed: the image is not even looked at
+  if (m_texture != nullptr && !needsUpload())
+    return true;
+
+  if (!canUpload(image))
+    return false;
+
+  if (m_texture == nullptr || m_size != image.size()) {
+    release();
+
+    m_texture = new QOpenGLTexture(QOpenGLTexture::Target2D);
+    m_texture->setFormat(QOpenGLTexture::RGBA8_UNorm);
+    m_texture->setSize(image.width(), h);
+    m_texture->setMinificationFilter(QOpenGLTexture::Nearest);
+    m_texture->setMagnificationFilter(QOpenGLTexture::Nearest);
+    m_texture->setWrapMode(QOpenGLTexture::ClampToEdge);
+    m_texture->allocateStorage(
+          QOpenGLTexture::RGBA,
+          QOpenGLTexture::UInt8);
+
+    if (!m_texture->isStorageAllocated()) {
+      release();
+      return false;
+    }
+
+    m_size  = image.size();
+    m_dirty = true;
+  }
+
+  m_texture->bind();
+
+  if (m_dirty || m_pending >= h) {
+    uploadRows(f, image, 0, h, 0);
+    m_head = 0;
+  } else {
+    int tail;
+
+    // The new rows are the first m_pending rows of the image
+    m_head = (m_head - m_pending + h) % h;
+    tail   = qMin(m_pending, h - m_head);
+
+    uploadRows(f, image, 0, tail, m_head);
+    if (tail < m_pending)
+      uploadRows(f, image, tail, m_pending - tail, 0);
+  }
+
+  m_texture->release();
+
+  m_dirty   = false;
+  m_pending = 0;
+
+  return true;
+}
+
+void
+WFTextureLayer::render(
+    QOpenGLTextureBlitter &blitter,
+    QRectF const &target,
+    QRect const &viewport)
+{
+  qreal h = m_size.height();
+  qreal rowHeight;
+  qreal split;
+
+  if (m_texture == nullptr || m_size.isEmpty())
+    return;
+
+  rowHeight = target.height() / h;
+  split     = (h - m_head) * rowHeight;
+
+  blitter.bind();
+  blitter.setRedBlueSwizzle(true);
+
+  // Texture rows [head, h) go on top, rows [0, head) below them
+  blitter.blit(
+        m_texture->textureId(),
+        QOpenGLTextureBlitter::targetTransform(
+          QRectF(target.x(), target.y(), target.width(), split),
+          viewport),
+        QOpenGLTextureBlitter::sourceTransform(
+          QRectF(0, m_head, m_size.width(), h - m_head),
+          m_size,
+          QOpenGLTextureBlitter::OriginTopLeft));
+
+  if (m_head > 0)
+    blitter.blit(
+          m_texture->textureId(),
+          QOpenGLTextureBlitter::targetTransform(
+            QRectF(
+              target.x(),
+              target.y() + split,
+              target.width(),
+              target.height() - split),
+            viewport),
+          QOpenGLTextureBlitter::sourceTransform(
+            QRectF(0, 0, m_size.width(), m_head),
+            m_size,
+            QOpenGLTextureBlitter::OriginTopLeft));
+
+  blitter.setRedBlueSwizzle(false);
+  blitter.release();
+}
+
+void
+WFTextureLayer::release()
+{
+  if (m_texture != nullptr) {
+    if (m_texture->isCreated())
+      m_texture->destroy();
+    delete m_texture;
+    m_texture = nullptr;
+  }
+
+  m_size    = QSize();
+  m_head    = 0;
+  m_pending = 0;
+  m_dirty   = true;
+}
+
+quint64
+WFTextureLayer::memoryUsage() const
+{
+  if (m_texture == nullptr)
+    return 0;
+
+  return SCAST(quint64, m_size.width()) * SCAST(quint64, m_size.height()) * 4;
+}
@@ -0,0 +1,74 @@
+//
+//    WFTextureLayer.h: Persistent textures for waterfall images
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef WFTEXTURELAYER_H
+#define WFTEXTURELAYER_H
+
+#include <QImage>
+#include <QRect>
+#include <QSize>
+
+class QOpenGLFunctions;
+class QOpenGLTexture;
+class QOpenGLTextureBlitter;
+
+//
+// Keeps a QImage mirrored in a GL texture, so that painting it does not
+// upload the whole image every frame (as QPainter::drawImage on a
+// QOpenGLWidget does whenever the image changed).
+//
+// In scrolling mode the texture is a ring of rows: scrolled(n) tells that
+// the image moved n rows down and got n new rows on top, and only those
+// rows are uploaded. Any other change requires invalidate().
+//
+// All methods but invalidate() and scrolled() need the GL context of the
+// widget to be current. Images must have 32 bits per pixel in native
+// byte order (RGB32, ARGB32 or ARGB32_Premultiplied).
+//
+class WFTextureLayer {
+  QOpenGLTexture *m_texture = nullptr;
+  QSize m_size;
+  int   m_head    = 0;    // Texture row holding the first image row
+  int   m_pending = 0;    // Rows scrolled in since the last upload
+  bool  m_dirty   = true;
+  bool  m_scrolling;
+
+  void uploadRows(QOpenGLFunctions *, QImage const &, int first, int count, int row);
+
+public:
+  explicit WFTextureLayer(bool scrolling = false);
+  ~WFTextureLayer();
+
+  static bool canUpload(QImage const &);
+
+  void invalidate();
+  void scrolled(int rows);
+
+  inline bool
+  needsUpload() const
+  {
+    return m_dirty || m_pending > 0;
+  }
+
+  bool upload(QOpenGLFunctions *, QImage const &);
+  void render(QOpenGLTextureBlitter &, QRectF const &target, QRect const &viewport);
+  void release();
+  quint64 memoryUsage() const;
+};
+
+#endif // WFTEXTURELAYER_H
@@ -81,6 +81,15 @@ Waterfall::~Waterfall()
 {
 }
 
+void
+Waterfall::memoryUsage(SuWidgetsMemoryUsage &usage) const
+{
+  AbstractWaterfall::memoryUsage(usage);
+
+  usage[SUWIDGETS_MEMORY_IMAGES] +=
+      SuWidgetsMemory::imageBytes(m_WaterfallImage);
+}
+
 void
 Waterfall::setPalette(const QColor *table)
 {
@@ -101,6 +110,7 @@ void
 Waterfall::clearWaterfall()
 {
   m_WaterfallImage.fill(Qt::black);
+  m_waterfallLayer.invalidate();
 }
 
 /**
@@ -198,21 +208,21 @@ void Waterfall::resizeEvent(QResizeEvent* event)
         m_Size.width(),
         m_WaterfallHeight,
         Qt::IgnoreAspectRatio,
-        Qt::SmoothTransformation);
+        isInteracting()
+          ? Qt::FastTransformation
+          : Qt::SmoothTransformation);
   }
+
+  m_waterfallLayer.invalidate();
 }
 
 void
-Waterfall::addNewWfLine(const float* wfData, int size, int repeats)
+Waterfall::paintWfLine(uint32_t *scanLineData, const float *wfData, int size)
 {
   int w = m_WaterfallImage.width();
-  int h = m_WaterfallImage.height();
   int xmin, xmax;
   qint64 limit = (SCAST(qint64, m_SampleFreq) + m_Span) / 2 - 1;
 
-  if (w == 0 || h == 0 || size == 0)
-    return;
-
   // get scaled FFT data
   int n = qMin(w, MAX_SCREENSIZE);
 
@@ -231,11 +241,28 @@ Waterfall::addNewWfLine(const float* wfData, int size, int repeats)
           limit) + SCAST(qint64, m_Span)/2,
         wfData,
         m_SampleFreq,
-        m_fftDataSize,
+        size,
         m_fftbuf,
         &xmin,
         &xmax);
 
+  memset(scanLineData, 0, SCAST(unsigned, xmin) * sizeof(uint32_t));
+
+  memset(scanLineData + xmax, 0, SCAST(unsigned, w - xmax) * sizeof(uint32_t));
+
+  for (int i = xmin; i < xmax; i++)
+    scanLineData[i] = m_UintColorTbl[255 - m_fftbuf[i]];
+}
+
+void
+Waterfall::addNewWfLine(const float* wfData, int size, int repeats)
+{
+  int w = m_WaterfallImage.width();
+  int h = m_WaterfallImage.height();
+
+  if (w == 0 || h == 0 || size == 0)
+    return;
+
   // move current data down required amount (must do before attaching a QPainter object)
   memmove(
       m_WaterfallImage.scanLine(repeats),
@@ -245,22 +272,54 @@ Waterfall::addNewWfLine(const float* wfData, int size, int repeats)
 
   uint32_t *scanLineData = RCAST(uint32_t *, m_WaterfallImage.scanLine(0));
 
-  memset(scanLineData, 0, SCAST(unsigned, xmin) * sizeof(uint32_t));
-
-  memset(scanLineData + xmax, 0, SCAST(unsigned, w - xmax) * sizeof(uint32_t));
-
-  for (int i = xmin; i < xmax; i++)
-    scanLineData[i] = m_UintColorTbl[255 - m_fftbuf[i]];
+  paintWfLine(scanLineData, wfData, size);
 
   // copy as needed onto extra lines
   for (int j = 1; j < repeats; j++) {
     uint32_t *nextLine = RCAST(uint32_t *, m_WaterfallImage.scanLine(j));
     memcpy(nextLine, scanLineData, SCAST(size_t, w) * sizeof(uint32_t));
   }
+
+  // Only the new rows are uploaded to the texture
+  m_waterfallLayer.scrolled(repeats);
+}
+
+//
+// Every visible row is painted in place, instead of scrolling the whole
+// image once per row as addNewWfLine() would.
+//
+void
+Waterfall::redrawWaterfallHistory()
+{
+  int rows;
+
+  if (!m_timeHistory.enabled() || m_WaterfallImage.isNull())
+    return;
+
+  clearWaterfall();
+
+  rows = qMin(
+        m_WaterfallImage.height(),
+        m_timeHistory.available(m_timeZoom));
+
+  for (int y = 0; y < rows; ++y)
+    paintWfLine(
+          RCAST(uint32_t *, m_WaterfallImage.scanLine(y)),
+          m_timeHistory.row(m_timeZoom, y, m_timeReduction),
+          m_timeHistory.width());
 }
 
 void
 Waterfall::drawWaterfall(QPainter &painter)
 {
-  painter.drawImage(0, m_SpectrumPlotHeight, m_WaterfallImage);
+  if (!paintTextureLayer(
+        painter,
+        m_waterfallLayer,
+        m_WaterfallImage,
+        QRectF(
+          0,
+          m_SpectrumPlotHeight,
+          m_WaterfallImage.width(),
+          m_WaterfallImage.height())))
+    painter.drawImage(0, m_SpectrumPlotHeight, m_WaterfallImage);
 }
@@ -46,6 +46,8 @@ class Waterfall : public AbstractWaterfall
     explicit Waterfall(QWidget *parent = 0);
     ~Waterfall() override;
 
+    void memoryUsage(SuWidgetsMemoryUsage &) const override;
+
     void setPalette(const QColor *table) override;
     void clearWaterfall() override;
     bool saveWaterfall(const QString & filename) const override;
@@ -54,7 +56,9 @@ class Waterfall : public AbstractWaterfall
     // re-implemented widget event handlers
     void resizeEvent(QResizeEvent* event) override;
 
+    void paintWfLine(uint32_t *scanLine, const float *wfData, int size);
     void addNewWfLine(const float *wfData, int size, int repeats) override;
+    void redrawWaterfallHistory() override;
     void drawWaterfall(QPainter &) override;
 };
 
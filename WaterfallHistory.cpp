@@ -0,0 +1,211 @@
+//
+//    WaterfallHistory.cpp: Multi-resolution waterfall line history
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include "WaterfallHistory.h"
+#include "SuWidgetsHelpers.h"
+#include "SuWidgetsKernels.h"
+#include <algorithm>
+#include <cmath>
+
+void
+WaterfallHistory::configure(int levels, int rows)
+{
+  m_levels.clear();
+  m_line.clear();
+  m_width = 0;
+
+  if (levels <= 0 || rows <= 0)
+    return;
+
+  // Storage is allocated on the first push, once the width is known
+  m_rows = rows;
+  m_levels.resize(SCAST(size_t, levels));
+}
+
+void
+WaterfallHistory::allocate(int width)
+{
+  size_t rowSize = SCAST(size_t, width);
+  size_t size    = rowSize * SCAST(size_t, m_rows);
+
+  m_width = width;
+
+  for (size_t i = 0; i < m_levels.size(); ++i) {
+    Level &level = m_levels[i];
+
+    level.mean.assign(size, 0);
+    if (i > 0) {
+      level.max.assign(size, 0);
+      level.carryMean.assign(rowSize, 0);
+      level.carryMax.assign(rowSize, 0);
+    }
+
+    level.head      = -1;
+    level.count     = 0;
+    level.haveCarry = false;
+  }
+}
+
+void
+WaterfallHistory::clear()
+{
+  for (auto &level : m_levels) {
+    level.head      = -1;
+    level.count     = 0;
+    level.haveCarry = false;
+  }
+}
+
+void
+WaterfallHistory::dropLevel()
+{
+  if (!m_levels.empty())
+    m_levels.pop_back();
+}
+
+int
+WaterfallHistory::advance(Level &level)
+{
+  level.head = (level.head + 1) % m_rows;
+
+  if (level.count < m_rows)
+    ++level.count;
+
+  return level.head;
+}
+
+int
+WaterfallHistory::push(const float *data, int size)
+{
+  int width = qMin(size, WATERFALL_HISTORY_MAX_WIDTH);
+  const float *line = data;
+  const float *mean;
+  const float *max;
+  float *dst;
+  int top = 0;
+
+  if (!enabled() || size <= 0)
+    return -1;
+
+  if (width != m_width)
+    allocate(width);
+
+  // Too many bins: keep the strongest of every group
+  if (size > width) {
+    m_line.resize(SCAST(size_t, width));
+
+    for (int i = 0; i < width; ++i) {
+      qint64 start = SCAST(qint64, i) * size / width;
+      qint64 end   = SCAST(qint64, i + 1) * size / width;
+
+      m_line[SCAST(size_t, i)] = SuWidgetsKernels::maximum(
+            data + start,
+            SCAST(SUSCOUNT, end - start));
+    }
+
+    line = m_line.data();
+  }
+
+  Level &first = m_levels[0];
+  dst = first.mean.data() + SCAST(size_t, advance(first)) * SCAST(size_t, m_width);
+  std::copy(line, line + m_width, dst);
+
+  mean = max = dst;
+
+  // Carry the new row upwards while rows pair up
+  for (size_t l = 1; l < m_levels.size(); ++l) {
+    Level &level = m_levels[l];
+    size_t offset;
+    float *dstMean, *dstMax;
+    const float *carryMean, *carryMax;
+
+    if (!level.haveCarry) {
+      std::copy(mean, mean + m_width, level.carryMean.begin());
+      std::copy(max,  max  + m_width, level.carryMax.begin());
+      level.haveCarry = true;
+      break;
+    }
+
+    offset    = SCAST(size_t, advance(level)) * SCAST(size_t, m_width);
+    dstMean   = level.mean.data() + offset;
+    dstMax    = level.max.data() + offset;
+    carryMean = level.carryMean.data();
+    carryMax  = level.carryMax.data();
+
+    for (int i = 0; i < m_width; ++i) {
+      dstMean[i] = .5f * (carryMean[i] + mean[i]);
+      dstMax[i]  = fmaxf(carryMax[i], max[i]);
+    }
+
+    level.haveCarry = false;
+    top  = SCAST(int, l);
+    mean = dstMean;
+    max  = dstMax;
+  }
+
+  return top;
+}
+
+const float *
+WaterfallHistory::row(
+    int level,
+    int age,
+    WaterfallTimeReduction reduction) const
+{
+  size_t offset;
+
+  if (level < 0 || level >= levels())
+    return nullptr;
+
+  Level const &current = m_levels[SCAST(size_t, level)];
+
+  if (age < 0 || age >= current.count)
+    return nullptr;
+
+  offset = SCAST(size_t, (current.head - age + m_rows) % m_rows)
+      * SCAST(size_t, m_width);
+
+  if (level == 0 || reduction == WATERFALL_TIME_MEAN)
+    return current.mean.data() + offset;
+
+  return current.max.data() + offset;
+}
+
+int
+WaterfallHistory::available(int level) const
+{
+  if (level < 0 || level >= levels())
+    return 0;
+
+  return m_levels[SCAST(size_t, level)].count;
+}
+
+quint64
+WaterfallHistory::memoryUsage() const
+{
+  quint64 floats = m_line.capacity();
+
+  for (auto const &level : m_levels)
+    floats += level.mean.capacity()
+        + level.max.capacity()
+        + level.carryMean.capacity()
+        + level.carryMax.capacity();
+
+  return floats * sizeof(float);
+}
@@ -0,0 +1,106 @@
+//
+//    WaterfallHistory.h: Multi-resolution waterfall line history
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef WATERFALLHISTORY_H
+#define WATERFALLHISTORY_H
+
+#include <QtGlobal>
+#include <vector>
+
+#define WATERFALL_HISTORY_DEFAULT_ROWS  1024
+#define WATERFALL_HISTORY_MAX_WIDTH     2048
+
+enum WaterfallTimeReduction {
+  WATERFALL_TIME_MEAN,
+  WATERFALL_TIME_MAX
+};
+
+//
+// Time-direction pyramid of waterfall lines. Level 0 keeps the last
+// `rows` lines as they were pushed. Every row of level k is the mean and
+// the maximum of two consecutive rows of level k - 1, i.e. it summarizes
+// 2^k lines, and each level keeps its own last `rows` rows. A waterfall
+// zoomed out by 2^k is therefore drawn from `rows` rows of level k,
+// regardless of how many lines these cover.
+//
+// Lines wider than WATERFALL_HISTORY_MAX_WIDTH bins are reduced (keeping
+// the maximum of every group of bins) before being stored. Changing the
+// line width clears the history. Memory usage is
+// width * rows * (2 * levels - 1) floats.
+//
+class WaterfallHistory {
+  struct Level {
+    std::vector<float> mean;
+    std::vector<float> max;   // Empty in level 0
+    int  head  = -1;          // Row of the newest line
+    int  count = 0;
+
+    // Row of the level below waiting for its pair
+    std::vector<float> carryMean;
+    std::vector<float> carryMax;
+    bool haveCarry = false;
+  };
+
+  std::vector<Level> m_levels;
+  std::vector<float> m_line;
+  int m_rows  = WATERFALL_HISTORY_DEFAULT_ROWS;
+  int m_width = 0;
+
+  void allocate(int width);
+  int  advance(Level &);
+
+public:
+  void configure(int levels, int rows = WATERFALL_HISTORY_DEFAULT_ROWS);
+  void clear();
+
+  // Forgets the most zoomed-out level, keeping the rest
+  void dropLevel();
+
+  // Returns the highest level that got a new row
+  int push(const float *data, int size);
+
+  const float *row(int level, int age, WaterfallTimeReduction) const;
+  int available(int level) const;
+  quint64 memoryUsage() const;
+
+  inline bool
+  enabled() const
+  {
+    return !m_levels.empty();
+  }
+
+  inline int
+  levels() const
+  {
+    return static_cast<int>(m_levels.size());
+  }
+
+  inline int
+  rows() const
+  {
+    return m_rows;
+  }
+
+  inline int
+  width() const
+  {
+    return m_width;
+  }
+};
+
+#endif // WATERFALLHISTORY_H
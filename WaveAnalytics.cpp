@@ -0,0 +1,425 @@
+//
+//    WaveAnalytics.cpp: Background analysis of waveform selections
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include "WaveAnalytics.h"
+#include "SuWidgetsHelpers.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <cmath>
+
+// Histogram indices are computed in blocks of this size, in a separate
+// loop that the compiler can vectorize
+#define WAVE_ANALYTICS_INDEX_BLOCK 1024
+
+///////////////////////////// WaveAnalyticsWorker //////////////////////////////
+WaveAnalyticsWorker::WaveAnalyticsWorker(
+    const std::atomic<quint64> *generation,
+    QObject *parent) : QObject(parent)
+{
+  m_generation = generation;
+}
+
+WaveAnalyticsWorker::~WaveAnalyticsWorker()
+{
+  QMutexLocker locker(SuWidgetsHelpers::fftwPlannerMutex());
+
+  for (auto &p : m_plans) {
+    if (p.second.plan != nullptr)
+      SU_FFTW(_destroy_plan)(p.second.plan);
+    if (p.second.in != nullptr)
+      SU_FFTW(_free)(p.second.in);
+    if (p.second.out != nullptr)
+      SU_FFTW(_free)(p.second.out);
+  }
+}
+
+WaveAnalyticsPlan *
+WaveAnalyticsWorker::getPlan(int size)
+{
+  auto it = m_plans.find(size);
+
+  if (it == m_plans.end()) {
+    QMutexLocker locker(SuWidgetsHelpers::fftwPlannerMutex());
+    WaveAnalyticsPlan plan;
+
+    plan.in  = SU_FFTW(_alloc_complex)(SCAST(size_t, size));
+    plan.out = SU_FFTW(_alloc_complex)(SCAST(size_t, size));
+
+    if (plan.in == nullptr || plan.out == nullptr) {
+      if (plan.in != nullptr)
+        SU_FFTW(_free)(plan.in);
+      if (plan.out != nullptr)
+        SU_FFTW(_free)(plan.out);
+      return nullptr;
+    }
+
+    plan.plan = SU_FFTW(_plan_dft_1d)(
+          size,
+          plan.in,
+          plan.out,
+          FFTW_FORWARD,
+          FFTW_ESTIMATE);
+
+    if (plan.plan == nullptr) {
+      SU_FFTW(_free)(plan.in);
+      SU_FFTW(_free)(plan.out);
+      return nullptr;
+    }
+
+    // Hann window
+    plan.window.resize(SCAST(size_t, size));
+    for (int i = 0; i < size; ++i) {
+      SUFLOAT w = SCAST(SUFLOAT, .5 - .5 * cos(2 * M_PI * i / size));
+      plan.window[SCAST(size_t, i)] = w;
+      plan.windowPower += w * w;
+    }
+
+    it = m_plans.emplace(size, plan).first;
+  }
+
+  return &it->second;
+}
+
+//
+// RMS and histogram are computed in the same pass. Samples are processed
+// in chunks, checking for cancellation between them. Bin indices of a
+// block are computed first (vectorizable), and then scattered into four
+// interleaved sub-histograms so that consecutive increments of the same
+// bin do not stall on each other.
+//
+bool
+WaveAnalyticsWorker::computeHistogram(
+    WaveAnalyticsRequest const &req,
+    WaveSelectionStats &stats)
+{
+  WaveSelectionHistogram histogram;
+  SuWidgetsHelpers::KahanState state;
+  std::vector<quint64> sub(SCAST(size_t, 4 * req.bins), 0);
+  int idx[WAVE_ANALYTICS_INDEX_BLOCK];
+  SUFLOAT values[WAVE_ANALYTICS_INDEX_BLOCK];
+  SUFLOAT min   = SCAST(SUFLOAT, req.min);
+  SUFLOAT range = SCAST(SUFLOAT, req.max - req.min);
+  SUFLOAT k     = range > 0 ? req.bins / range : 0;
+  SUFLOAT top   = SCAST(SUFLOAT, req.bins - 1);
+  quint64 *h0 = sub.data();
+  quint64 *h1 = h0 + req.bins;
+  quint64 *h2 = h1 + req.bins;
+  quint64 *h3 = h2 + req.bins;
+  qint64 pos = req.start;
+  SUCOMPLEX mean;
+  SUFLOAT rms = 0;
+
+  while (pos <= req.end) {
+    qint64 chunkEnd = qMin(pos + WAVE_ANALYTICS_CHUNK_SIZE - 1, req.end);
+
+    if (cancelled(req.generation))
+      return false;
+
+    SuWidgetsHelpers::kahanMeanAndRms(
+          &mean,
+          &rms,
+          req.data + pos,
+          SCAST(SUSCOUNT, chunkEnd - pos + 1),
+          &state);
+
+    for (qint64 b = pos; b <= chunkEnd; b += WAVE_ANALYTICS_INDEX_BLOCK) {
+      const SUCOMPLEX *data = req.data + b;
+      int len = SCAST(int, qMin(
+            SCAST(qint64, WAVE_ANALYTICS_INDEX_BLOCK),
+            chunkEnd - b + 1));
+      int i;
+
+      if (req.real) {
+        for (i = 0; i < len; ++i)
+          values[i] = SU_C_REAL(data[i]);
+      } else {
+        for (i = 0; i < len; ++i)
+          values[i] = SU_C_IMAG(data[i]);
+      }
+
+#pragma GCC ivdep
+      for (i = 0; i < len; ++i) {
+        SUFLOAT f = (values[i] - min) * k;
+        f = f >= 0 ? f : 0; // Also catches NaN
+        f = f > top ? top : f;
+        idx[i] = SCAST(int, f);
+      }
+
+      for (i = 0; i + 3 < len; i += 4) {
+        ++h0[idx[i + 0]];
+        ++h1[idx[i + 1]];
+        ++h2[idx[i + 2]];
+        ++h3[idx[i + 3]];
+      }
+
+      for (; i < len; ++i)
+        ++h0[idx[i]];
+    }
+
+    pos = chunkEnd + 1;
+  }
+
+  histogram.generation = req.generation;
+  histogram.min        = req.min;
+  histogram.max        = req.max;
+  histogram.real       = req.real;
+  histogram.bins.resize(SCAST(size_t, req.bins));
+
+  for (int i = 0; i < req.bins; ++i)
+    histogram.bins[SCAST(size_t, i)] = h0[i] + h1[i] + h2[i] + h3[i];
+
+  stats.rms     = rms;
+  stats.haveRms = true;
+
+  emit statsReady(stats);
+  emit histogramReady(histogram);
+
+  return true;
+}
+
+//
+// Welch estimate: Hann-windowed segments with 50% overlap, averaged power.
+//
+bool
+WaveAnalyticsWorker::computeSpectrum(WaveAnalyticsRequest const &req)
+{
+  WaveSelectionSpectrum spectrum;
+  WaveAnalyticsPlan *plan;
+  qint64 length = req.end - req.start + 1;
+  int size = req.fftSize;
+  int hop, half;
+  SUFLOAT norm;
+
+  // Short selections: use the largest size that fits
+  while (size > WAVE_ANALYTICS_MIN_FFT_SIZE && size > length)
+    size >>= 1;
+
+  if (size > length)
+    return true;
+
+  if ((plan = getPlan(size)) == nullptr)
+    return true;
+
+  hop  = size / 2;
+  half = size / 2;
+
+  spectrum.generation = req.generation;
+  spectrum.fftSize    = size;
+  spectrum.psd.assign(SCAST(size_t, size), 0);
+
+  for (qint64 p = req.start; p + size - 1 <= req.end; p += hop) {
+    const SUCOMPLEX *data = req.data + p;
+
+    if (cancelled(req.generation))
+      return false;
+
+    for (int i = 0; i < size; ++i) {
+      SUFLOAT w = plan->window[SCAST(size_t, i)];
+      plan->in[i][0] = SU_C_REAL(data[i]) * w;
+      plan->in[i][1] = SU_C_IMAG(data[i]) * w;
+    }
+
+    SU_FFTW(_execute)(plan->plan);
+
+    // Accumulate with the DC bin moved to the center
+    for (int i = 0; i < size; ++i) {
+      SUFLOAT re = plan->out[i][0];
+      SUFLOAT im = plan->out[i][1];
+      spectrum.psd[SCAST(size_t, (i + half) % size)] += re * re + im * im;
+    }
+
+    ++spectrum.segments;
+  }
+
+  if (spectrum.segments > 0) {
+    norm = 1.f / (SCAST(SUFLOAT, spectrum.segments) * plan->windowPower);
+    for (auto &bin : spectrum.psd)
+      bin *= norm;
+  }
+
+  emit spectrumReady(spectrum);
+
+  return true;
+}
+
+void
+WaveAnalyticsWorker::analyze(WaveAnalyticsRequest req)
+{
+  WaveSelectionStats stats;
+
+  if (cancelled(req.generation) || req.data == nullptr)
+    return;
+
+  stats.generation = req.generation;
+  stats.start      = req.start;
+  stats.end        = req.end;
+
+  if (!computeHistogram(req, stats))
+    return;
+
+  computeSpectrum(req);
+}
+
+//////////////////////////////// WaveAnalytics /////////////////////////////////
+WaveAnalytics::WaveAnalytics(QObject *parent) : QObject(parent)
+{
+  qRegisterMetaType<WaveSelectionStats>("WaveSelectionStats");
+  qRegisterMetaType<WaveSelectionHistogram>("WaveSelectionHistogram");
+  qRegisterMetaType<WaveSelectionSpectrum>("WaveSelectionSpectrum");
+  qRegisterMetaType<WaveAnalyticsRequest>("WaveAnalyticsRequest");
+
+  m_generation.store(0);
+
+  m_workerThread = new QThread(this);
+  m_worker       = new WaveAnalyticsWorker(&m_generation);
+
+  m_worker->moveToThread(m_workerThread);
+
+  connect(
+        this,
+        SIGNAL(triggerAnalysis(WaveAnalyticsRequest)),
+        m_worker,
+        SLOT(analyze(WaveAnalyticsRequest)));
+
+  connect(
+        m_worker,
+        SIGNAL(statsReady(WaveSelectionStats)),
+        this,
+        SLOT(onStatsReady(WaveSelectionStats)));
+
+  connect(
+        m_worker,
+        SIGNAL(histogramReady(WaveSelectionHistogram)),
+        this,
+        SLOT(onHistogramReady(WaveSelectionHistogram)));
+
+  connect(
+        m_worker,
+        SIGNAL(spectrumReady(WaveSelectionSpectrum)),
+        this,
+        SLOT(onSpectrumReady(WaveSelectionSpectrum)));
+
+  m_workerThread->start();
+}
+
+WaveAnalytics::~WaveAnalytics()
+{
+  cancel();
+
+  m_workerThread->quit();
+  m_workerThread->wait();
+
+  delete m_worker;
+}
+
+void
+WaveAnalytics::setFFTSize(int size)
+{
+  int pow2 = WAVE_ANALYTICS_MIN_FFT_SIZE;
+
+  while (pow2 < size)
+    pow2 <<= 1;
+
+  m_fftSize = pow2;
+}
+
+bool
+WaveAnalytics::analyze(const WaveViewTree *tree, qint64 start, qint64 end)
+{
+  WaveAnalyticsRequest req;
+  WaveSelectionStats stats;
+  WaveLimits limits;
+  qint64 length;
+
+  cancel();
+
+  if (tree == nullptr || !tree->isComplete())
+    return false;
+
+  length = SCAST(qint64, tree->getLength());
+
+  if (start > end)
+    std::swap(start, end);
+
+  start = qMax(start, SCAST(qint64, 0));
+  end   = qMin(end, length - 1);
+
+  if (start > end)
+    return false;
+
+  // Pyramid stats, O(log n)
+  tree->computeLimits(start, end, limits);
+
+  stats.generation = m_generation.load();
+  stats.start      = start;
+  stats.end        = end;
+  stats.min        = limits.min;
+  stats.max        = limits.max;
+  stats.mean       = limits.mean;
+  stats.envelope   = limits.envelope;
+
+  emit limitsReady(stats);
+
+  req.generation = stats.generation;
+  req.data       = tree->getData();
+  req.start      = start;
+  req.end        = end;
+  req.real       = m_real;
+  req.bins       = m_bins;
+  req.fftSize    = m_fftSize;
+
+  if (m_real) {
+    req.min = SCAST(qreal, SU_C_REAL(limits.min));
+    req.max = SCAST(qreal, SU_C_REAL(limits.max));
+  } else {
+    req.min = SCAST(qreal, SU_C_IMAG(limits.min));
+    req.max = SCAST(qreal, SU_C_IMAG(limits.max));
+  }
+
+  emit triggerAnalysis(req);
+
+  return true;
+}
+
+void
+WaveAnalytics::cancel()
+{
+  ++m_generation;
+}
+
+void
+WaveAnalytics::onStatsReady(WaveSelectionStats stats)
+{
+  if (stats.generation == m_generation.load())
+    emit statsReady(stats);
+}
+
+void
+WaveAnalytics::onHistogramReady(WaveSelectionHistogram histogram)
+{
+  if (histogram.generation == m_generation.load())
+    emit histogramReady(histogram);
+}
+
+void
+WaveAnalytics::onSpectrumReady(WaveSelectionSpectrum spectrum)
+{
+  if (spectrum.generation == m_generation.load())
+    emit spectrumReady(spectrum);
+}
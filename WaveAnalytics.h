@@ -0,0 +1,183 @@
+//
+//    WaveAnalytics.h: Background analysis of waveform selections
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef WAVEANALYTICS_H
+#define WAVEANALYTICS_H
+
+#include <QObject>
+#include <QThread>
+#include <QMetaType>
+#include <atomic>
+#include <map>
+#include <vector>
+
+#include <fftw3.h>
+#include "WaveViewTree.h"
+
+#define WAVE_ANALYTICS_DEFAULT_BINS     256
+#define WAVE_ANALYTICS_DEFAULT_FFT_SIZE 1024
+#define WAVE_ANALYTICS_MIN_FFT_SIZE     16
+#define WAVE_ANALYTICS_CHUNK_SIZE       (1 << 20)
+
+struct WaveSelectionStats {
+  quint64   generation = 0;
+  qint64    start = 0;
+  qint64    end   = 0;
+  SUCOMPLEX min   = 0;
+  SUCOMPLEX max   = 0;
+  SUCOMPLEX mean  = 0;
+  SUFLOAT   envelope = 0;
+  SUFLOAT   rms   = 0;
+  bool      haveRms = false; // RMS is not kept in the tree
+};
+
+struct WaveSelectionHistogram {
+  quint64              generation = 0;
+  qreal                min  = 0;
+  qreal                max  = 0;
+  bool                 real = true;
+  std::vector<quint64> bins;
+};
+
+// Welch PSD estimate. Bins are ordered from -fs/2 to fs/2 (DC centered)
+struct WaveSelectionSpectrum {
+  quint64              generation = 0;
+  int                  fftSize  = 0;
+  unsigned             segments = 0;
+  std::vector<SUFLOAT> psd;
+};
+
+struct WaveAnalyticsRequest {
+  quint64          generation = 0;
+  const SUCOMPLEX *data  = nullptr;
+  qint64           start = 0;
+  qint64           end   = 0;
+  qreal            min   = 0;
+  qreal            max   = 0;
+  bool             real  = true;
+  int              bins  = WAVE_ANALYTICS_DEFAULT_BINS;
+  int              fftSize = WAVE_ANALYTICS_DEFAULT_FFT_SIZE;
+};
+
+Q_DECLARE_METATYPE(WaveSelectionStats)
+Q_DECLARE_METATYPE(WaveSelectionHistogram)
+Q_DECLARE_METATYPE(WaveSelectionSpectrum)
+Q_DECLARE_METATYPE(WaveAnalyticsRequest)
+
+struct WaveAnalyticsPlan {
+  SU_FFTW(_plan)       plan = nullptr;
+  SU_FFTW(_complex)   *in   = nullptr;
+  SU_FFTW(_complex)   *out  = nullptr;
+  std::vector<SUFLOAT> window;
+  SUFLOAT              windowPower = 0;
+};
+
+class WaveAnalyticsWorker : public QObject {
+  Q_OBJECT
+
+  // Plans are created once per FFT size and kept for the worker lifetime
+  std::map<int, WaveAnalyticsPlan> m_plans;
+  const std::atomic<quint64>      *m_generation;
+
+  inline bool
+  cancelled(quint64 generation) const
+  {
+    return m_generation->load() != generation;
+  }
+
+  WaveAnalyticsPlan *getPlan(int size);
+  bool computeHistogram(WaveAnalyticsRequest const &, WaveSelectionStats &);
+  bool computeSpectrum(WaveAnalyticsRequest const &);
+
+public:
+  WaveAnalyticsWorker(
+      const std::atomic<quint64> *generation,
+      QObject *parent = nullptr);
+  ~WaveAnalyticsWorker() override;
+
+public slots:
+  void analyze(WaveAnalyticsRequest);
+
+signals:
+  void statsReady(WaveSelectionStats);
+  void histogramReady(WaveSelectionHistogram);
+  void spectrumReady(WaveSelectionSpectrum);
+};
+
+//
+// WaveAnalytics computes statistics, the amplitude histogram and the
+// spectrum of a range of samples. Limits, mean and envelope are taken from
+// the WaveViewTree in O(log n) and emitted right away. RMS, histogram and
+// Welch spectrum need a pass over the samples and are computed in a worker
+// thread. Starting a new analysis (or calling cancel()) aborts the current
+// one, and late results from older requests are discarded.
+//
+// The tree and its samples must not change while an analysis is running:
+// call cancel() before replacing or reprocessing the data.
+//
+class WaveAnalytics : public QObject {
+  Q_OBJECT
+
+  QThread             *m_workerThread = nullptr;
+  WaveAnalyticsWorker *m_worker = nullptr;
+
+  std::atomic<quint64> m_generation;
+
+  int  m_bins    = WAVE_ANALYTICS_DEFAULT_BINS;
+  int  m_fftSize = WAVE_ANALYTICS_DEFAULT_FFT_SIZE;
+  bool m_real    = true;
+
+public:
+  WaveAnalytics(QObject *parent = nullptr);
+  ~WaveAnalytics() override;
+
+  bool analyze(const WaveViewTree *tree, qint64 start, qint64 end);
+
+  inline void
+  setHistogramBins(int bins)
+  {
+    m_bins = bins > 0 ? bins : 1;
+  }
+
+  inline void
+  setRealComponent(bool real)
+  {
+    m_real = real;
+  }
+
+  void setFFTSize(int size);
+
+public slots:
+  void cancel();
+
+  // Private slots
+  void onStatsReady(WaveSelectionStats);
+  void onHistogramReady(WaveSelectionHistogram);
+  void onSpectrumReady(WaveSelectionSpectrum);
+
+signals:
+  void triggerAnalysis(WaveAnalyticsRequest);
+
+  // limitsReady is emitted synchronously from analyze(), without RMS
+  void limitsReady(WaveSelectionStats);
+  void statsReady(WaveSelectionStats);
+  void histogramReady(WaveSelectionHistogram);
+  void spectrumReady(WaveSelectionSpectrum);
+};
+
+#endif // WAVEANALYTICS_H
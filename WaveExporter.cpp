@@ -0,0 +1,284 @@
+//
+//    WaveExporter.cpp: Background export of waveform data
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include "WaveExporter.h"
+#include "Waveform.h"
+#include "SuWidgetsKernels.h"
+#include <QFile>
+#include <sndfile.h>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+// Samples are handed to libsndfile and to disk as interleaved floats
+static_assert(
+    sizeof(SUCOMPLEX) == 2 * sizeof(float),
+    "Waveform export requires single precision samples");
+
+////////////////////////////// WaveExportWorker ////////////////////////////////
+WaveExportWorker::WaveExportWorker(
+    const std::atomic<bool> *cancelFlag,
+    QObject *parent) : QObject(parent)
+{
+  m_cancelFlag = cancelFlag;
+}
+
+WaveExportWorker::~WaveExportWorker()
+{
+
+}
+
+bool
+WaveExportWorker::writeWav(WaveExportRequest const &req, QString &error)
+{
+  SF_INFO info;
+  SNDFILE *sf;
+  quint64 total = SCAST(quint64, req.end - req.start + 1);
+  quint64 done  = 0;
+  bool ok = true;
+
+  memset(&info, 0, sizeof(SF_INFO));
+
+  info.samplerate = SCAST(int, qBound(1., req.sampleRate, SCAST(qreal, INT_MAX)));
+  info.channels   = 2;
+  info.format     = SF_FORMAT_RF64 | SF_FORMAT_FLOAT;
+
+  if ((sf = sf_open(req.path.toLocal8Bit().data(), SFM_WRITE, &info)) == nullptr) {
+    error = QString(sf_strerror(nullptr));
+    return false;
+  }
+
+  // Plain WAV unless the file grows beyond 4 GiB
+  sf_command(sf, SFC_RF64_AUTO_DOWNGRADE, nullptr, SF_TRUE);
+
+  while (done < total) {
+    sf_count_t chunk = SCAST(
+          sf_count_t,
+          qMin(total - done, SCAST(quint64, WAVE_EXPORT_CHUNK_SIZE)));
+    const float *frames = RCAST(const float *, req.data + req.start + done);
+
+    if (m_cancelFlag->load()) {
+      error = "Export cancelled";
+      ok = false;
+      break;
+    }
+
+    if (sf_writef_float(sf, frames, chunk) != chunk) {
+      error = QString(sf_strerror(sf));
+      ok = false;
+      break;
+    }
+
+    done += SCAST(quint64, chunk);
+    emit progress(done, total);
+  }
+
+  sf_close(sf);
+
+  return ok;
+}
+
+bool
+WaveExportWorker::writeRaw(WaveExportRequest const &req, QString &error)
+{
+  QFile file(req.path);
+  quint64 total = SCAST(quint64, req.end - req.start + 1);
+  quint64 done  = 0;
+  bool cs16 = req.format == WAVE_EXPORT_RAW_CS16;
+
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    error = file.errorString();
+    return false;
+  }
+
+  if (cs16)
+    m_cs16Buf.resize(2 * WAVE_EXPORT_CHUNK_SIZE);
+
+  while (done < total) {
+    quint64 chunk = qMin(total - done, SCAST(quint64, WAVE_EXPORT_CHUNK_SIZE));
+    const float *samples = RCAST(const float *, req.data + req.start + done);
+    const char *bytes;
+    qint64 size;
+
+    if (m_cancelFlag->load()) {
+      error = "Export cancelled";
+      return false;
+    }
+
+    if (cs16) {
+      SuWidgetsKernels::toInt16(
+            m_cs16Buf.data(),
+            samples,
+            32767.f,
+            2 * chunk);
+      bytes = RCAST(const char *, m_cs16Buf.data());
+      size  = SCAST(qint64, 2 * chunk * sizeof(int16_t));
+    } else {
+      bytes = RCAST(const char *, samples);
+      size  = SCAST(qint64, 2 * chunk * sizeof(float));
+    }
+
+    if (file.write(bytes, size) != size) {
+      error = file.errorString();
+      return false;
+    }
+
+    done += chunk;
+    emit progress(done, total);
+  }
+
+  return true;
+}
+
+void
+WaveExportWorker::run(WaveExportRequest req)
+{
+  QString error;
+  bool ok;
+
+  if (req.format == WAVE_EXPORT_WAV)
+    ok = writeWav(req, error);
+  else
+    ok = writeRaw(req, error);
+
+  // Do not leave truncated files behind
+  if (!ok)
+    QFile::remove(req.path);
+
+  emit finished(req.path, ok, error);
+}
+
+//////////////////////////////// WaveExporter //////////////////////////////////
+WaveExporter::WaveExporter(QObject *parent) : QObject(parent)
+{
+  qRegisterMetaType<WaveExportRequest>("WaveExportRequest");
+
+  m_cancelFlag.store(false);
+
+  m_workerThread = new QThread(this);
+  m_worker       = new WaveExportWorker(&m_cancelFlag);
+
+  m_worker->moveToThread(m_workerThread);
+
+  connect(
+        this,
+        SIGNAL(triggerExport(WaveExportRequest)),
+        m_worker,
+        SLOT(run(WaveExportRequest)));
+
+  connect(
+        m_worker,
+        SIGNAL(progress(quint64, quint64)),
+        this,
+        SLOT(onProgress(quint64, quint64)));
+
+  connect(
+        m_worker,
+        SIGNAL(finished(QString, bool, QString)),
+        this,
+        SLOT(onFinished(QString, bool, QString)));
+
+  m_workerThread->start();
+}
+
+WaveExporter::~WaveExporter()
+{
+  cancel();
+
+  m_workerThread->quit();
+  m_workerThread->wait();
+
+  delete m_worker;
+}
+
+bool
+WaveExporter::exportRange(
+    const SUCOMPLEX *data,
+    qint64 start,
+    qint64 end,
+    qreal sampleRate,
+    QString const &path,
+    WaveExportFormat format)
+{
+  WaveExportRequest req;
+
+  if (m_busy || data == nullptr || start < 0 || end < start)
+    return false;
+
+  req.path       = path;
+  req.format     = format;
+  req.data       = data;
+  req.start      = start;
+  req.end        = end;
+  req.sampleRate = sampleRate;
+
+  m_cancelFlag.store(false);
+  m_busy = true;
+
+  emit triggerExport(req);
+
+  return true;
+}
+
+bool
+WaveExporter::exportSelection(
+    const Waveform *waveform,
+    QString const &path,
+    WaveExportFormat format)
+{
+  qint64 length = SCAST(qint64, waveform->getDataLength());
+  qint64 start, end;
+
+  if (!waveform->getHorizontalSelectionPresent())
+    return false;
+
+  start = SCAST(qint64, std::ceil(waveform->getHorizontalSelectionStart()));
+  end   = SCAST(qint64, std::floor(waveform->getHorizontalSelectionEnd()));
+
+  start = qMax(start, SCAST(qint64, 0));
+  end   = qMin(end, length - 1);
+
+  return exportRange(
+        waveform->getData(),
+        start,
+        end,
+        waveform->getSampleRate(),
+        path,
+        format);
+}
+
+void
+WaveExporter::cancel()
+{
+  if (m_busy)
+    m_cancelFlag.store(true);
+}
+
+void
+WaveExporter::onProgress(quint64 done, quint64 total)
+{
+  emit progress(done, total);
+}
+
+void
+WaveExporter::onFinished(QString path, bool ok, QString error)
+{
+  m_busy = false;
+  emit finished(path, ok, error);
+}
@@ -0,0 +1,129 @@
+//
+//    WaveExporter.h: Background export of waveform data
+//    Copyright (C) 2024 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef WAVEEXPORTER_H
+#define WAVEEXPORTER_H
+
+#include <QObject>
+#include <QThread>
+#include <QMetaType>
+#include <atomic>
+#include <vector>
+
+#include <sigutils/types.h>
+
+// Samples written per call
+#define WAVE_EXPORT_CHUNK_SIZE (1 << 20)
+
+enum WaveExportFormat {
+  WAVE_EXPORT_WAV,      // Stereo I/Q float WAV (RF64 above 4 GiB)
+  WAVE_EXPORT_RAW_CF32, // Interleaved 32-bit float I/Q
+  WAVE_EXPORT_RAW_CS16  // Interleaved 16-bit signed I/Q, full scale 1.0
+};
+
+struct WaveExportRequest {
+  QString          path;
+  WaveExportFormat format = WAVE_EXPORT_WAV;
+  const SUCOMPLEX *data  = nullptr;
+  qint64           start = 0;
+  qint64           end   = 0; // Inclusive
+  qreal            sampleRate = 0;
+};
+
+Q_DECLARE_METATYPE(WaveExportRequest)
+
+class Waveform;
+
+class WaveExportWorker : public QObject {
+  Q_OBJECT
+
+  const std::atomic<bool> *m_cancelFlag;
+  std::vector<int16_t>     m_cs16Buf;
+
+  bool writeWav(WaveExportRequest const &, QString &error);
+  bool writeRaw(WaveExportRequest const &, QString &error);
+
+public:
+  WaveExportWorker(
+      const std::atomic<bool> *cancelFlag,
+      QObject *parent = nullptr);
+  ~WaveExportWorker() override;
+
+public slots:
+  void run(WaveExportRequest);
+
+signals:
+  void progress(quint64, quint64);
+  void finished(QString path, bool ok, QString error);
+};
+
+//
+// WaveExporter streams a range of samples to disk from a worker thread.
+// Samples are read in place (only 16-bit exports need a conversion
+// buffer, of one chunk), so the export does not duplicate the data in
+// memory. Only one export runs at a time.
+//
+// As with the wave trees, the samples must stay valid until finished()
+// is emitted: cancel the export before releasing them.
+//
+class WaveExporter : public QObject {
+  Q_OBJECT
+
+  QThread          *m_workerThread = nullptr;
+  WaveExportWorker *m_worker = nullptr;
+  std::atomic<bool> m_cancelFlag;
+  bool              m_busy = false;
+
+public:
+  WaveExporter(QObject *parent = nullptr);
+  ~WaveExporter() override;
+
+  inline bool
+  isBusy() const
+  {
+    return m_busy;
+  }
+
+  bool exportRange(
+      const SUCOMPLEX *data,
+      qint64 start,
+      qint64 end,
+      qreal sampleRate,
+      QString const &path,
+      WaveExportFormat format = WAVE_EXPORT_WAV);
+
+  bool exportSelection(
+      const Waveform *waveform,
+      QString const &path,
+      WaveExportFormat format = WAVE_EXPORT_WAV);
+
+public slots:
+  void cancel();
+
+  // Private slots
+  void onProgress(quint64, quint64);
+  void onFinished(QString, bool, QString);
+
+signals:
+  void triggerExport(WaveExportRequest);
+
+  void progress(quint64 done, quint64 total);
+  void finished(QString path, bool ok, QString error);
+};
+
+#endif // WAVEEXPORTER_H
@@ -132,13 +132,27 @@ WaveView::setGeometry(int width, int height)
 }
 
 /////////////////////////////// Drawing methods ////////////////////////////////
+//
+// Inner loop of drawWaveClose(), specialized for every combination of
+// display flags so that they are not tested per sample, and magnitude and
+// phase are only computed when they are shown. Sample-to-pixel transforms
+// are linear, and are evaluated from their origin and slope.
+//
+template<bool Envelope, bool Phase, bool PhaseDiff, bool Wave, bool Samples>
 void
-WaveView::drawWaveClose(QPainter &p)
+WaveView::drawWaveCloseLoop(
+    QPainter &p,
+    qint64 firstSamp,
+    qint64 lastSamp,
+    qreal alpha)
 {
-  qreal firstSamp, lastSamp;
-  qint64 firstIntegerSamp, lastIntegerSamp;
-  SUSCOUNT length = m_waveTree->getLength();
   const SUCOMPLEX *data = m_waveTree->getData();
+  const SUFLOAT *component =
+      RCAST(const SUFLOAT *, data) + (m_realComponent ? 0 : 1);
+  qreal xOrigin = samp2px(SCAST(qreal, firstSamp));
+  qreal xSlope  = 1. / m_sampPerPx;
+  qreal yOrigin = value2px(0);
+  qreal ySlope  = -1. / m_unitsPerPx;
   int prevMinEnvY = 0;
   int prevMaxEnvY = 0;
   int nextX, currX, currY;
@@ -146,159 +160,208 @@ WaveView::drawWaveClose(QPainter &p)
   int pathX = 0;
 
   qreal prevPhase = 0;
-  qreal alpha = 1;
   bool havePrevEnv = false;
   bool havePrevWf  = false;
-  QColor color = m_foreground;
-  QColor darkenedForeground;
   int minEnvY = 0, maxEnvY = 0;
-  QPen pen;
-  bool paintSamples = m_sampPerPx < 1. / (2 * WAVEFORM_CIRCLE_DIM);
-
-  if (m_sampPerPx > 1)
-    alpha = sqrt(1. / m_sampPerPx);
-
-  pen.setColor(color);
-  pen.setStyle(Qt::SolidLine);
-  p.setPen(pen);
+  QPen wavePen(m_foreground);
 
-  // Initialize darkened foreground
-  if (m_showWaveform && !m_showPhase) {
-    darkenedForeground.setRed(m_foreground.red() / 3);
-    darkenedForeground.setGreen(m_foreground.green() / 3);
-    darkenedForeground.setBlue(m_foreground.blue() / 3);
+  if (Wave) {
+    p.setOpacity(alpha);
+    p.setPen(wavePen);
+    p.setBrush(QBrush(m_foreground));
   }
 
-  // Determine the representation range
-  firstSamp = px2samp(m_leftMargin);
-  lastSamp  = px2samp(m_width - 1);
-
-  firstIntegerSamp = SCAST(qint64, std::ceil(firstSamp));
-  lastIntegerSamp  = SCAST(qint64, std::floor(lastSamp));
+  nextX = SCAST(int, xOrigin);
+  for (qint64 i = firstSamp; i <= lastSamp; ++i) {
+    currX = nextX;
+    nextX = SCAST(int, xOrigin + SCAST(qreal, i + 1 - firstSamp) * xSlope);
 
-  if (firstIntegerSamp < 0)
-    firstIntegerSamp = 0;
+    // Draw envelope?
+    if (Envelope) {
+      // Determine limits
+      qreal mag    = SCAST(qreal, SU_C_ABS(data[i]));
+      qreal phase  = Phase ? SCAST(qreal, SU_C_ARG(data[i])) : 0;
 
-  if (lastIntegerSamp >= SCAST(qint64, length))
-    lastIntegerSamp = SCAST(qint64, length - 1);
+      int pxLower  = SCAST(int, yOrigin + mag * ySlope);
+      int pxUpper  = SCAST(int, yOrigin - mag * ySlope);
 
-  nextX = SCAST(int, samp2px(SCAST(qreal, firstIntegerSamp)));
-  for (qint64 i = firstIntegerSamp; i <= lastIntegerSamp; ++i) {
-    currX = nextX;
-    nextX = SCAST(int, samp2px(SCAST(qreal, i + 1)));
-    currY = SCAST(int, value2px(cast(data[i])));
-
-    if (i >= 0 && i < SCAST(qint64, length)) {
-      // Draw envelope?
-      if (m_showEnvelope) {
-        // Determine limits
-        qreal mag    = SCAST(qreal, SU_C_ABS(data[i]));
-        qreal phase  = SCAST(qreal, SU_C_ARG(data[i]));
-
-        int pxLower  = SCAST(int, value2px(+mag));
-        int pxUpper  = SCAST(int, value2px(-mag));
-
-        // Previous pixel column is not the same as next
-        //  Initialize limits
-        if (currX != prevX) {
+      // Previous pixel column is not the same as next
+      //  Initialize limits
+      if (currX != prevX) {
+        minEnvY = pxLower;
+        maxEnvY = pxUpper;
+        pathX   = prevX;
+      } else {
+        // If not: update limits
+        if (pxLower < minEnvY)
           minEnvY = pxLower;
+
+        if (pxUpper > maxEnvY)
           maxEnvY = pxUpper;
-          pathX   = prevX;
-        } else {
-          // If not: update limits
-          if (pxLower < minEnvY)
-            minEnvY = pxLower;
+      }
 
-          if (pxUpper > maxEnvY)
-            maxEnvY = pxUpper;
-        }
+      // Next pixel column will be different: time to draw line
+      if (currX != nextX) {
+        p.setPen(Qt::NoPen);
+        p.setOpacity(Wave ? .33 : 1.);
 
-        // Next pixel column will be different: time to draw line
-        if (currX != nextX) {
-          p.setPen(Qt::NoPen);
-          p.setOpacity(m_showWaveform ? .33 : 1.);
+        if (havePrevEnv) {
+          QPainterPath path;
 
-          if (havePrevEnv) {
-            QPainterPath path;
+          if (pathX != currX) {
+            path.moveTo(pathX, prevMinEnvY);
+            path.lineTo(currX, minEnvY);
+            path.lineTo(currX, maxEnvY);
+            path.lineTo(pathX, prevMaxEnvY);
+          }
 
-            if (pathX != currX) {
-              path.moveTo(pathX, prevMinEnvY);
-              path.lineTo(currX, minEnvY);
-              path.lineTo(currX, maxEnvY);
-              path.lineTo(pathX, prevMaxEnvY);
-            }
+          // Show phase?
+          if (Phase) {
+            if (PhaseDiff) {
+              // Display its first derivative (frequency)
+              qreal phaseDiff = phase - prevPhase;
+              if (phaseDiff < 0)
+                phaseDiff += 2. * SCAST(qreal, PI);
+              QColor diffColor = phaseDiff2Color(phaseDiff);
 
-            // Show phase?
-            if (m_showPhase) {
-              if (m_showPhaseDiff) {
-                // Display its first derivative (frequency)
-                qreal phaseDiff = phase - prevPhase;
-                if (phaseDiff < 0)
-                  phaseDiff += 2. * SCAST(qreal, PI);
-                QColor diffColor = phaseDiff2Color(phaseDiff);
-
-                if (pathX != currX) {
-                  p.fillPath(path, diffColor);
-                } else {
-                  p.setPen(diffColor);
-                  p.drawLine(currX, minEnvY, currX, maxEnvY);
-                }
+              if (pathX != currX) {
+                p.fillPath(path, diffColor);
               } else {
-                // Display it as-is
-                if (pathX != currX) {
-                  QLinearGradient gradient(prevX, 0, currX, 0);
-                  gradient.setColorAt(0, phaseToColor(prevPhase));
-                  gradient.setColorAt(1, phaseToColor(phase));
-                  p.fillPath(path, gradient);
-                } else {
-                  p.setPen( phaseToColor(phase));
-                  p.drawLine(currX, minEnvY, currX, maxEnvY);
-                }
-
+                p.setPen(diffColor);
+                p.drawLine(currX, minEnvY, currX, maxEnvY);
               }
             } else {
+              // Display it as-is
               if (pathX != currX) {
-                p.fillPath(path, m_foreground);
+                QLinearGradient gradient(prevX, 0, currX, 0);
+                gradient.setColorAt(0, phaseToColor(prevPhase));
+                gradient.setColorAt(1, phaseToColor(phase));
+                p.fillPath(path, gradient);
               } else {
-                p.setPen(m_foreground);
+                p.setPen( phaseToColor(phase));
                 p.drawLine(currX, minEnvY, currX, maxEnvY);
               }
             }
+          } else {
+            if (pathX != currX) {
+              p.fillPath(path, m_foreground);
+            } else {
+              p.setPen(m_foreground);
+              p.drawLine(currX, minEnvY, currX, maxEnvY);
+            }
           }
-
-          prevMinEnvY  = minEnvY;
-          prevMaxEnvY  = maxEnvY;
-          havePrevEnv = true;
         }
 
-        prevPhase  = phase;
+        prevMinEnvY  = minEnvY;
+        prevMaxEnvY  = maxEnvY;
+        havePrevEnv = true;
+
+        // The envelope changed the pen and the opacity
+        if (Wave) {
+          p.setOpacity(alpha);
+          p.setPen(wavePen);
+        }
       }
 
-      if (m_showWaveform) {
-        p.setOpacity(alpha);
+      if (Phase)
+        prevPhase = phase;
+    }
 
-        if (havePrevWf) {
-          p.setPen(QPen(m_foreground));
-          p.drawLine(prevX, prevY, currX, currY);
-        }
+    if (Wave) {
+      currY = SCAST(
+            int,
+            yOrigin + SCAST(qreal, component[2 * i]) * ySlope);
 
-        if (paintSamples) {
-          p.setBrush(QBrush(m_foreground));
-          p.drawEllipse(
-                currX - WAVEFORM_CIRCLE_DIM / 2,
-                currY - WAVEFORM_CIRCLE_DIM / 2,
-                WAVEFORM_CIRCLE_DIM,
-                WAVEFORM_CIRCLE_DIM);
-        }
-      }
+      if (havePrevWf)
+        p.drawLine(prevX, prevY, currX, currY);
+
+      if (Samples)
+        p.drawEllipse(
+              currX - WAVEFORM_CIRCLE_DIM / 2,
+              currY - WAVEFORM_CIRCLE_DIM / 2,
+              WAVEFORM_CIRCLE_DIM,
+              WAVEFORM_CIRCLE_DIM);
+
+      prevY = currY;
     }
 
     prevX      = currX;
-    prevY      = currY;
     havePrevWf = true;
   }
 }
 
+template<bool Envelope, bool Phase, bool PhaseDiff>
+void
+WaveView::drawWaveCloseWave(
+    QPainter &p,
+    qint64 firstSamp,
+    qint64 lastSamp,
+    qreal alpha,
+    bool paintSamples)
+{
+  if (!m_showWaveform)
+    drawWaveCloseLoop<Envelope, Phase, PhaseDiff, false, false>(
+          p, firstSamp, lastSamp, alpha);
+  else if (paintSamples)
+    drawWaveCloseLoop<Envelope, Phase, PhaseDiff, true, true>(
+          p, firstSamp, lastSamp, alpha);
+  else
+    drawWaveCloseLoop<Envelope, Phase, PhaseDiff, true, false>(
+          p, firstSamp, lastSamp, alpha);
+}
+
+void
+WaveView::drawWaveClose(QPainter &p)
+{
+  qreal firstSamp, lastSamp;
+  qint64 firstIntegerSamp, lastIntegerSamp;
+  SUSCOUNT length = m_waveTree->getLength();
+  qreal alpha = 1;
+  QPen pen;
+  bool paintSamples = m_sampPerPx < 1. / (2 * WAVEFORM_CIRCLE_DIM);
+
+  if (!m_showEnvelope && !m_showWaveform)
+    return;
+
+  if (m_sampPerPx > 1)
+    alpha = sqrt(1. / m_sampPerPx);
+
+  pen.setColor(m_foreground);
+  pen.setStyle(Qt::SolidLine);
+  p.setPen(pen);
+
+  // Determine the representation range. When drawing a few columns only,
+  // start one sample earlier so that lines connect with the previous ones.
+  if (m_drawFrom > m_leftMargin)
+    firstSamp = px2samp(m_drawFrom - 1) - 1;
+  else
+    firstSamp = px2samp(m_leftMargin);
+
+  lastSamp  = px2samp(qMin(m_width - 1, m_drawTo));
+
+  firstIntegerSamp = SCAST(qint64, std::ceil(firstSamp));
+  lastIntegerSamp  = SCAST(qint64, std::floor(lastSamp));
+
+  if (firstIntegerSamp < 0)
+    firstIntegerSamp = 0;
+
+  if (lastIntegerSamp >= SCAST(qint64, length))
+    lastIntegerSamp = SCAST(qint64, length - 1);
+
+  if (!m_showEnvelope)
+    drawWaveCloseWave<false, false, false>(
+          p, firstIntegerSamp, lastIntegerSamp, alpha, paintSamples);
+  else if (!m_showPhase)
+    drawWaveCloseWave<true, false, false>(
+          p, firstIntegerSamp, lastIntegerSamp, alpha, paintSamples);
+  else if (!m_showPhaseDiff)
+    drawWaveCloseWave<true, true, false>(
+          p, firstIntegerSamp, lastIntegerSamp, alpha, paintSamples);
+  else
+    drawWaveCloseWave<true, true, true>(
+          p, firstIntegerSamp, lastIntegerSamp, alpha, paintSamples);
+}
+
 // Draw wave far away. We will use a different approach: since we already have
 // range information, we exploit it in order to know what to paint, and
 // how
@@ -325,8 +388,8 @@ WaveView::drawWaveFar(QPainter &p, int level)
   // Initialize darkened foreground
 
   // Determine the representation range
-  firstSamp = px2samp(m_leftMargin);
-  lastSamp  = px2samp(m_width - 1);
+  firstSamp = px2samp(qMax(m_leftMargin, m_drawFrom - 1));
+  lastSamp  = px2samp(qMin(m_width - 1, m_drawTo));
 
   firstBlock = SCAST(qint64, std::ceil(firstSamp)) >> bits;
   lastBlock  = SCAST(qint64, std::floor(lastSamp)) >> bits;
@@ -450,6 +513,8 @@ WaveView::drawWave(QPainter &painter)
 {
   setGeometry(painter.device()->width(), painter.device()->height());
 
+  m_drewLowDetail = false;
+
   if (!m_waveTree->isComplete()) {
     QFont font;
     QFontMetrics metrics(font);
@@ -506,6 +571,10 @@ WaveView::drawWave(QPainter &painter)
     level = SCAST(
           int,
           floor(log(m_sampPerPx) / log(WAVEFORM_BLOCK_LENGTH))) - 1;
+    if (m_lowDetail && level + 1 < m_waveTree->size()) {
+      ++level;
+      m_drewLowDetail = true;
+    }
     if (level >= m_waveTree->size())
       level = m_waveTree->size() - 1;
 
@@ -516,6 +585,327 @@ WaveView::drawWave(QPainter &painter)
   painter.restore();
 }
 
+// Draw only the pixel columns in [fromPx, toPx). The rest of the
+// painter's device is left untouched.
+void
+WaveView::drawWave(QPainter &painter, int fromPx, int toPx)
+{
+  painter.save();
+  painter.setClipRect(fromPx, 0, toPx - fromPx, painter.device()->height());
+
+  m_drawFrom = fromPx;
+  m_drawTo   = toPx;
+
+  drawWave(painter);
+
+  m_drawFrom = 0;
+  m_drawTo   = std::numeric_limits<int>::max();
+
+  painter.restore();
+}
+
+/////////////////////////////// Multi-trace drawing ////////////////////////////
+//
+// All traces are drawn in the same traversal: for every sample (or block)
+// index, each trace reads its own tree and accumulates its pixel column.
+// Lines are batched per trace and sent to the painter once.
+//
+struct WaveTraceState {
+  const WaveViewTree *tree = nullptr;
+  const WaveTrace    *trace = nullptr;
+  qint64              length = 0;
+  qreal               top    = 0; // Pixel row of trace.max
+  qreal               scale  = 1; // Pixels per unit
+  int                 minY = 0, maxY = 0;
+  int                 prevYA = 0, prevYB = 0;
+  bool                havePrev = false;
+  QVector<QLine>      lines;
+  QVector<QPointF>    points;
+
+  inline qreal
+  value2px(qreal val) const
+  {
+    return top + (trace->max - val) * scale;
+  }
+};
+
+static inline qreal
+traceValue(WaveTraceComponent component, SUCOMPLEX z)
+{
+  switch (component) {
+    case WAVE_TRACE_IMAG:
+      return SCAST(qreal, SU_C_IMAG(z));
+
+    case WAVE_TRACE_MAGNITUDE:
+      return SCAST(qreal, SU_C_ABS(z));
+
+    case WAVE_TRACE_PHASE:
+      return SCAST(qreal, SU_C_ARG(z));
+
+    default:
+      return SCAST(qreal, SU_C_REAL(z));
+  }
+}
+
+// Blocks only keep the magnitude peak and the mean. Magnitude and phase
+// traces are drawn as the curves of these at far zoom levels.
+static inline void
+traceLimits(
+    WaveTraceComponent component,
+    WaveLimits const &z,
+    qreal &lo,
+    qreal &hi)
+{
+  switch (component) {
+    case WAVE_TRACE_IMAG:
+      lo = SCAST(qreal, SU_C_IMAG(z.min));
+      hi = SCAST(qreal, SU_C_IMAG(z.max));
+      break;
+
+    case WAVE_TRACE_MAGNITUDE:
+      lo = hi = SCAST(qreal, z.envelope);
+      break;
+
+    case WAVE_TRACE_PHASE:
+      lo = hi = SCAST(qreal, SU_C_ARG(z.mean));
+      break;
+
+    default:
+      lo = SCAST(qreal, SU_C_REAL(z.min));
+      hi = SCAST(qreal, SU_C_REAL(z.max));
+  }
+}
+
+void
+WaveView::drawTracesClose(
+    QPainter &p,
+    QList<WaveTrace> const &traces,
+    int lanes)
+{
+  std::vector<WaveTraceState> states;
+  qreal laneHeight = SCAST(qreal, m_height) / lanes;
+  qint64 firstSamp, lastSamp, maxLength = 0;
+  qreal alpha = 1;
+
+  if (m_sampPerPx > 1)
+    alpha = sqrt(1. / m_sampPerPx);
+
+  states.resize(SCAST(size_t, traces.size()));
+
+  for (int t = 0; t < traces.size(); ++t) {
+    WaveTraceState &s = states[SCAST(size_t, t)];
+    WaveTrace const &trace = traces[t];
+    qreal range = trace.max - trace.min;
+
+    s.trace  = &trace;
+    s.tree   = trace.tree != nullptr ? trace.tree : m_waveTree;
+    s.length = SCAST(qint64, s.tree->getLength());
+    s.top    = lanes > 1 ? trace.lane * laneHeight : 0;
+    s.scale  = range > 0 ? (laneHeight - 1) / range : 1;
+
+    if (s.length > maxLength)
+      maxLength = s.length;
+  }
+
+  firstSamp = qMax(
+        SCAST(qint64, 0),
+        SCAST(qint64, std::ceil(px2samp(m_leftMargin))) - 1);
+  lastSamp  = qMin(
+        maxLength - 1,
+        SCAST(qint64, std::floor(px2samp(m_width - 1))) + 1);
+
+  for (auto &s : states)
+    s.points.reserve(SCAST(int, qMax(lastSamp - firstSamp + 1, SCAST(qint64, 0))));
+
+  for (qint64 i = firstSamp; i <= lastSamp; ++i) {
+    qreal x = samp2px(SCAST(qreal, i));
+
+    for (auto &s : states) {
+      if (i < s.length)
+        s.points.append(
+              QPointF(
+                x,
+                s.value2px(
+                  traceValue(s.trace->component, s.tree->getData()[i]))));
+    }
+  }
+
+  p.setOpacity(alpha);
+  for (auto &s : states) {
+    p.setPen(QPen(s.trace->color));
+    p.drawPolyline(s.points.constData(), s.points.size());
+  }
+}
+
+void
+WaveView::drawTracesFar(
+    QPainter &p,
+    QList<WaveTrace> const &traces,
+    int lanes,
+    int level)
+{
+  std::vector<WaveTraceState> states;
+  qreal laneHeight = SCAST(qreal, m_height) / lanes;
+  qreal firstSamp, lastSamp;
+  qint64 firstBlock, lastBlock, maxBlocks = 0;
+  int bits = (level + 1) * WAVEFORM_BLOCK_BITS;
+  int nextX, currX, prevX = -1;
+
+  states.resize(SCAST(size_t, traces.size()));
+
+  for (int t = 0; t < traces.size(); ++t) {
+    WaveTraceState &s = states[SCAST(size_t, t)];
+    WaveTrace const &trace = traces[t];
+    qreal range = trace.max - trace.min;
+
+    s.trace  = &trace;
+    s.tree   = trace.tree != nullptr ? trace.tree : m_waveTree;
+    s.length = SCAST(qint64, (*s.tree)[level].size());
+    s.top    = lanes > 1 ? trace.lane * laneHeight : 0;
+    s.scale  = range > 0 ? (laneHeight - 1) / range : 1;
+
+    if (s.length > maxBlocks)
+      maxBlocks = s.length;
+  }
+
+  firstSamp = px2samp(m_leftMargin);
+  lastSamp  = px2samp(m_width - 1);
+
+  firstBlock = qMax(
+        SCAST(qint64, 0),
+        SCAST(qint64, std::ceil(firstSamp)) >> bits);
+  lastBlock  = qMin(
+        maxBlocks - 1,
+        SCAST(qint64, std::floor(lastSamp)) >> bits);
+
+  nextX = SCAST(int, samp2px(SCAST(qreal, firstBlock << bits)));
+
+  for (qint64 i = firstBlock; i <= lastBlock; ++i) {
+    qint64 samp = i << bits;
+
+    currX = nextX;
+    nextX = SCAST(int, samp2px(SCAST(qreal, samp + (1 << bits))));
+
+    for (auto &s : states) {
+      qreal lo, hi;
+      int yA, yB;
+
+      if (i >= s.length)
+        continue;
+
+      traceLimits(
+            s.trace->component,
+            (*s.tree)[level][SCAST(size_t, i)],
+            lo,
+            hi);
+
+      yA = SCAST(int, s.value2px(lo));
+      yB = SCAST(int, s.value2px(hi));
+
+      // Same column logic as drawWaveFar
+      if (currX != prevX) {
+        if (s.havePrev) {
+          s.minY = MIN(yB, s.prevYA);
+          s.maxY = MAX(yA, s.prevYB);
+        } else {
+          s.minY = yB;
+          s.maxY = yA;
+        }
+      } else {
+        if (s.minY > yB)
+          s.minY = yB;
+
+        if (s.maxY < yA)
+          s.maxY = yA;
+      }
+
+      if (currX != nextX)
+        s.lines.append(QLine(currX, s.minY, currX, s.maxY));
+
+      s.prevYA   = yA;
+      s.prevYB   = yB;
+      s.havePrev = true;
+    }
+
+    prevX = currX;
+  }
+
+  p.setOpacity(.66);
+  for (auto &s : states) {
+    p.setPen(QPen(s.trace->color));
+    p.drawLines(s.lines);
+  }
+}
+
+void
+WaveView::drawTraces(
+    QPainter &painter,
+    QList<WaveTrace> const &traces,
+    int lanes)
+{
+  QList<WaveTrace> complete;
+  int levels = -1;
+
+  m_drewLowDetail = false;
+
+  if (lanes < 1)
+    lanes = 1;
+
+  // Same status message as in the single-trace case
+  if (!m_waveTree->isComplete()) {
+    drawWave(painter);
+    return;
+  }
+
+  setGeometry(painter.device()->width(), painter.device()->height());
+
+  // Traces from other trees that are still being processed are skipped
+  for (auto const &trace : traces) {
+    const WaveViewTree *tree = trace.tree != nullptr ? trace.tree : m_waveTree;
+
+    if (!tree->isComplete())
+      continue;
+
+    if (levels < 0 || tree->size() < levels)
+      levels = tree->size();
+
+    complete.append(trace);
+  }
+
+  if (levels < 0)
+    return;
+
+  painter.save();
+  if (m_sampPerPx > 8.) {
+    int level;
+
+    if (levels == 0) {
+      painter.restore();
+      return;
+    }
+
+    level = SCAST(
+          int,
+          floor(log(m_sampPerPx) / log(WAVEFORM_BLOCK_LENGTH))) - 1;
+    if (m_lowDetail && level >= 0 && level + 1 < levels) {
+      ++level;
+      m_drewLowDetail = true;
+    }
+
+    if (level < 0)
+      level = 0;
+
+    // Traces share the block size, so the shallowest tree rules
+    if (level >= levels)
+      level = levels - 1;
+
+    drawTracesFar(painter, complete, lanes, level);
+  } else {
+    drawTracesClose(painter, complete, lanes);
+  }
+  painter.restore();
+}
+
 void
 WaveView::safeCancel()
 {
@@ -21,6 +21,28 @@
 
 #include <QPainter>
 #include <WaveViewTree.h>
+#include <limits>
+
+enum WaveTraceComponent {
+  WAVE_TRACE_REAL,
+  WAVE_TRACE_IMAG,
+  WAVE_TRACE_MAGNITUDE,
+  WAVE_TRACE_PHASE
+};
+
+//
+// One trace of a multi-trace view. Traces may come from this view's tree
+// or from other trees sharing the same time axis (e.g. other channels of
+// the same capture). Foreign trees must outlive the view that draws them.
+//
+struct WaveTrace {
+  const WaveViewTree *tree = nullptr; // nullptr: use the view's own tree
+  WaveTraceComponent component = WAVE_TRACE_REAL;
+  QColor color = QColor(0xff, 0xff, 0x00);
+  qreal  min  = -1;
+  qreal  max  = +1;
+  int    lane = 0; // Vertical lane, only in stacked mode
+};
 
 class WaveView : public QObject {
   Q_OBJECT
@@ -52,6 +74,10 @@ class WaveView : public QObject {
   int   m_height = 1;
   int   m_width  = 1;
 
+  // Pixel columns to draw, [m_drawFrom, m_drawTo)
+  int   m_drawFrom = 0;
+  int   m_drawTo   = std::numeric_limits<int>::max();
+
   // Cached data
   uint64_t m_lastProgressCurr = 0;
   uint64_t m_lastProgressMax = 0;
@@ -65,7 +91,9 @@ class WaveView : public QObject {
   bool m_showEnvelope  = false;
   bool m_showPhase     = false;
   bool m_showPhaseDiff = false;
-  bool m_pad[3];
+  bool m_lowDetail     = false;
+  bool m_drewLowDetail = false; // The last draw used a coarser level
+  bool m_pad[1];
 
   // Color palette
   QColor m_colorTable[256];
@@ -80,8 +108,14 @@ class WaveView : public QObject {
     return m_colorTable[(index + m_phaseDiffOrigin) & 0xff];
   }
 
+  template<bool Envelope, bool Phase, bool PhaseDiff, bool Wave, bool Samples>
+  void drawWaveCloseLoop(QPainter &, qint64 firstSamp, qint64 lastSamp, qreal alpha);
+  template<bool Envelope, bool Phase, bool PhaseDiff>
+  void drawWaveCloseWave(QPainter &, qint64, qint64, qreal, bool paintSamples);
   void drawWaveClose(QPainter &painter);
   void drawWaveFar(QPainter &painter, int level);
+  void drawTracesClose(QPainter &painter, QList<WaveTrace> const &, int);
+  void drawTracesFar(QPainter &painter, QList<WaveTrace> const &, int, int);
 
 public:
   // Inlined methods
@@ -303,6 +337,21 @@ public:
     m_phaseDiffContrast = contrast;
   }
 
+  // Zoomed-out waves are drawn from a coarser level of the tree
+  inline void
+  setLowDetail(bool lowDetail)
+  {
+    m_lowDetail = lowDetail;
+  }
+
+  // Whether low detail actually changed the level of the last draw. It
+  // does not at close zoom, or if there is no coarser level.
+  inline bool
+  drewLowDetail() const
+  {
+    return m_drewLowDetail;
+  }
+
   inline void
   setShowWaveForm(bool show)
   {
@@ -345,6 +394,25 @@ public:
     m_waveTree->computeLimits(start, end, limits);
   }
 
+  inline const WaveViewTree *
+  getWaveTree(void) const
+  {
+    return m_waveTree;
+  }
+
+  // Borrowed trees are accounted for by their owner
+  inline quint64
+  treeMemoryUsage(void) const
+  {
+    return m_waveTree == &m_ownWaveTree ? m_ownWaveTree.memoryUsage() : 0;
+  }
+
+  inline quint64
+  compactTree(void)
+  {
+    return m_waveTree == &m_ownWaveTree ? m_ownWaveTree.compact() : 0;
+  }
+
   inline int
   width() const
   {
@@ -370,6 +438,11 @@ public:
   void setGeometry(int width, int height);
   void borrowTree(WaveView &);
   void drawWave(QPainter &painter);
+  void drawWave(QPainter &painter, int fromPx, int toPx);
+  void drawTraces(
+      QPainter &painter,
+      QList<WaveTrace> const &traces,
+      int lanes = 1);
   void setBuffer(const std::vector<SUCOMPLEX> *);
   void setBuffer(const SUCOMPLEX *, size_t);
 
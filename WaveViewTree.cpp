@@ -492,6 +492,46 @@ WaveViewTree::clear(void)
   return true;
 }
 
+//
+// Called periodically from the GUI thread. While a worker is building
+// the tree it appends to the levels, so the last known size is reported
+// instead of walking them.
+//
+quint64
+WaveViewTree::memoryUsage(void) const
+{
+  quint64 bytes = 0;
+
+  if (isRunning() || !isComplete())
+    return m_lastMemoryUsage;
+
+  for (auto const &level : *this)
+    bytes += level.capacity() * sizeof(WaveLimits);
+
+  m_lastMemoryUsage = bytes;
+
+  return bytes;
+}
+
+//
+// Levels grow by resize() as samples are appended, which leaves spare
+// capacity behind. Release it, but only while the tree is idle: workers
+// write to these vectors.
+//
+quint64
+WaveViewTree::compact(void)
+{
+  quint64 before = memoryUsage();
+
+  if (isRunning() || !isComplete())
+    return 0;
+
+  for (auto &level : *this)
+    level.shrink_to_fit();
+
+  return before - memoryUsage();
+}
+
 bool
 WaveViewTree::reprocess(const SUCOMPLEX *data, SUSCOUNT newLength)
 {
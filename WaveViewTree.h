@@ -68,6 +68,9 @@ class WaveViewTree : public QObject, public QList<WaveLimitVector> {
 
   bool             m_complete = true;
 
+  // Last size of the levels measured while no worker was writing them
+  mutable quint64  m_lastMemoryUsage = 0;
+
   friend class WaveWorker;
 
   static void calcLimitsBuf(
@@ -136,6 +139,8 @@ public:
 
   bool reprocess(const SUCOMPLEX *, SUSCOUNT newLength);
   bool clear(void);
+  quint64 memoryUsage(void) const;
+  quint64 compact(void);
   void safeCancel(void);
   void computeLimitsFar(
       WaveViewTree::const_iterator p,
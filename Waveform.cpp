@@ -23,7 +23,9 @@
 #include <QColormap>
 #include <QApplication>
 #include <SuWidgetsHelpers.h>
+#include "SuWidgetsRecorder.h"
 #include <assert.h>
+#include <cstring>
 
 ////////////////////////// WaveBuffer methods //////////////////////////////////
 void
@@ -147,6 +149,70 @@ WaveBuffer::loanedBuffer() const
   return m_buffer;
 }
 
+//////////////////////// WaveAxisLabelCache methods ////////////////////////////
+void
+WaveAxisLabelCache::configure(
+    QString const &units,
+    bool absolute,
+    QColor const &foreground,
+    QColor const &background)
+{
+  if (units != m_units
+      || absolute != m_absolute
+      || foreground != m_foreground
+      || background != m_background) {
+    m_units      = units;
+    m_absolute   = absolute;
+    m_foreground = foreground;
+    m_background = background;
+    m_labels.clear();
+  }
+}
+
+WaveAxisLabel const &
+WaveAxisLabelCache::label(QFont const &font, qreal value, qreal delta)
+{
+  QPair<qreal, qreal> key(value, m_absolute ? 0 : delta);
+  auto it = m_labels.find(key);
+
+  if (it == m_labels.end()) {
+    QFontMetrics metrics(font);
+    WaveAxisLabel label;
+    QString text;
+    QPainter p;
+
+    if (m_labels.size() >= WAVEFORM_MAX_CACHED_LABELS)
+      m_labels.clear();
+
+    if (m_absolute)
+      text = SuWidgetsHelpers::formatQuantity(value, 0, m_units);
+    else
+      text = SuWidgetsHelpers::formatQuantityFromDelta(value, delta, m_units);
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
+    label.width = metrics.horizontalAdvance(text);
+#else
+    label.width = metrics.width(text);
+#endif // QT_VERSION_CHECK
+
+    label.pixmap = QPixmap(qMax(label.width, 1), metrics.height());
+    label.pixmap.fill(m_background);
+
+    p.begin(&label.pixmap);
+    p.setFont(font);
+    p.setPen(m_foreground);
+    p.drawText(
+          QRect(0, 0, label.width, metrics.height()),
+          Qt::AlignHCenter | Qt::AlignBottom,
+          text);
+    p.end();
+
+    it = m_labels.insert(key, label);
+  }
+
+  return *it;
+}
+
 ////////////////////////// Geometry methods ////////////////////////////////////
 void
 Waveform::recalculateDisplayData()
@@ -257,7 +323,11 @@ Waveform::zoomHorizontal(qint64 start, qint64 end)
     if (m_hSelection)
       m_selUpdated = false;
     m_axesDrawn = false;
-    recalculateDisplayData();
+
+    // When scrolling, divisions (and therefore labels) remain the same
+    if (end - start != currEnd - currStart)
+      recalculateDisplayData();
+
     emit horizontalRangeChanged(start, end);
   }
 }
@@ -461,6 +531,9 @@ Waveform::mouseMoveEvent(QMouseEvent *event)
   m_currMouseX = event->x();
 #endif
 
+  if (m_frequencyDragging || m_valueDragging)
+    beginInteraction();
+
   if (m_frequencyDragging)
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
     scrollHorizontal(m_clickX, event->position().x());
@@ -583,6 +656,8 @@ Waveform::wheelEvent(QWheelEvent *event)
     qreal amount = std::pow(
           static_cast<qreal>(1.1),
           static_cast<qreal>(-delta / 120.));
+
+    beginInteraction();
     if (x < m_valueTextWidth) {
       if (!m_autoFitToEnvelope)
         zoomVertical(static_cast<qint64>(y), amount);
@@ -875,12 +950,113 @@ Waveform::drawWave()
   m_waveform.fill(Qt::transparent);
   QPainter p(&m_waveform);
 
+  m_view.setLowDetail(isInteracting());
+
+  overlayACursors(p);
+  if (m_traces.isEmpty()) {
+    m_view.drawWave(p);
+  } else {
+    int lanes = 1;
+
+    if (m_stackedTraces)
+      for (auto const &trace : m_traces)
+        lanes = qMax(lanes, trace.lane + 1);
+
+    m_view.drawTraces(p, m_traces, lanes);
+  }
+  overlayMarkers(p);
+  overlayVCursors(p);
+  overlayPoints(p);
+  p.end();
+
+  m_drawnStart     = getSampleStart();
+  m_drawnEnd       = getSampleEnd();
+  m_drawnMin       = getMin();
+  m_drawnMax       = getMax();
+  m_drawnLength    = SCAST(qint64, getDataLength());
+  m_drawnComplete  = isComplete();
+  m_drawnLowDetail = m_view.drewLowDetail();
+  m_rollResidual   = 0;
+}
+
+//
+// In auto-scroll mode, new samples enter the view from the right and the old
+// ones move to the left. If nothing else changed since the last redraw, we
+// can simply shift the waveform image and draw the newly exposed columns.
+//
+bool
+Waveform::rollWave()
+{
+  int width = m_waveform.width();
+  qint64 start = getSampleStart();
+  qint64 end   = getSampleEnd();
+  qreal spp    = getSamplesPerPixel();
+  qreal exact;
+  int shift, from;
+
+  if (!m_drawnComplete || !isComplete())
+    return false;
+
+  // Coarse images are not worth keeping
+  if (m_drawnLowDetail)
+    return false;
+
+  // Multi-trace images are always drawn in full
+  if (!m_traces.isEmpty())
+    return false;
+
+  if (m_drawnEnd >= m_drawnLength)
+    return false;
+
+  if (end - start != m_drawnEnd - m_drawnStart || spp <= 0)
+    return false;
+
+  if (getMin() != m_drawnMin || getMax() != m_drawnMax)
+    return false;
+
+  if (m_view.width() != width
+      || m_waveform.format() != QImage::Format_ARGB32)
+    return false;
+
+  // Keep track of the fractional part, so that the image does not drift
+  // with respect to the samples after many small scrolls
+  exact = SCAST(qreal, start - m_drawnStart) / spp + m_rollResidual;
+  shift = SCAST(int, std::round(exact));
+
+  if (shift < 0 || shift >= width - WAVEFORM_ROLL_OVERLAP)
+    return false;
+
+  // Redraw a few columns more than the exposed ones, lines joining the
+  // last old samples with the new ones must be completed
+  from = width - shift - WAVEFORM_ROLL_OVERLAP;
+
+  for (int y = 0; y < m_waveform.height(); ++y) {
+    uchar *line = m_waveform.scanLine(y);
+
+    if (shift > 0)
+      memmove(line, line + 4 * shift, SCAST(size_t, 4 * (width - shift)));
+    memset(line + 4 * from, 0, SCAST(size_t, 4 * (width - from)));
+  }
+
+  QPainter p(&m_waveform);
+  p.setClipRect(from, 0, width - from, m_waveform.height());
+
+  m_view.setLowDetail(isInteracting());
+
   overlayACursors(p);
-  m_view.drawWave(p);
+  m_view.drawWave(p, from, width);
+  m_drawnLowDetail = m_view.drewLowDetail();
   overlayMarkers(p);
   overlayVCursors(p);
   overlayPoints(p);
   p.end();
+
+  m_drawnStart   = start;
+  m_drawnEnd     = end;
+  m_drawnLength  = SCAST(qint64, getDataLength());
+  m_rollResidual = exact - shift;
+
+  return true;
 }
 
 static inline int
@@ -901,7 +1077,6 @@ Waveform::drawVerticalAxes()
   QFont font;
   QPainter p(&m_axesPixmap);
   QFontMetrics metrics(font);
-  QRect rect;
   QPen pen(m_axes);
   qreal deltaT = m_view.getDeltaT();
   int axis;
@@ -909,6 +1084,8 @@ Waveform::drawVerticalAxes()
   bool unixTime = m_horizontalUnits == "unix";
   int previousLabel = -1;
 
+  m_hLabelCache.configure(m_horizontalUnits, unixTime, m_text, Qt::transparent);
+
   pen.setStyle(Qt::DotLine);
   p.setPen(pen);
   p.setFont(font);
@@ -937,29 +1114,24 @@ Waveform::drawVerticalAxes()
       px = static_cast<int>(samp2px(axis * m_hDivSamples - rem));
 
       if (px > 0) {
-        QString label;
+        qreal value = (m_oX + axis * m_hDivSamples - rem) * deltaT;
         int tw;
 
         if (unixTime)
-          label = SuWidgetsHelpers::formatQuantity(
-                (m_oX + axis * m_hDivSamples - rem) * deltaT + m_view.samp2t(0),
-                0,
-                m_horizontalUnits);
-        else
-          label = SuWidgetsHelpers::formatQuantityFromDelta(
-                (m_oX + axis * m_hDivSamples - rem) * deltaT,
-                m_hDivSamples * deltaT,
-                m_horizontalUnits);
+          value += m_view.samp2t(0);
+
+        WaveAxisLabel const &label = m_hLabelCache.label(
+              font,
+              value,
+              m_hDivSamples * deltaT);
 
-        tw = estimateTextWidth(metrics, label);
+        tw = label.width;
 
         if (previousLabel == -1 || previousLabel < px - tw / 2) {
-          rect.setRect(
+          p.drawPixmap(
                 px - tw / 2,
                 m_geometry.height() - m_frequencyTextHeight,
-                tw,
-                m_frequencyTextHeight);
-          p.drawText(rect, Qt::AlignHCenter | Qt::AlignBottom, label);
+                label.pixmap);
           previousLabel = px + tw / 2;
         }
       }
@@ -985,11 +1157,12 @@ Waveform::drawHorizontalAxes()
   QFont font;
   QPainter p(&m_axesPixmap);
   QFontMetrics metrics(font);
-  QRect rect;
   QPen pen(m_axes);
   int axis;
   int px;
 
+  m_vLabelCache.configure(m_verticalUnits, false, m_text, m_background);
+
   p.setPen(pen);
   p.setFont(font);
 
@@ -1012,24 +1185,12 @@ Waveform::drawHorizontalAxes()
       px = static_cast<int>(value2px(axis * m_vDivUnits));
 
       if (px > 0) {
-        QString label;
-        int tw;
-
-        label = SuWidgetsHelpers::formatQuantityFromDelta(
+        WaveAxisLabel const &label = m_vLabelCache.label(
+              font,
               axis * m_vDivUnits,
-              m_vDivUnits,
-              m_verticalUnits);
-
-        tw = estimateTextWidth(metrics, label);
-
-        rect.setRect(
-              0,
-              px - metrics.height() / 2,
-              tw,
-              metrics.height());
+              m_vDivUnits);
 
-        p.fillRect(rect, m_background);
-        p.drawText(rect, Qt::AlignHCenter | Qt::AlignBottom, label);
+        p.drawPixmap(0, px - metrics.height() / 2, label.pixmap);
       }
       ++axis;
     }
@@ -1175,12 +1336,16 @@ Waveform::draw()
     recalculateDisplayData();
     m_selUpdated = false;
     m_axesDrawn  = false;
-    m_waveDrawn  = false;
+    invalidateWave();
   } else if (!isComplete() && !m_enableFeedback) {
     // If we were called because we need to redraw something, but we
     // explicitly disabled feedback and there is a previous waveform
     // image that we can reuse, we wait for later to redraw everything
     return;
+  } else if (m_rollPending && !isComplete()) {
+    // New samples are still being processed. Keep the current image
+    // until they are ready, so that we can scroll it.
+    return;
   }
 
   //
@@ -1195,7 +1360,9 @@ Waveform::draw()
     }
 
     if (!m_waveDrawn) {
-      drawWave();
+      if (!m_rollPending || !rollWave())
+        drawWave();
+      m_rollPending = false;
       m_waveDrawn = true;
     }
 
@@ -1238,12 +1405,60 @@ Waveform::paint()
   painter.end();
 }
 
+void
+Waveform::interactionFinished()
+{
+  if (m_drawnLowDetail) {
+    invalidateWave();
+    invalidate();
+  }
+}
+
 void
 Waveform::reuseDisplayData(Waveform *other)
 {
   m_view.borrowTree(other->m_view);
 }
 
+//
+// Trees of other channels are watched, so that their traces are redrawn
+// as soon as they are (re)processed.
+//
+void
+Waveform::setTraces(QList<WaveTrace> const &traces)
+{
+  for (auto const &trace : m_traces)
+    if (trace.tree != nullptr)
+      disconnect(trace.tree, nullptr, this, SLOT(onTraceTreeChanges()));
+
+  m_traces = traces;
+
+  for (auto const &trace : m_traces)
+    if (trace.tree != nullptr)
+      connect(
+            trace.tree,
+            SIGNAL(ready()),
+            this,
+            SLOT(onTraceTreeChanges()),
+            Qt::UniqueConnection);
+
+  invalidateWave();
+  invalidate();
+}
+
+void
+Waveform::setStackedTraces(bool stacked)
+{
+  if (m_stackedTraces != stacked) {
+    m_stackedTraces = stacked;
+
+    if (!m_traces.isEmpty()) {
+      invalidateWave();
+      invalidate();
+    }
+  }
+}
+
 void
 Waveform::setData(
     const std::vector<SUCOMPLEX> *data,
@@ -1272,6 +1487,12 @@ Waveform::setData(
     else
       m_data = WaveBuffer(&m_view);
   }
+
+  if (SuWidgetsRecorder::isRecording()) {
+    if (!appending)
+      m_recordedLength = 0;
+    recordIngest(false, keepView, flush);
+  }
 }
 
 void
@@ -1302,6 +1523,54 @@ Waveform::setData(
     else
       m_data = WaveBuffer(&m_view);
   }
+
+  if (SuWidgetsRecorder::isRecording()) {
+    if (!appending)
+      m_recordedLength = 0;
+    recordIngest(false, keepView, flush);
+  }
+}
+
+//
+// Only the samples appended since the last recorded call are written, so
+// that traces of growing captures do not grow quadratically.
+//
+void
+Waveform::recordIngest(bool refresh, bool keepView, bool flush)
+{
+  qint64 length = SCAST(qint64, getDataLength());
+  qint64 from;
+
+  if (m_recordedSession != SuWidgetsRecorder::session()) {
+    m_recordedSession = SuWidgetsRecorder::session();
+    m_recordedLength  = 0;
+  }
+
+  from = m_recordedLength <= length ? m_recordedLength : 0;
+
+  if (refresh) {
+    qint64 args[] = {from, length};
+
+    SuWidgetsRecorder::record(
+          this,
+          SUWIDGETS_TRACE_WAVEFORM_REFRESH,
+          getData() + from,
+          SCAST(quint64, length - from) * sizeof(SUCOMPLEX),
+          args,
+          2);
+  } else {
+    qint64 args[] = {from, length, keepView, flush};
+
+    SuWidgetsRecorder::record(
+          this,
+          SUWIDGETS_TRACE_WAVEFORM_SET_DATA,
+          getData() + from,
+          SCAST(quint64, length - from) * sizeof(SUCOMPLEX),
+          args,
+          4);
+  }
+
+  m_recordedLength = length;
 }
 
 void
@@ -1316,7 +1585,7 @@ void
 Waveform::setShowEnvelope(bool show)
 {
   m_view.setShowEnvelope(show);
-  m_waveDrawn = false;
+  invalidateWave();
   m_axesDrawn = false;
   invalidate();
 }
@@ -1326,7 +1595,7 @@ Waveform::setShowPhase(bool show)
 {
   m_view.setShowPhase(show);
   if (m_view.isEnvelopeVisible()) {
-    m_waveDrawn = false;
+    invalidateWave();
     m_axesDrawn = false;
     invalidate();
   }
@@ -1338,7 +1607,7 @@ Waveform::setShowPhaseDiff(bool show)
   m_view.setShowPhaseDiff(show);
 
   if (m_view.isEnvelopeVisible()) {
-    m_waveDrawn = false;
+    invalidateWave();
     m_axesDrawn = false;
     invalidate();
   }
@@ -1352,7 +1621,7 @@ Waveform::setPhaseDiffOrigin(unsigned origin)
   if (m_view.isEnvelopeVisible()
       && m_view.isPhaseEnabled()
       && m_view.isPhaseDiffEnabled()) {
-    m_waveDrawn = false;
+    invalidateWave();
     m_axesDrawn = false;
     invalidate();
   }
@@ -1366,7 +1635,7 @@ Waveform::setPhaseDiffContrast(qreal contrast)
   if (m_view.isEnvelopeVisible()
       && m_view.isPhaseEnabled()
       && m_view.isPhaseDiffEnabled()) {
-    m_waveDrawn = false;
+    invalidateWave();
     m_axesDrawn = false;
     invalidate();
   }
@@ -1377,7 +1646,7 @@ Waveform::setShowWaveform(bool show)
 {
   m_view.setShowWaveform(show);
 
-  m_waveDrawn = false;
+  invalidateWave();
   m_axesDrawn = false;
   invalidate();
 }
@@ -1409,7 +1678,14 @@ Waveform::refreshData()
   m_askedToKeepView = true;
   m_data.rebuildViews();
 
+  if (SuWidgetsRecorder::isRecording())
+    recordIngest(true, true, false);
+
   if (m_autoScroll && getSampleEnd() <= lastSample) {
+    // The view only moves forward: scroll the current image if possible
+    if (m_waveDrawn)
+      m_rollPending = true;
+
     m_view.setHorizontalZoom(lastSample - currSpan, lastSample);
 
     if (m_hSelDragging)
@@ -1488,6 +1764,34 @@ Waveform::~Waveform()
 {
 }
 
+void
+Waveform::memoryUsage(SuWidgetsMemoryUsage &usage) const
+{
+  usage[SUWIDGETS_MEMORY_WAVE_TREES] += m_view.treeMemoryUsage();
+  usage[SUWIDGETS_MEMORY_SAMPLES]    += m_data.memoryUsage();
+  usage[SUWIDGETS_MEMORY_IMAGES]     +=
+        SuWidgetsMemory::imageBytes(m_waveform)
+      + SuWidgetsMemory::pixmapBytes(m_contentPixmap)
+      + SuWidgetsMemory::pixmapBytes(m_axesPixmap);
+}
+
+// Wave trees are compacted, nothing is lost
+quint64
+Waveform::reclaimMemory(SuWidgetsMemoryCategory category, quint64)
+{
+  if (category == SUWIDGETS_MEMORY_WAVE_TREES)
+    return m_view.compactTree();
+
+  return 0;
+}
+
+void
+Waveform::onTraceTreeChanges()
+{
+  invalidateWave();
+  invalidate();
+}
+
 void
 Waveform::onWaveViewChanges()
 {
@@ -1498,6 +1802,7 @@ Waveform::onWaveViewChanges()
   m_axesDrawn = false;
 
   if (!m_askedToKeepView) {
+    invalidateWave();
     resetSelection();
 
     if (m_autoFitToEnvelope)
@@ -24,9 +24,12 @@
 #include <QWheelEvent>
 #include <QList>
 #include <QMap>
+#include <QHash>
+#include <QPixmap>
 
 #include <sigutils/types.h>
 #include "ThrottleableWidget.h"
+#include "SuWidgetsMemory.h"
 #include "WaveView.h"
 
 #define WAVEFORM_DEFAULT_BACKGROUND_COLOR QColor(0x1d, 0x1d, 0x1f)
@@ -40,6 +43,8 @@
 #define WAVEFORM_DELTA_LIMIT              9000
 #define WAVEFORM_POINT_RADIUS             5
 #define WAVEFORM_POINT_SPACING            3
+#define WAVEFORM_MAX_CACHED_LABELS        1024
+#define WAVEFORM_ROLL_OVERLAP             2
 
 struct WavePoint {
   QString string;
@@ -68,6 +73,41 @@ struct WaveACursor {
   SUFLOAT amplitude;
 };
 
+struct WaveAxisLabel {
+  QPixmap pixmap;
+  int     width = 0;
+};
+
+//
+// Axis labels are formatted and rendered once, and reused for as long as
+// the value, the division size (which determines the precision) and the
+// units of the label do not change. While panning, most labels are found
+// here and the axes only need to be laid out again.
+//
+class WaveAxisLabelCache {
+  QHash<QPair<qreal, qreal>, WaveAxisLabel> m_labels;
+
+  QString m_units;
+  QColor  m_foreground;
+  QColor  m_background;
+  bool    m_absolute = false;
+
+public:
+  void configure(
+      QString const &units,
+      bool absolute,
+      QColor const &foreground,
+      QColor const &background);
+
+  WaveAxisLabel const &label(QFont const &, qreal value, qreal delta);
+
+  inline void
+  clear()
+  {
+    m_labels.clear();
+  }
+};
+
 class WaveBuffer {
   WaveView *m_view = nullptr;
 
@@ -126,9 +166,15 @@ public:
   size_t length() const;
   const SUCOMPLEX *data() const;
   const std::vector<SUCOMPLEX> *loanedBuffer() const;
+
+  inline quint64
+  memoryUsage() const
+  {
+    return m_loan ? 0 : m_ownBuffer.capacity() * sizeof(SUCOMPLEX);
+  }
 };
 
-class Waveform : public ThrottleableWidget
+class Waveform : public ThrottleableWidget, public SuWidgetsMemoryClient
 {
   Q_OBJECT
 
@@ -227,6 +273,7 @@ class Waveform : public ThrottleableWidget
   bool m_haveGeometry = false;
   bool m_axesDrawn = false;
   bool m_waveDrawn = false;
+  bool m_rollPending = false;
   bool m_selUpdated = false;
   bool m_enableFeedback = true;
 
@@ -234,6 +281,20 @@ class Waveform : public ThrottleableWidget
   QPixmap m_contentPixmap; // Data and vertical axes
   QPixmap m_axesPixmap;    // Only horizontal axes
 
+  WaveAxisLabelCache m_hLabelCache;
+  WaveAxisLabelCache m_vLabelCache;
+
+  // What the current waveform image displays. Used in auto-scroll mode to
+  // tell whether the image can be scrolled instead of fully redrawn
+  qint64 m_drawnStart = 0;
+  qint64 m_drawnEnd = 0;
+  qint64 m_drawnLength = 0;
+  bool   m_drawnComplete = false;
+  bool   m_drawnLowDetail = false;
+  qreal  m_drawnMin = 0;
+  qreal  m_drawnMax = 0;
+  qreal  m_rollResidual = 0;
+
   // Interactive state
   qreal m_savedMin;
   qreal m_savedMax;
@@ -259,6 +320,10 @@ class Waveform : public ThrottleableWidget
 
   bool m_askedToKeepView = false;
 
+  // Samples already written to the current trace recording
+  quint32 m_recordedSession = 0;
+  qint64  m_recordedLength  = 0;
+
   // Limits
   WaveView   m_view;
   WaveBuffer m_data;
@@ -282,6 +347,10 @@ class Waveform : public ThrottleableWidget
   qreal m_vSelStart  = 0;
   qreal m_vSelEnd    = 0;
 
+  // Multi-trace mode. Empty: regular single-trace rendering
+  QList<WaveTrace> m_traces;
+  bool m_stackedTraces = false;
+
   // Behavioral properties
   bool m_autoScroll = false;
   bool m_autoFitToEnvelope = true;
@@ -294,13 +363,22 @@ class Waveform : public ThrottleableWidget
   void overlayVCursors(QPainter &);
   void overlayPoints(QPainter &);
   void drawWave();
+  bool rollWave();
   void overlaySelection(QPainter &);
   void overlaySelectionMarkes(QPainter &);
   void recalculateDisplayData();
+  void recordIngest(bool refresh, bool keepView, bool flush);
   void paintTriangle(QPainter &, int, int, int, QColor const &, int side = 5);
   void triggerMouseMoveHere();
   int  calcWaveViewWidth() const;
 
+  inline void
+  invalidateWave()
+  {
+    m_waveDrawn   = false;
+    m_rollPending = false;
+  }
+
   inline bool
   somethingDirty() const
   {
@@ -391,7 +469,7 @@ public:
     {
       if (!m_pointMap.empty() || !map.empty()) {
         m_pointMap = map;
-        m_waveDrawn = false;
+        this->invalidateWave();
         this->invalidate();
       }
     }
@@ -404,11 +482,11 @@ public:
         m_pointMap.erase(it);
         prev.saved_t = prev.t;
         auto ret = m_pointMap.insert(prev.t, prev);
-        m_waveDrawn = false;
+        this->invalidateWave();
         this->invalidate();
         return ret;
       } else {
-        m_waveDrawn = false;
+        this->invalidateWave();
         this->invalidate();
         return it;
       }
@@ -418,7 +496,7 @@ public:
     removePoint(const QMap<qreal, WavePoint>::iterator &it)
     {
       m_pointMap.erase(it);
-      m_waveDrawn = false;
+      this->invalidateWave();
       this->invalidate();
     }
 
@@ -434,7 +512,7 @@ public:
       p.saved_t = t;
 
       auto ret = m_pointMap.insert(p.t, p);
-      m_waveDrawn = false;
+      this->invalidateWave();
       this->invalidate();
       return ret;
     }
@@ -444,7 +522,7 @@ public:
     {
       if (!m_markerList.empty() || !list.empty()) {
         m_markerList = list;
-        m_waveDrawn = false;
+        this->invalidateWave();
         this->invalidate();
       }
     }
@@ -454,7 +532,7 @@ public:
     {
       if (!m_vCursorList.empty() || !list.empty()) {
         m_vCursorList = list;
-        m_waveDrawn = false;
+        this->invalidateWave();
         this->invalidate();
       }
     }
@@ -464,7 +542,7 @@ public:
     {
       if (!m_aCursorList.empty() || !list.empty()) {
         m_aCursorList = list;
-        m_waveDrawn = false;
+        this->invalidateWave();
         this->invalidate();
       }
     }
@@ -609,6 +687,7 @@ public:
   {
     m_foreground = c;
     m_view.setForeground(m_foreground);
+    this->invalidateWave();
     m_axesDrawn = false;
     this->invalidate();
     emit foregroundColorChanged();
@@ -624,6 +703,7 @@ public:
   setEnvelopeColor(const QColor &c)
   {
     m_envelope = c;
+    this->invalidateWave();
     m_axesDrawn = false;
     this->invalidate();
     emit envelopeColorChanged();
@@ -760,7 +840,7 @@ public:
   {
     m_view.setPalette(table);
 
-    m_waveDrawn = false;
+    this->invalidateWave();
     m_axesDrawn = false;
     this->invalidate();
   }
@@ -784,9 +864,30 @@ public:
     return m_view.getEnvelope();
   }
 
+  inline const WaveViewTree *
+  getWaveTree() const
+  {
+    return m_view.getWaveTree();
+  }
+
+  inline QList<WaveTrace> const &
+  getTraces() const
+  {
+    return m_traces;
+  }
+
+  inline bool
+  isStackedTraces() const
+  {
+    return m_stackedTraces;
+  }
+
   Waveform(QWidget *parent = nullptr);
   ~Waveform() override;
 
+  void memoryUsage(SuWidgetsMemoryUsage &) const override;
+  quint64 reclaimMemory(SuWidgetsMemoryCategory, quint64) override;
+
   void setData(
       const std::vector<SUCOMPLEX> *,
       bool keepView = false,
@@ -800,8 +901,11 @@ public:
       bool appending = false);
 
   void reuseDisplayData(Waveform *);
+  void setTraces(QList<WaveTrace> const &);
+  void setStackedTraces(bool);
   void draw() override;
-  void paint() override;  
+  void paint() override;
+  void interactionFinished() override;
   void safeCancel();
   void zoomHorizontalReset(); // To show full wave or to sampPerPix = 1
   void zoomHorizontal(qint64 x, qreal amount); // Zoom at point x.
@@ -868,6 +972,7 @@ signals:
 
 public slots:
   void onWaveViewChanges();
+  void onTraceTreeChanges();
 };
 
 #endif
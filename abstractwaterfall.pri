@@ -1,4 +1,7 @@
-WIDGET_HEADERS += AbstractWaterfall.h
+WIDGET_HEADERS += AbstractWaterfall.h BookmarkCache.h WaterfallHistory.h \
+  WFTextureLayer.h WFLevelEstimator.h
 
-HEADERS += AbstractWaterfall.h
-SOURCES += AbstractWaterfall.cpp
+HEADERS += AbstractWaterfall.h BookmarkCache.h WaterfallHistory.h \
+  WFTextureLayer.h WFLevelEstimator.h
+SOURCES += AbstractWaterfall.cpp BookmarkCache.cpp WaterfallHistory.cpp \
+  WFTextureLayer.cpp WFLevelEstimator.cpp
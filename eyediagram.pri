@@ -0,0 +1,4 @@
+WIDGET_HEADERS += EyeDiagram.h
+
+HEADERS += EyeDiagram.h
+SOURCES += EyeDiagram.cpp
@@ -0,0 +1,4 @@
+WIDGET_HEADERS += GLWaveform.h
+
+HEADERS += GLWaveform.h
+SOURCES += GLWaveform.cpp
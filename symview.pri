@@ -1,4 +1,4 @@
-WIDGET_HEADERS += SymView.h Decider.h
+WIDGET_HEADERS += SymView.h Decider.h SymSearch.h SymPeriod.h
 
-HEADERS += SymView.h Decider.h
-SOURCES += SymView.cpp Decider.cpp
+HEADERS += SymView.h Decider.h SymSearch.h SymPeriod.h
+SOURCES += SymView.cpp Decider.cpp SymSearch.cpp SymPeriod.cpp
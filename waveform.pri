@@ -1,7 +1,12 @@
-WIDGET_HEADERS += Waveform.h WaveView.h WaveViewTree.h
+WIDGET_HEADERS += Waveform.h WaveView.h WaveViewTree.h WaveAnalytics.h \
+  WaveExporter.h
 
 HEADERS += Waveform.h WaveView.h YIQ.h \
   WaveWorker.h \
-  WaveViewTree.h
+  WaveViewTree.h \
+  WaveAnalytics.h \
+  WaveExporter.h
 SOURCES += Waveform.cpp WaveView.cpp \
-  WaveViewTree.cpp
+  WaveViewTree.cpp \
+  WaveAnalytics.cpp \
+  WaveExporter.cpp